@@ -0,0 +1,600 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "red11.h"
+#include <string>
+#include <chrono>
+#include <cstring>
+
+// Console only example that measures how physics stages scale
+// Every scene is simulated for the same amount of time and timings are taken from world profile
+
+#define BENCHMARK_FRAMES 120
+#define BENCHMARK_FRAME_TIME (1.0f / 60.0f)
+
+// Fills flat area with spheres flying in random directions without gravity, so they never fall asleep
+// Area grows with body count, so the amount of neighbours per body stays the same
+void fillWithSpheres(Scene *scene, int amount)
+{
+    PhysicsWorld *world = scene->getPhysicsWorld();
+    auto sphereForm = world->createPhysicsForm(0.5f, 0.8f, 0.0f, 0.0f, 0.0f);
+    sphereForm->createSphere(Vector3(0), 0.1f);
+
+    float halfSize = sqrtf((float)amount) * 0.25f;
+    auto container = scene->createActor<Actor>();
+    for (int i = 0; i < amount; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition(randf(-halfSize, halfSize), randf(0.0f, 1.0f), randf(-halfSize, halfSize));
+        component->enableCollisions(PhysicsMotionType::Dynamic, sphereForm);
+        component->getPhysicsBody()->addLinearVelocity(Vector3(randf(-1.0f, 1.0f), randf(-0.1f, 0.1f), randf(-1.0f, 1.0f)));
+    }
+}
+
+void benchmarkBroadphase(BroadphaseType broadphaseType, const char *name)
+{
+    printf("Broadphase (%s): pair finding cost per substep\n", name);
+    int counts[] = {500, 2000, 10000, 50000};
+    for (int count : counts)
+    {
+        auto scene = Red11::createScene();
+        scene->getPhysicsWorld()->setBroadphase(broadphaseType);
+        fillWithSpheres(scene, count);
+
+        float broadphase = 0.0f;
+        int subSteps = 0, pairs = 0;
+        for (int i = 0; i < BENCHMARK_FRAMES; i++)
+        {
+            scene->process(BENCHMARK_FRAME_TIME);
+            const PhysicsWorldProfile &profile = scene->getPhysicsWorld()->getProfile();
+            broadphase += profile.broadphase;
+            subSteps += profile.subSteps;
+            pairs += profile.pairs;
+        }
+
+        printf("%8i bodies: %9.4f ms, %8i pairs\n", count, broadphase / (float)subSteps, pairs / subSteps);
+        scene->destroy();
+    }
+    printf("\n");
+}
+
+// Runs the same scene with stage barriers and with task graph, time difference is what barriers cost
+float simulateSpheres(int count, bool bUseTaskGraph, int *subSteps)
+{
+    auto scene = Red11::createScene();
+    scene->getPhysicsWorld()->setTaskGraph(bUseTaskGraph);
+    fillWithSpheres(scene, count);
+
+    float simulation = 0.0f;
+    *subSteps = 0;
+    for (int i = 0; i < BENCHMARK_FRAMES; i++)
+    {
+        scene->process(BENCHMARK_FRAME_TIME);
+        const PhysicsWorldProfile &profile = scene->getPhysicsWorld()->getProfile();
+        simulation += profile.simulation;
+        *subSteps += profile.subSteps;
+    }
+    scene->destroy();
+    return simulation;
+}
+
+void benchmarkPipeline()
+{
+    printf("Pipeline: substep cost with barriers between stages and with task graph\n");
+    int counts[] = {2000, 10000};
+    for (int count : counts)
+    {
+        int subSteps;
+        float barriers = simulateSpheres(count, false, &subSteps) / (float)subSteps;
+        float graph = simulateSpheres(count, true, &subSteps) / (float)subSteps;
+        printf("%8i bodies: barriers %9.4f ms, graph %9.4f ms, saved %9.4f ms\n", count, barriers, graph, barriers - graph);
+    }
+    printf("\n");
+}
+
+struct StackResult
+{
+    float solver = 0.0f;
+    float simulation = 0.0f;
+    int contacts = 0;
+    int subSteps = 0;
+    float towerTop = 0.0f;
+
+    // Sum of body positions, it has to be the same with any amount of threads and with or without task graph
+    float checksum = 0.0f;
+};
+
+// Scene with deep stacks, a lot of contacts share the same bodies, so solver has to split them into many batches
+StackResult simulateStacks(bool bUseTaskGraph, SolverType solverType, float subStep)
+{
+    auto scene = Red11::createScene();
+    PhysicsWorld *world = scene->getPhysicsWorld();
+    world->setup(Vector3(0, -1.0f, 0), DEFAULT_SIM_SCALE, subStep);
+    world->setTaskGraph(bUseTaskGraph);
+    world->setSolver(solverType);
+    srand(1);
+
+    auto floor = scene->createActor<Actor>();
+    auto floorForm = world->createPhysicsForm(0.9f, 0.1f);
+    floorForm->createPlain(Vector3(0, 1, 0), 0.0f);
+    floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+    std::vector<PhysicsBody *> bodies;
+    auto container = scene->createActor<Actor>();
+
+    // Tower of 20 boxes
+    auto boxForm = world->createPhysicsForm(0.9f, 0.1f);
+    boxForm->createOBB(Vector3(0), 0.25f, 16.0f);
+    for (int i = 0; i < 20; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition(-4.0f, 0.125f + (float)i * 0.25f, 0.0f);
+        component->enableCollisions(PhysicsMotionType::Dynamic, boxForm);
+        bodies.push_back(component->getPhysicsBody());
+    }
+
+    // Pile of 1000 spheres dropped into a small area
+    auto sphereForm = world->createPhysicsForm(0.9f, 0.1f);
+    sphereForm->createSphere(Vector3(0), 0.1f, 20.0f);
+    for (int i = 0; i < 1000; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition(randf(-1.0f, 1.0f), 0.1f + (float)i * 0.02f, randf(-1.0f, 1.0f));
+        component->enableCollisions(PhysicsMotionType::Dynamic, sphereForm);
+        bodies.push_back(component->getPhysicsBody());
+    }
+
+    StackResult result;
+    for (int i = 0; i < BENCHMARK_FRAMES * 5; i++)
+    {
+        scene->process(BENCHMARK_FRAME_TIME);
+        const PhysicsWorldProfile &profile = world->getProfile();
+        result.solver += profile.solver;
+        result.simulation += profile.simulation;
+        result.contacts += profile.contacts;
+        result.subSteps += profile.subSteps;
+    }
+
+    for (auto &body : bodies)
+    {
+        const Vector3 &position = body->getPosition();
+        result.checksum += position.x + position.y + position.z;
+    }
+    result.towerTop = bodies[19]->getPosition().y;
+    scene->destroy();
+    return result;
+}
+
+void benchmarkSolver()
+{
+    printf("Solver: tower of 20 boxes and pile of 1000 spheres\n");
+    StackResult barriers = simulateStacks(false, SolverType::SingleContact, DEFAULT_SUB_STEP);
+    printf("barriers: %9.4f ms per substep, %6i contacts, checksum %f\n", barriers.solver / (float)barriers.subSteps, barriers.contacts / barriers.subSteps, barriers.checksum);
+    StackResult graph = simulateStacks(true, SolverType::SingleContact, DEFAULT_SUB_STEP);
+    printf("graph:    %9.4f ms per substep, %6i contacts, checksum %f\n", graph.solver / (float)graph.subSteps, graph.contacts / graph.subSteps, graph.checksum);
+    printf("results %s\n\n", barriers.checksum == graph.checksum ? "match" : "differ");
+
+    // Iterative solver keeps the tower standing with a substep per frame, top box rests at 4.875 ideally
+    printf("Solver modes: whole simulation time and height of the tower top\n");
+    StackResult single = simulateStacks(true, SolverType::SingleContact, DEFAULT_SUB_STEP);
+    printf("single contact,    substep %.4f: %9.2f ms, tower top %.3f\n", DEFAULT_SUB_STEP, single.simulation, single.towerTop);
+    StackResult iterative = simulateStacks(true, SolverType::SequentialImpulse, BENCHMARK_FRAME_TIME);
+    printf("sequential impulse, substep %.4f: %9.2f ms, tower top %.3f\n\n", BENCHMARK_FRAME_TIME, iterative.simulation, iterative.towerTop);
+}
+
+// Piles settle and fall asleep island by island, contacts of sleeping islands are no longer checked
+void benchmarkSleeping()
+{
+    printf("Sleeping: 4 piles of 250 spheres settling\n");
+    auto scene = Red11::createScene();
+    PhysicsWorld *world = scene->getPhysicsWorld();
+    world->setup(Vector3(0, -1.0f, 0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+    world->setSolver(SolverType::SequentialImpulse);
+    srand(1);
+
+    auto floor = scene->createActor<Actor>();
+    auto floorForm = world->createPhysicsForm(0.9f, 0.1f);
+    floorForm->createPlain(Vector3(0, 1, 0), 0.0f);
+    floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+    auto container = scene->createActor<Actor>();
+    auto sphereForm = world->createPhysicsForm(0.9f, 0.1f);
+    sphereForm->createSphere(Vector3(0), 0.1f, 20.0f);
+    for (int i = 0; i < 1000; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition(randf(-1.0f, 1.0f) + (float)(i % 4) * 4.0f, 0.1f + (float)(i / 4) * 0.02f, randf(-1.0f, 1.0f));
+        component->enableCollisions(PhysicsMotionType::Dynamic, sphereForm);
+    }
+
+    for (int second = 1; second <= 20; second++)
+    {
+        float simulation = 0.0f;
+        int contacts = 0, subSteps = 0;
+        for (int i = 0; i < 60; i++)
+        {
+            scene->process(BENCHMARK_FRAME_TIME);
+            const PhysicsWorldProfile &profile = world->getProfile();
+            simulation += profile.simulation;
+            contacts += profile.contacts;
+            subSteps += profile.subSteps;
+        }
+        const PhysicsWorldProfile &profile = world->getProfile();
+        if (second % 4 == 0)
+            printf("%4i s: %5i active islands, %5i sleeping islands, %6i contacts, %9.4f ms per substep\n",
+                   second, profile.activeIslands, profile.sleepingIslands, contacts / subSteps, simulation / (float)subSteps);
+    }
+    scene->destroy();
+    printf("\n");
+}
+
+// Scalar level is the same math the per body path did, vector levels take 4 and 8 bodies at a time
+void benchmarkIntegration()
+{
+    printf("Integration: velocities, positions and bounds update cost per substep\n");
+    SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    int counts[] = {10000, 50000};
+    for (int count : counts)
+    {
+        for (int level = 0; level < 3; level++)
+        {
+            auto scene = Red11::createScene();
+            PhysicsWorld *world = scene->getPhysicsWorld();
+            world->setSimdLevel(levels[level]);
+            if (world->getSimdLevel() != levels[level])
+            {
+                printf("%8i bodies, %6s: not supported\n", count, names[level]);
+                scene->destroy();
+                continue;
+            }
+            srand(1);
+            fillWithSpheres(scene, count);
+
+            float integration = 0.0f;
+            int subSteps = 0;
+            for (int i = 0; i < BENCHMARK_FRAMES; i++)
+            {
+                scene->process(BENCHMARK_FRAME_TIME);
+                const PhysicsWorldProfile &profile = world->getProfile();
+                integration += profile.integration;
+                subSteps += profile.subSteps;
+            }
+
+            printf("%8i bodies, %6s: %9.4f ms\n", count, names[level], integration / (float)subSteps);
+            scene->destroy();
+        }
+    }
+    printf("\n");
+}
+
+// Same rays cast one by one and as a batch, batches go through broadphase trees in packets of 4 rays
+void benchmarkRays()
+{
+    printf("Rays: 2000 rays 8 units long cast through the scene\n");
+    int counts[] = {10000, 50000};
+    for (int count : counts)
+    {
+        auto scene = Red11::createScene();
+        srand(1);
+        fillWithSpheres(scene, count);
+        for (int i = 0; i < 10; i++)
+            scene->process(BENCHMARK_FRAME_TIME);
+
+        float halfSize = sqrtf((float)count) * 0.25f;
+        std::vector<Segment> rays(2000);
+        for (auto &ray : rays)
+        {
+            Vector3 from(randf(-halfSize, halfSize), randf(0.0f, 1.0f), randf(-halfSize, halfSize));
+            Vector3 direction = glm::normalize(Vector3(randf(-1.0f, 1.0f), randf(-0.1f, 0.1f), randf(-1.0f, 1.0f)));
+            ray = Segment(from, from + direction * 8.0f);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        int hits = 0;
+        for (auto &ray : rays)
+            hits += scene->castRayCollision(ray).size();
+        float single = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        RayCastResults results;
+        start = std::chrono::high_resolution_clock::now();
+        scene->castRays(rays.data(), rays.size(), &results, CHANNEL_RAY_PICK, RayCastMode::AllHits);
+        float allHits = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        scene->castRays(rays.data(), rays.size(), &results, CHANNEL_RAY_PICK, RayCastMode::FirstHit);
+        float firstHit = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        printf("%8i bodies: one by one %9.4f ms, batch all hits %9.4f ms, batch first hit %9.4f ms, %6i hits\n", count, single, allHits, firstHit, hits);
+        scene->destroy();
+    }
+    printf("\n");
+}
+
+// Small spheres are shot at a thin wall, without continuous collision they step over it in one substep
+void benchmarkCCD()
+{
+    printf("CCD: 500 spheres shot at a wall 0.02 thick\n");
+    bool modes[] = {false, true};
+    for (bool ccd : modes)
+    {
+        auto scene = Red11::createScene();
+        PhysicsWorld *world = scene->getPhysicsWorld();
+        world->setup(Vector3(0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+        srand(1);
+
+        auto wall = scene->createActor<Actor>();
+        auto wallForm = world->createPhysicsForm(0.5f, 0.2f);
+        wallForm->createOBB(Vector3(0), 0.02f, 40.0f, 40.0f);
+        wall->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, wallForm);
+
+        auto container = scene->createActor<Actor>();
+        auto bulletForm = world->createPhysicsForm(0.5f, 0.2f);
+        bulletForm->createSphere(Vector3(0), 0.05f);
+        std::vector<Component *> bullets;
+        for (int i = 0; i < 500; i++)
+        {
+            auto component = container->createComponent<Component>();
+            component->setPosition(-2.0f, randf(-10.0f, 10.0f), randf(-10.0f, 10.0f));
+            component->enableCollisions(PhysicsMotionType::Dynamic, bulletForm);
+            component->getPhysicsBody()->addLinearVelocity(Vector3(randf(20.0f, 100.0f), randf(-1.0f, 1.0f), randf(-1.0f, 1.0f)));
+            if (ccd)
+                component->getPhysicsBody()->enableCCD();
+            bullets.push_back(component);
+        }
+
+        float simulation = 0.0f;
+        for (int i = 0; i < 60; i++)
+        {
+            scene->process(BENCHMARK_FRAME_TIME);
+            simulation += world->getProfile().simulation;
+        }
+
+        int tunnelled = 0;
+        for (auto bullet : bullets)
+            tunnelled += bullet->getPosition().x > 0.0f ? 1 : 0;
+        printf("%12s: %4i went through the wall, %9.4f ms per frame\n", ccd ? "with ccd" : "without ccd", tunnelled, simulation / 60.0f);
+        scene->destroy();
+    }
+    printf("\n");
+}
+
+// Fast spheres slide on the floor without friction, continuous collision shouldn't hold back bodies that only touch it
+void benchmarkCCDSliding()
+{
+    printf("CCD: 500 spheres sliding on the floor at 30 units per second\n");
+    bool modes[] = {false, true};
+    for (bool ccd : modes)
+    {
+        auto scene = Red11::createScene();
+        PhysicsWorld *world = scene->getPhysicsWorld();
+        world->setup(Vector3(0, -9.8f, 0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+
+        auto floor = scene->createActor<Actor>();
+        auto floorForm = world->createPhysicsForm(0.0f, 0.0f);
+        floorForm->createOBB(Vector3(0, -0.5f, 0), 200.0f, 1.0f, 200.0f);
+        floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+        auto container = scene->createActor<Actor>();
+        auto sphereForm = world->createPhysicsForm(0.0f, 0.0f);
+        sphereForm->createSphere(Vector3(0), 0.05f);
+        std::vector<Component *> spheres;
+        for (int i = 0; i < 500; i++)
+        {
+            auto component = container->createComponent<Component>();
+            component->setPosition(-20.0f, 0.05f, -50.0f + (float)i * 0.2f);
+            component->enableCollisions(PhysicsMotionType::Dynamic, sphereForm);
+            component->getPhysicsBody()->addLinearVelocity(Vector3(30.0f, 0.0f, 0.0f));
+            if (ccd)
+                component->getPhysicsBody()->enableCCD();
+            spheres.push_back(component);
+        }
+
+        for (int i = 0; i < 60; i++)
+            scene->process(BENCHMARK_FRAME_TIME);
+
+        float distance = 0.0f;
+        for (auto sphere : spheres)
+            distance += sphere->getPosition().x + 20.0f;
+        printf("%12s: %9.4f average distance\n", ccd ? "with ccd" : "without ccd", distance / (float)spheres.size());
+        scene->destroy();
+    }
+    printf("\n");
+}
+
+// Piles of hulls made from a sphere mesh, separating axis cost grows with squares of faces and edges, GJK with verticies
+void benchmarkConvex()
+{
+    printf("Convex: 300 hulls settling in a pile, narrowphase cost per substep\n");
+    auto sphereMesh = Red11::getMeshBuilder()->createSphere(0.1f, 12, 12);
+    int verticies[] = {8, 16, 32, 64};
+    NarrowphaseType types[] = {NarrowphaseType::SeparatingAxis, NarrowphaseType::GJK};
+    for (int amount : verticies)
+    {
+        float narrowphase[2];
+        int contacts[2];
+        for (int type = 0; type < 2; type++)
+        {
+            auto scene = Red11::createScene();
+            PhysicsWorld *world = scene->getPhysicsWorld();
+            world->setup(Vector3(0, -9.8f, 0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+            world->setSolver(SolverType::SequentialImpulse);
+            world->setNarrowphase(types[type]);
+            srand(1);
+
+            auto floor = scene->createActor<Actor>();
+            auto floorForm = world->createPhysicsForm(0.9f, 0.1f);
+            floorForm->createPlain(Vector3(0, 1, 0), 0.0f);
+            floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+            auto container = scene->createActor<Actor>();
+            auto hullForm = world->createPhysicsForm(0.9f, 0.1f);
+            hullForm->createConvex(sphereMesh, amount);
+            for (int i = 0; i < 300; i++)
+            {
+                auto component = container->createComponent<Component>();
+                component->setPosition((float)(i % 10) * 0.22f + randf(-0.02f, 0.02f), 0.15f + (float)(i / 100) * 0.22f, (float)((i / 10) % 10) * 0.22f);
+                component->enableCollisions(PhysicsMotionType::Dynamic, hullForm);
+            }
+
+            narrowphase[type] = 0.0f;
+            contacts[type] = 0;
+            int subSteps = 0;
+            for (int i = 0; i < BENCHMARK_FRAMES; i++)
+            {
+                scene->process(BENCHMARK_FRAME_TIME);
+                const PhysicsWorldProfile &profile = world->getProfile();
+                narrowphase[type] += profile.narrowphase;
+                contacts[type] += profile.contacts;
+                subSteps += profile.subSteps;
+            }
+            narrowphase[type] /= (float)subSteps;
+            contacts[type] /= subSteps;
+            scene->destroy();
+        }
+        printf("%4i verticies: separating axis %9.4f ms, %4i contacts, gjk %9.4f ms, %4i contacts\n", amount, narrowphase[0], contacts[0], narrowphase[1], contacts[1]);
+    }
+    printf("\n");
+}
+
+// Tables made of a top and four legs, every pair only collides shapes the form trees find close to each other
+void benchmarkCompound(SolverType solverType, const char *name)
+{
+    printf("Compound: 200 tables of 5 boxes settling in a pile, %s\n", name);
+    auto scene = Red11::createScene();
+    PhysicsWorld *world = scene->getPhysicsWorld();
+    world->setup(Vector3(0, -9.8f, 0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+    world->setSolver(solverType);
+    srand(1);
+
+    auto floor = scene->createActor<Actor>();
+    auto floorForm = world->createPhysicsForm(0.9f, 0.1f);
+    floorForm->createPlain(Vector3(0, 1, 0), 0.0f);
+    floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+    auto tableForm = world->createPhysicsForm(0.9f, 0.1f);
+    tableForm->createOBB(Vector3(0.0f, 0.2f, 0.0f), 0.5f, 0.04f, 0.3f);
+    tableForm->createOBB(Vector3(-0.22f, 0.0f, -0.12f), 0.04f, 0.36f, 0.04f);
+    tableForm->createOBB(Vector3(0.22f, 0.0f, -0.12f), 0.04f, 0.36f, 0.04f);
+    tableForm->createOBB(Vector3(-0.22f, 0.0f, 0.12f), 0.04f, 0.36f, 0.04f);
+    tableForm->createOBB(Vector3(0.22f, 0.0f, 0.12f), 0.04f, 0.36f, 0.04f);
+
+    auto container = scene->createActor<Actor>();
+    std::vector<Component *> tables;
+    for (int i = 0; i < 200; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition((float)(i % 10) * 0.6f + randf(-0.1f, 0.1f), 0.2f + (float)(i / 100) * 0.5f, (float)((i / 10) % 10) * 0.4f);
+        component->setRotation(Vector3(0.0f, randf(-0.3f, 0.3f), 0.0f));
+        component->enableCollisions(PhysicsMotionType::Dynamic, tableForm);
+        tables.push_back(component);
+    }
+
+    float narrowphase = 0.0f;
+    int contacts = 0;
+    int subSteps = 0;
+    for (int i = 0; i < BENCHMARK_FRAMES; i++)
+    {
+        scene->process(BENCHMARK_FRAME_TIME);
+        const PhysicsWorldProfile &profile = world->getProfile();
+        narrowphase += profile.narrowphase;
+        contacts += profile.contacts;
+        subSteps += profile.subSteps;
+    }
+
+    // Tables standing on their legs keep the top up, ones supported by a single leg fall over
+    int fallen = 0;
+    int standing = 0;
+    for (auto table : tables)
+    {
+        fallen += table->getPosition().y < 0.0f ? 1 : 0;
+        standing += (table->getRotation() * Vector3(0.0f, 1.0f, 0.0f)).y > 0.95f ? 1 : 0;
+    }
+    printf("%12s: %9.4f ms narrowphase per substep, %4i contacts, %4i standing, %4i fell through the floor\n", "tables", narrowphase / (float)subSteps, contacts / subSteps, standing, fallen);
+    scene->destroy();
+    printf("\n");
+}
+
+// Rollback netcode saves the world several times per frame and resimulates frames that came late
+void benchmarkState()
+{
+    printf("State: 1000 bodies in a pile, saving, loading and resimulating 60 frames\n");
+    auto scene = Red11::createScene();
+    PhysicsWorld *world = scene->getPhysicsWorld();
+    world->setup(Vector3(0, -9.8f, 0), DEFAULT_SIM_SCALE, BENCHMARK_FRAME_TIME);
+    world->setDeterministic(true);
+    srand(1);
+
+    auto floor = scene->createActor<Actor>();
+    auto floorForm = world->createPhysicsForm(0.9f, 0.1f);
+    floorForm->createPlain(Vector3(0, 1, 0), 0.0f);
+    floor->createComponent<Component>()->enableCollisions(PhysicsMotionType::Static, floorForm);
+
+    auto sphereForm = world->createPhysicsForm(0.9f, 0.1f);
+    sphereForm->createSphere(Vector3(0), 0.1f);
+    auto container = scene->createActor<Actor>();
+    std::vector<Component *> spheres;
+    for (int i = 0; i < 1000; i++)
+    {
+        auto component = container->createComponent<Component>();
+        component->setPosition(randf(-1.0f, 1.0f), 0.1f + (float)i * 0.02f, randf(-1.0f, 1.0f));
+        component->enableCollisions(PhysicsMotionType::Dynamic, sphereForm);
+        spheres.push_back(component);
+    }
+    for (int i = 0; i < 60; i++)
+        scene->process(BENCHMARK_FRAME_TIME);
+
+    PhysicsStateBuffer state;
+    world->saveState(&state);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100; i++)
+        world->saveState(&state);
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100; i++)
+        world->loadState(&state);
+    auto end = std::chrono::high_resolution_clock::now();
+    float save = std::chrono::duration<float, std::micro>(middle - start).count() / 100.0f;
+    float load = std::chrono::duration<float, std::micro>(end - middle).count() / 100.0f;
+
+    std::vector<Vector3> positions;
+    for (int i = 0; i < 60; i++)
+        scene->process(BENCHMARK_FRAME_TIME);
+    for (auto sphere : spheres)
+        positions.push_back(sphere->getPosition());
+    world->loadState(&state);
+    for (int i = 0; i < 60; i++)
+        scene->process(BENCHMARK_FRAME_TIME);
+    int differ = 0;
+    for (int i = 0; i < (int)spheres.size(); i++)
+    {
+        Vector3 position = spheres[i]->getPosition();
+        differ += memcmp(&positions[i], &position, sizeof(Vector3)) ? 1 : 0;
+    }
+
+    printf("%12s: %6i bytes, save %9.2f us, load %9.2f us, %4i bodies differ after resimulation\n", "spheres", (int)state.getSize(), save, load, differ);
+    scene->destroy();
+    printf("\n");
+}
+
+APPMAIN
+{
+    Red11::openConsole();
+
+    benchmarkBroadphase(BroadphaseType::DynamicTree, "dynamic tree");
+    benchmarkBroadphase(BroadphaseType::SweepAndPrune, "sweep and prune");
+    benchmarkPipeline();
+    benchmarkSolver();
+    benchmarkSleeping();
+    benchmarkIntegration();
+    benchmarkRays();
+    benchmarkCCD();
+    benchmarkCCDSliding();
+    benchmarkConvex();
+    benchmarkCompound(SolverType::SingleContact, "single contact solver");
+    benchmarkCompound(SolverType::SequentialImpulse, "sequential impulse solver");
+    benchmarkState();
+
+    printf("Press enter to exit\n");
+    getchar();
+    return 0;
+}
@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "red11.h"
+#include <string>
+#include <chrono>
+
+// Console only example that measures animation evaluation of many characters
+// Skeletons and clips are generated, so it doesn't need any files
+
+#define BENCHMARK_FRAMES 120
+#define BENCHMARK_FRAME_TIME (1.0f / 60.0f)
+
+#define CHARACTERS 100
+#define BONES 60
+#define KEYS 60
+
+// Spine with limbs growing from every fourth bone, like a simple humanoid only longer
+std::vector<MeshObject *> createSkeleton()
+{
+    std::vector<MeshObject *> bones;
+    for (int i = 0; i < BONES; i++)
+    {
+        auto bone = new MeshObject(nullptr, true);
+        bone->setName("bone" + std::to_string(i));
+        bone->setPosition(0.0f, 0.1f, 0.0f);
+        if (i > 0)
+            bone->setParent(bones[(i % 4) ? i - 1 : (i / 2) & ~3]);
+        bones.push_back(bone);
+    }
+    return bones;
+}
+
+// Every bone sways with its own phase, a second of keys
+Animation *createClip(const std::string &name, float amplitude)
+{
+    auto animation = new Animation(name);
+    for (int i = 0; i < BONES; i++)
+    {
+        auto target = animation->createAnimationTarget("bone" + std::to_string(i));
+        float phase = randf(0.0f, CONST_PI2);
+        for (int k = 0; k <= KEYS; k++)
+        {
+            float time = (float)k / (float)KEYS;
+            float angle = sinf(time * CONST_PI2 + phase) * amplitude;
+            target->addKey({time, Vector3(0.0f, 0.1f, 0.0f), Vector3(angle, 0.0f, angle * 0.5f), Vector3(1.0f)});
+        }
+    }
+    animation->recalcAnimationLength();
+    return animation;
+}
+
+// Poses are blended on the calling thread or on all the threads of the job queue
+void benchmarkEvaluation(bool bParallel, const char *name)
+{
+    printf("Evaluation: %i characters of %i bones blending 3 looped tracks, %s\n", CHARACTERS, BONES, name);
+    auto scene = Red11::createScene();
+    scene->setParallelAnimation(bParallel);
+    srand(1);
+
+    auto skeleton = createSkeleton();
+    Animation *clips[] = {createClip("idle", 0.1f), createClip("walk", 0.4f), createClip("run", 0.8f)};
+
+    auto container = scene->createActor<Actor>();
+    for (int i = 0; i < CHARACTERS; i++)
+    {
+        auto character = container->createComponentMeshGroup(&skeleton, Vector3((float)(i % 10), 0.0f, (float)(i / 10)));
+        character->createAnimationTrack(clips[0])->loop(1.0f, randf(0.0f, 1.0f), 0.3f);
+        character->createAnimationTrack(clips[1])->loop(1.2f, randf(0.0f, 1.0f), 0.5f);
+        character->createAnimationTrack(clips[2])->loop(1.5f, randf(0.0f, 1.0f), 0.2f);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_FRAMES; i++)
+        scene->process(BENCHMARK_FRAME_TIME);
+    float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    printf("%12s: %9.4f ms per frame\n", "characters", time / (float)BENCHMARK_FRAMES);
+    scene->destroy();
+    printf("\n");
+}
+
+// Locomotion below, upper body of the spine from its fourth bone on its own layer and additive breathing on top
+void benchmarkLayers()
+{
+    printf("Layers: %i characters, 2 locomotion tracks, masked upper body layer, additive layer\n", CHARACTERS);
+    auto scene = Red11::createScene();
+    srand(1);
+
+    auto skeleton = createSkeleton();
+    Animation *clips[] = {createClip("walk", 0.4f), createClip("run", 0.8f), createClip("aim", 0.2f), createClip("breathe", 0.05f)};
+    auto upperBody = new AnimationMask();
+    upperBody->setWeight("bone4", 1.0f);
+
+    auto container = scene->createActor<Actor>();
+    for (int i = 0; i < CHARACTERS; i++)
+    {
+        auto character = container->createComponentMeshGroup(&skeleton, Vector3((float)(i % 10), 0.0f, (float)(i / 10)));
+        character->createAnimationTrack(clips[0])->loop(1.2f, randf(0.0f, 1.0f), 0.6f);
+        character->createAnimationTrack(clips[1])->loop(1.5f, randf(0.0f, 1.0f), 0.4f);
+
+        auto aim = character->createAnimationTrack(clips[2]);
+        aim->setLayer(1);
+        aim->setMask(upperBody);
+        aim->loop(1.0f, randf(0.0f, 1.0f), 0.8f);
+
+        auto breathe = character->createAnimationTrack(clips[3]);
+        breathe->setLayer(2);
+        breathe->setBlendMode(AnimationBlendMode::Additive);
+        breathe->loop(0.5f, randf(0.0f, 1.0f), 1.0f);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_FRAMES; i++)
+        scene->process(BENCHMARK_FRAME_TIME);
+    float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    printf("%12s: %9.4f ms per frame\n", "characters", time / (float)BENCHMARK_FRAMES);
+    scene->destroy();
+    printf("\n");
+}
+
+// Row of characters going away from the camera, the far ones update every few frames and only the bones near the root
+void benchmarkLod(bool bLod, const char *name)
+{
+    printf("Level of detail: %i characters up to 45 units from the camera, %s\n", CHARACTERS, name);
+    auto scene = Red11::createScene();
+    srand(1);
+
+    Camera camera;
+    camera.setupAsPerspective(1280.0f, 720.0f, 0.01f, 100.0f);
+    camera.updateViewMatrix(Matrix4(1.0f));
+    scene->updateAnimationCamera(&camera);
+
+    auto skeleton = createSkeleton();
+    Animation *clips[] = {createClip("walk", 0.4f), createClip("run", 0.8f)};
+
+    auto container = scene->createActor<Actor>();
+    for (int i = 0; i < CHARACTERS; i++)
+    {
+        auto character = container->createComponentMeshGroup(&skeleton, Vector3((float)(i % 10), 0.0f, -(float)(i / 10) * 5.0f));
+        character->createAnimationTrack(clips[0])->loop(1.2f, randf(0.0f, 1.0f), 0.6f);
+        character->createAnimationTrack(clips[1])->loop(1.5f, randf(0.0f, 1.0f), 0.4f);
+        if (bLod)
+        {
+            character->addAnimationLod(10.0f, 2, 6);
+            character->addAnimationLod(25.0f, 4, 3);
+        }
+    }
+
+    int evaluatedBones = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_FRAMES; i++)
+    {
+        scene->process(BENCHMARK_FRAME_TIME);
+        evaluatedBones += scene->getAnimationProfile().evaluatedBones;
+    }
+    float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    printf("%12s: %9.4f ms per frame\n", "characters", time / (float)BENCHMARK_FRAMES);
+    printf("%12s: %9i per frame of %i\n", "bones", evaluatedBones / BENCHMARK_FRAMES, CHARACTERS * BONES);
+    scene->destroy();
+    printf("\n");
+}
+
+APPMAIN
+{
+    Red11::openConsole();
+
+    benchmarkEvaluation(false, "serial");
+    benchmarkEvaluation(true, "parallel");
+    benchmarkLayers();
+    benchmarkLod(false, "without levels");
+    benchmarkLod(true, "with levels");
+
+    printf("Press enter to exit\n");
+    getchar();
+    return 0;
+}
@@ -2,6 +2,9 @@
 // SPDX-License-Identifier: MIT
 
 #include "componentMeshGroup.h"
+#include "actor/actor.h"
+#include "scene/scene.h"
+#include "utils/sphere.h"
 #include <utils/glm/gtx/matrix_decompose.hpp>
 
 ComponentMeshGroup::ComponentMeshGroup()
@@ -17,13 +20,22 @@ ComponentMeshGroup::~ComponentMeshGroup()
 
 void ComponentMeshGroup::onRenderQueue(Renderer *renderer)
 {
+    bInFrustum = bVisible;
     if (bVisible)
     {
+        // Same check renderer culls meshes with, animation of the next frame is skipped if nothing passes it
+        Scene *scene = owner ? owner->getScene() : nullptr;
+        bool bCheckFrustum = scene && scene->hasAnimationCamera();
+        bool bHasMeshes = false;
+        bool bAnyInFrustum = false;
+        Sphere sphere;
+
         for (auto &it : list)
         {
             Mesh *mesh = it->getMesh();
             if (mesh)
             {
+                bHasMeshes = true;
                 if (it->bIsSkinned)
                 {
                     boneTransforms.clear();
@@ -31,16 +43,30 @@ void ComponentMeshGroup::onRenderQueue(Renderer *renderer)
                     {
                         Deform *deform = mesh->getDeformByName(*boneIt->getNamePointer());
                         if (deform)
+                        {
                             boneTransforms.push_back(BoneTransform(&boneIt->getModelMatrix(), deform));
+                            if (bCheckFrustum && !bAnyInFrustum)
+                            {
+                                Matrix4 mv = *scene->getAnimationCameraView() * boneIt->getModelMatrix();
+                                sphere.setup(Vector3(0.0f), deform->getCullingRadius());
+                                bAnyInFrustum = sphere.isSphereInFrustum(&mv, scene->getAnimationCameraPlanes());
+                            }
+                        }
                     }
                     renderer->queueMeshSkinned(mesh, material, &it->getModelMatrix(), &boneTransforms);
                 }
                 else
                 {
                     renderer->queueMesh(mesh, material, it->getModelMatrix());
+                    if (bCheckFrustum && !bAnyInFrustum)
+                    {
+                        Matrix4 mv = *scene->getAnimationCameraView() * it->getModelMatrix();
+                        bAnyInFrustum = mesh->getBoundVolumeSphere().isSphereInFrustum(&mv, scene->getAnimationCameraPlanes());
+                    }
                 }
             }
         }
+        bInFrustum = !bCheckFrustum || !bHasMeshes || bAnyInFrustum;
 
         if (bViewBones || bViewCullingSpheres)
         {
@@ -81,53 +107,193 @@ void ComponentMeshGroup::onRenderQueue(Renderer *renderer)
 
 void ComponentMeshGroup::onProcess(float delta)
 {
-    // gather total weight
-    bool hasAnimations = false;
     for (auto &track : tracks)
-    {
         track->process(delta);
-        if (track->isPlaying())
-            hasAnimations = true;
+
+    // Actor deletes destroyed components right after processing them
+    if (isDestroyed())
+        return;
+
+    Scene *scene = owner ? owner->getScene() : nullptr;
+    selectAnimationLod(scene);
+
+    if (framesSinceEvaluation < ANIMATION_NEVER_EVALUATED)
+        framesSinceEvaluation++;
+    bEvaluatePose = bInFrustum && framesSinceEvaluation >= updateInterval;
+    if (bEvaluatePose)
+    {
+        // Group that was out of view or far for long would only crawl towards the new pose, it jumps to it instead
+        bSnapPose = framesSinceEvaluation > updateInterval * 2;
+        framesSinceEvaluation = 0;
     }
 
-    if (!hasAnimations)
+    if (scene)
+        scene->queueAnimation(this);
+    else
     {
-        // no animations playing
-        for (auto &it : list)
+        if (bEvaluatePose)
+            evaluatePose();
+        commitPose();
+    }
+}
+
+void ComponentMeshGroup::evaluatePose()
+{
+    // The pose shown now is where the interpolation towards the new one starts
+    if (updateInterval > 1)
+    {
+        for (int nodeIndex = 0; nodeIndex < (int)list.size(); nodeIndex++)
         {
-            it->setPosition(it->initialPosition);
-            it->setRotation(it->initialRotation);
-            it->setScale(it->initialScale);
+            previousPositions[nodeIndex] = glm::mix(previousPositions[nodeIndex], posePositions[nodeIndex], committedBlend);
+            previousRotations[nodeIndex] = glm::normalize(glm::lerp(previousRotations[nodeIndex], poseRotations[nodeIndex], committedBlend));
+            previousScales[nodeIndex] = glm::mix(previousScales[nodeIndex], poseScales[nodeIndex], committedBlend);
         }
     }
-    else
+
+    // Tracks go by layers, insertion keeps the order of tracks within a layer and doesn't allocate
+    for (int i = 1; i < (int)tracks.size(); i++)
     {
-        for (auto &node : list)
+        AnimationTrack *track = tracks[i];
+        int j = i;
+        for (; j > 0 && tracks[j - 1]->getLayer() > track->getLayer(); j--)
+            tracks[j] = tracks[j - 1];
+        tracks[j] = track;
+    }
+
+    int tracksAmount = (int)tracks.size();
+    AnimationTrack **sortedTracks = tracks.data();
+    evaluatedBones = 0;
+    for (int nodeIndex = 0; nodeIndex < (int)list.size(); nodeIndex++)
+    {
+        if (nodeDepths[nodeIndex] > boneDepth)
+            continue;
+
+        evaluatedBones++;
+        AnimationMeshObject *node = list[nodeIndex];
+        Vector3 position = node->initialPosition;
+        Quat rotation = node->initialRotation;
+        Vector3 scale = node->initialScale;
+
+        int layerStart = 0;
+        while (layerStart < tracksAmount)
         {
-            // Some nodes may not exist in some tracks so we need to calc local one
-            float totalWeightNode = 0.0f;
-            for (auto &track : tracks)
+            int layer = sortedTracks[layerStart]->getLayer();
+            int layerEnd = layerStart;
+            while (layerEnd < tracksAmount && sortedTracks[layerEnd]->getLayer() == layer)
+                layerEnd++;
+
+            // Override tracks of the layer are blended in one pass, quaternions are kept in one hemisphere and normalized at the end
+            Vector3 layerPosition = Vector3(0.0f);
+            Quat layerRotation = Quat(0.0f, 0.0f, 0.0f, 0.0f);
+            Vector3 layerScale = Vector3(0.0f);
+            float totalWeight = 0.0f;
+            for (int i = layerStart; i < layerEnd; i++)
             {
-                if (track->isPlaying())
-                    totalWeightNode += track->getNodeWeight(*node->getNamePointer());
+                AnimationTrack *track = sortedTracks[i];
+                if (!track->isPlaying() || track->getBlendMode() != AnimationBlendMode::Override)
+                    continue;
+
+                float nodeWeight = track->getNodeWeight(nodeIndex);
+                Vector3 keyPosition, keyScale;
+                Quat keyRotation;
+                if (nodeWeight <= 0.0f || !track->sample(nodeIndex, &keyPosition, &keyRotation, &keyScale))
+                    continue;
+
+                if (glm::dot(layerRotation, keyRotation) < 0.0f)
+                    keyRotation = -keyRotation;
+                layerPosition += keyPosition * nodeWeight;
+                layerRotation += keyRotation * nodeWeight;
+                layerScale += keyScale * nodeWeight;
+                totalWeight += nodeWeight;
             }
 
-            float initialTake = fmaxf(0.0f, 1.0f - totalWeightNode);
-            totalWeightNode += initialTake;
+            // Layer that doesn't weight a whole leaves the rest to the pose below
+            if (totalWeight > 0.0f)
+            {
+                float take = fminf(totalWeight, 1.0f);
+                layerRotation = glm::normalize(layerRotation);
+                if (glm::dot(rotation, layerRotation) < 0.0f)
+                    layerRotation = -layerRotation;
+                position = position * (1.0f - take) + layerPosition * (take / totalWeight);
+                rotation = glm::normalize(rotation * (1.0f - take) + layerRotation * take);
+                scale = scale * (1.0f - take) + layerScale * (take / totalWeight);
+            }
 
-            Vector3 position = initialTake > 0.0f ? node->initialPosition * initialTake : Vector3(0.0f);
-            Quat rotation = node->initialRotation;
-            Vector3 scale = initialTake > 0.0f ? node->initialScale * initialTake : Vector3(0.0f);
+            for (int i = layerStart; i < layerEnd; i++)
+            {
+                AnimationTrack *track = sortedTracks[i];
+                if (track->isPlaying() && track->getBlendMode() == AnimationBlendMode::Additive)
+                    track->addAdditive(nodeIndex, &position, &rotation, &scale);
+            }
+            layerStart = layerEnd;
+        }
 
-            for (auto &track : tracks)
-                track->addTransformation(totalWeightNode, *node->getNamePointer(), &position, &rotation, &scale);
+        posePositions[nodeIndex] = position;
+        poseRotations[nodeIndex] = rotation;
+        poseScales[nodeIndex] = scale;
+    }
 
-            // printf("%s - %f %f %f\n", node->getNamePointer()->c_str(), position.x, position.y, position.z);
+    // Nothing to move from, the new pose is shown as is until the next evaluation
+    if (bSnapPose)
+    {
+        previousPositions = posePositions;
+        previousRotations = poseRotations;
+        previousScales = poseScales;
+    }
+}
 
-            node->setPosition(position);
-            node->setRotation(rotation);
-            node->setScale(scale);
+void ComponentMeshGroup::commitPose()
+{
+    // Nodes out of view keep what they had, the pose snaps when they get back
+    if (!bInFrustum)
+        return;
+
+    float blend = updateInterval > 1 ? fminf((float)(framesSinceEvaluation + 1) / (float)updateInterval, 1.0f) : 1.0f;
+    committedBlend = blend;
+    if (blend >= 1.0f)
+    {
+        for (int nodeIndex = 0; nodeIndex < (int)list.size(); nodeIndex++)
+        {
+            AnimationMeshObject *node = list[nodeIndex];
+            node->setPosition(posePositions[nodeIndex]);
+            node->setRotation(poseRotations[nodeIndex]);
+            node->setScale(poseScales[nodeIndex]);
         }
+        return;
+    }
+
+    for (int nodeIndex = 0; nodeIndex < (int)list.size(); nodeIndex++)
+    {
+        AnimationMeshObject *node = list[nodeIndex];
+        node->setPosition(glm::mix(previousPositions[nodeIndex], posePositions[nodeIndex], blend));
+        node->setRotation(glm::normalize(glm::lerp(previousRotations[nodeIndex], poseRotations[nodeIndex], blend)));
+        node->setScale(glm::mix(previousScales[nodeIndex], poseScales[nodeIndex], blend));
+    }
+}
+
+void ComponentMeshGroup::addAnimationLod(float distance, int updateInterval, int boneDepth)
+{
+    AnimationLod lod = {distance, updateInterval > 1 ? updateInterval : 1, boneDepth};
+    auto it = lods.begin();
+    while (it != lods.end() && it->distance <= distance)
+        it++;
+    lods.insert(it, lod);
+}
+
+void ComponentMeshGroup::selectAnimationLod(Scene *scene)
+{
+    updateInterval = 1;
+    boneDepth = ANIMATION_ALL_BONES;
+    if (lods.empty() || !scene || !scene->hasAnimationCamera())
+        return;
+
+    float distance = glm::length(Vector3(getModelMatrix()[3]) - scene->getAnimationCameraPosition());
+    for (auto &lod : lods)
+    {
+        if (distance < lod.distance)
+            break;
+        updateInterval = lod.updateInterval;
+        boneDepth = lod.boneDepth;
     }
 }
 
@@ -156,6 +322,7 @@ void ComponentMeshGroup::setMeshList(std::vector<MeshObject *> *newList)
 
     // relink parents
     int iChild = 0;
+    nodeParents.assign(list.size(), -1);
     for (auto &child : *newList)
     {
         if (child->getParent())
@@ -166,6 +333,7 @@ void ComponentMeshGroup::setMeshList(std::vector<MeshObject *> *newList)
                 if (parent == child->getParent())
                 {
                     list.at(iChild)->setParent(list.at(iParent));
+                    nodeParents[iChild] = iParent;
                     break;
                 }
                 iParent++;
@@ -178,11 +346,42 @@ void ComponentMeshGroup::setMeshList(std::vector<MeshObject *> *newList)
     for (auto &it : list)
         if (!it->getParent())
             it->setEntityParent(this);
+
+    posePositions.resize(list.size());
+    poseRotations.resize(list.size());
+    poseScales.resize(list.size());
+    previousPositions.resize(list.size());
+    previousRotations.resize(list.size());
+    previousScales.resize(list.size());
+
+    // Depth of a node is limited by the amount of nodes, so a broken hierarchy can't loop forever
+    nodeDepths.assign(list.size(), 0);
+    for (int i = 0; i < (int)list.size(); i++)
+    {
+        for (int parent = nodeParents[i]; parent != -1 && nodeDepths[i] < (int)list.size(); parent = nodeParents[parent])
+            nodeDepths[i]++;
+    }
+
+    // Nodes that were never evaluated hold their initial transformation
+    for (int i = 0; i < (int)list.size(); i++)
+    {
+        posePositions[i] = previousPositions[i] = list[i]->initialPosition;
+        poseRotations[i] = previousRotations[i] = list[i]->initialRotation;
+        poseScales[i] = previousScales[i] = list[i]->initialScale;
+    }
+    // First processing evaluates the pose and snaps to it
+    framesSinceEvaluation = ANIMATION_NEVER_EVALUATED;
+    committedBlend = 1.0f;
+
+    // tracks find targets of the new nodes
+    for (auto &track : tracks)
+        bindTrack(track);
 }
 
 AnimationTrack *ComponentMeshGroup::createAnimationTrack(Animation *animation)
 {
     auto animTrack = new AnimationTrack(animation);
+    bindTrack(animTrack);
     tracks.push_back(animTrack);
     return animTrack;
 }
@@ -197,6 +396,14 @@ void ComponentMeshGroup::setMaterial(Material *material)
         this->material->addUser();
 }
 
+void ComponentMeshGroup::bindTrack(AnimationTrack *track)
+{
+    std::vector<std::string *> names;
+    for (auto &it : list)
+        names.push_back(it->getNamePointer());
+    track->bind(names, nodeParents);
+}
+
 void ComponentMeshGroup::destroyList()
 {
     for (auto &it : list)
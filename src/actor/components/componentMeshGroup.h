@@ -8,6 +8,8 @@
 #include "data/meshObject.h"
 #include "utils/utils.h"
 
+class Scene;
+
 class AnimationMeshObject : public MeshObject
 {
 public:
@@ -30,6 +32,17 @@ public:
     bool bIsSkinned = false;
 };
 
+#define ANIMATION_ALL_BONES 0x7fffffff
+#define ANIMATION_NEVER_EVALUATED 0x3fffffff
+
+// Animation level of detail used from the distance to the camera on
+struct AnimationLod
+{
+    float distance;
+    int updateInterval; // pose is evaluated every this many frames
+    int boneDepth;      // nodes deeper in the hierarchy keep the pose they had
+};
+
 class ComponentMeshGroup : public Component
 {
 public:
@@ -37,8 +50,24 @@ public:
     EXPORT ~ComponentMeshGroup();
 
     EXPORT void onRenderQueue(Renderer *renderer) override final;
+
+    // Moves tracks, the pose is blended later by the scene together with poses of other groups
     EXPORT void onProcess(float delta) override final;
 
+    // Blends tracks into the pose buffers, only touches this group, so groups can be evaluated on different threads
+    EXPORT void evaluatePose();
+
+    // Puts the pose onto nodes, between evaluations it is interpolated from the pose shown before the last one
+    EXPORT void commitPose();
+
+    // Far groups evaluate fewer bones less often, the pose follows the tracks an interval late then
+    // Groups whose culling spheres were out of view last frame don't evaluate at all
+    EXPORT void addAnimationLod(float distance, int updateInterval, int boneDepth = ANIMATION_ALL_BONES);
+    inline void clearAnimationLods() { lods.clear(); }
+
+    inline bool isEvaluatingPose() { return bEvaluatePose; }
+    inline int getEvaluatedBones() { return evaluatedBones; }
+
     EXPORT void setDebugBonesView(bool bViewBones, bool bViewCullingSpheres);
 
     // all MeshObjects will be recreated with meshes and structure for this mesh group component
@@ -53,11 +82,39 @@ protected:
     std::vector<AnimationMeshObject *> list;
     std::vector<AnimationMeshObject *> bonesList;
     std::vector<AnimationTrack *> tracks;
+
+    // Index of the parent of every node of the list in the same list or -1, and the amount of parents above it
+    std::vector<int> nodeParents;
+    std::vector<int> nodeDepths;
     std::vector<BoneTransform> boneTransforms;
     Material *material = nullptr;
+
+    // Blended transformation of every node of the list, sized when the list is set
+    std::vector<Vector3> posePositions;
+    std::vector<Quat> poseRotations;
+    std::vector<Vector3> poseScales;
+
+    // Pose shown when the current one was evaluated, commits move from it to the current one
+    std::vector<Vector3> previousPositions;
+    std::vector<Quat> previousRotations;
+    std::vector<Vector3> previousScales;
+
+    std::vector<AnimationLod> lods;
+    int updateInterval = 1;
+    int boneDepth = ANIMATION_ALL_BONES;
+    int framesSinceEvaluation = ANIMATION_NEVER_EVALUATED;
+    int evaluatedBones = 0;
+    float committedBlend = 1.0f;
+    bool bEvaluatePose = true;
+    bool bSnapPose = true;
+
+    // Set by the last render, groups without meshes are always in view
+    bool bInFrustum = true;
     
     bool bViewBones = false;
     bool bViewCullingSpheres = false;
 
     void destroyList();
+    void bindTrack(AnimationTrack *track);
+    void selectAnimationLod(Scene *scene);
 };
\ No newline at end of file
@@ -42,6 +42,16 @@ AnimationTarget *Animation::getTargetByName(const std::string &targetName)
     return nullptr;
 }
 
+int Animation::getTargetIndex(const std::string &targetName)
+{
+    for (int i = 0; i < (int)targets.size(); i++)
+    {
+        if (targets[i]->getTargetName() == targetName)
+            return i;
+    }
+    return -1;
+}
+
 bool Animation::getAnimationTransformation(const std::string &name, float timeStamp, Entity *entity)
 {
     for (auto &target : targets)
@@ -19,6 +19,11 @@ public:
     EXPORT AnimationTarget *createAnimationTarget(const std::string &targetName);
     EXPORT AnimationTarget *getTargetByName(const std::string &targetName);
 
+    // Index stays the same while the animation lives, -1 if there is no such target
+    EXPORT int getTargetIndex(const std::string &targetName);
+    inline AnimationTarget *getTarget(int index) { return targets[index]; }
+    inline int getTargetsAmount() { return (int)targets.size(); }
+
     EXPORT bool getAnimationTransformation(const std::string &name, float timeStamp, Entity *entity);
 
     EXPORT void recalcAnimationLength();
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "animationMask.h"
+
+AnimationMask::AnimationMask(float defaultWeight)
+{
+    this->defaultWeight = defaultWeight;
+}
+
+AnimationMask::~AnimationMask()
+{
+}
+
+void AnimationMask::setWeight(const std::string &nodeName, float weight, bool bIncludeChildren)
+{
+    revision++;
+    for (auto &entry : entries)
+    {
+        if (entry.nodeName == nodeName)
+        {
+            entry.weight = weight;
+            entry.bIncludeChildren = bIncludeChildren;
+            return;
+        }
+    }
+    entries.push_back({nodeName, weight, bIncludeChildren});
+}
+
+void AnimationMask::resolve(const std::vector<std::string *> &nodeNames, const std::vector<int> &nodeParents, std::vector<float> *weights)
+{
+    int size = (int)nodeNames.size();
+
+    // Entry set right on the node or -1
+    std::vector<int> nodeEntries(size, -1);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < (int)entries.size(); j++)
+        {
+            if (entries[j].nodeName == *nodeNames[i])
+            {
+                nodeEntries[i] = j;
+                break;
+            }
+        }
+    }
+
+    weights->assign(size, defaultWeight);
+    for (int i = 0; i < size; i++)
+    {
+        if (nodeEntries[i] != -1)
+        {
+            (*weights)[i] = entries[nodeEntries[i]].weight;
+            continue;
+        }
+
+        // Walking up is limited by the amount of nodes, so a broken hierarchy can't loop forever
+        int parent = nodeParents[i];
+        for (int depth = 0; parent != -1 && depth < size; depth++)
+        {
+            int entry = nodeEntries[parent];
+            if (entry != -1)
+            {
+                if (entries[entry].bIncludeChildren)
+                    (*weights)[i] = entries[entry].weight;
+                break;
+            }
+            parent = nodeParents[parent];
+        }
+    }
+}
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include <string>
+#include <vector>
+
+struct AnimationMaskEntry
+{
+    std::string nodeName;
+    float weight;
+    bool bIncludeChildren;
+};
+
+// Weights of nodes a track affects, like upper body for a track that only aims a weapon
+// Names are resolved to node indices when the mask is given to a track, not while blending
+// Every change bumps the revision, tracks using the mask resolve it again on their next process
+class AnimationMask
+{
+public:
+    EXPORT AnimationMask(float defaultWeight = 0.0f);
+
+    inline void destroy() { delete this; };
+
+    // Children that have no weight of their own take it from the closest parent that has it
+    EXPORT void setWeight(const std::string &nodeName, float weight, bool bIncludeChildren = true);
+
+    // Weight of every node of the list, parents are indices in the same list or -1
+    EXPORT void resolve(const std::vector<std::string *> &nodeNames, const std::vector<int> &nodeParents, std::vector<float> *weights);
+
+    inline void setDefaultWeight(float defaultWeight)
+    {
+        this->defaultWeight = defaultWeight;
+        revision++;
+    }
+    inline float getDefaultWeight() { return defaultWeight; }
+    inline unsigned int getRevision() { return revision; }
+
+protected:
+    EXPORT ~AnimationMask();
+
+    std::vector<AnimationMaskEntry> entries;
+    float defaultWeight = 0.0f;
+    unsigned int revision = 0;
+};
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "animationTarget.h"
+#include <algorithm>
 
 AnimationTarget::AnimationTarget(const std::string targetName)
 {
@@ -10,54 +11,93 @@ AnimationTarget::AnimationTarget(const std::string targetName)
 
 float AnimationTarget::getAnimationTimeLength()
 {
-    if (!keys.empty())
+    if (!times.empty())
     {
-        return keys.at(keys.size() - 1).timeStamp;
+        return times.back();
     }
     return 0.0f;
 }
 
 void AnimationTarget::addKey(AnimationKeyTranform keyTransform)
 {
-    keys.push_back(keyTransform);
+    int index = (int)(std::upper_bound(times.begin(), times.end(), keyTransform.timeStamp) - times.begin());
+    times.insert(times.begin() + index, keyTransform.timeStamp);
+    positions.insert(positions.begin() + index, keyTransform.position);
+    rotations.insert(rotations.begin() + index, Quat(keyTransform.rotation));
+    scales.insert(scales.begin() + index, keyTransform.scale);
 }
 
 void AnimationTarget::getTransformByTime(float timeStamp, Entity *entity)
 {
-    int size = keys.size();
+    int cursor = 0;
+    Vector3 position, scale;
+    Quat rotation;
+    if (sample(timeStamp, &cursor, &position, &rotation, &scale))
+    {
+        entity->setPosition(position);
+        entity->setRotation(rotation);
+        entity->setScale(scale);
+    }
+}
+
+void AnimationTarget::getTransformByTimeFixedFrame(float timeStamp, Entity *entity)
+{
+    int size = times.size();
     for (int i = 0; i < size; i++)
     {
-        if (timeStamp < keys[i].timeStamp)
+        if (timeStamp <= times[i])
         {
-            if (i == 0)
-            {
-                entity->setPosition(keys[i].position);
-                entity->setRotation(keys[i].rotation);
-                entity->setScale(keys[i].scale);
-            }
-            else
-            {
-                float time = (timeStamp - keys[i - 1].timeStamp) / (keys[i].timeStamp - keys[i - 1].timeStamp);
-                entity->setPosition(keys[i - 1].position * (1.0f - time) + keys[i].position * time);
-                entity->setRotation(keys[i - 1].rotation * (1.0f - time) + keys[i].rotation * time);
-                entity->setScale(keys[i - 1].scale * (1.0f - time) + keys[i].scale * time);
-            }
+            entity->setPosition(positions[i]);
+            entity->setRotation(rotations[i]);
+            entity->setScale(scales[i]);
             break;
         }
     }
 }
 
-void AnimationTarget::getTransformByTimeFixedFrame(float timeStamp, Entity *entity)
+int AnimationTarget::findKey(float timeStamp, int *cursor)
 {
-    int size = keys.size();
-    for (int i = 0; i < size; i++)
+    const float *keys = times.data();
+    int size = (int)times.size();
+    int key = *cursor;
+
+    // Same pair of keys as the last time or the next one
+    for (int i = 0; i < 2 && key <= size; i++, key++)
     {
-        if (timeStamp <= keys[i].timeStamp)
+        if ((key == 0 || keys[key - 1] <= timeStamp) && (key == size || timeStamp < keys[key]))
         {
-            entity->setPosition(keys[i].position);
-            entity->setRotation(keys[i].rotation);
-            entity->setScale(keys[i].scale);
-            break;
+            *cursor = key;
+            return key;
         }
     }
-}
\ No newline at end of file
+
+    key = (int)(std::upper_bound(keys, keys + size, timeStamp) - keys);
+    *cursor = key;
+    return key;
+}
+
+bool AnimationTarget::sample(float timeStamp, int *cursor, Vector3 *position, Quat *rotation, Vector3 *scale)
+{
+    int size = (int)times.size();
+    if (size == 0)
+        return false;
+
+    int key = findKey(timeStamp, cursor);
+    if (key == 0 || key == size)
+    {
+        // Time out of the keys holds the closest one
+        int index = key == 0 ? 0 : size - 1;
+        *position = positions[index];
+        *rotation = rotations[index];
+        *scale = scales[index];
+        return true;
+    }
+
+    float time = (timeStamp - times[key - 1]) / (times[key] - times[key - 1]);
+    *position = positions[key - 1] * (1.0f - time) + positions[key] * time;
+    const Quat &from = rotations[key - 1];
+    Quat to = glm::dot(from, rotations[key]) < 0.0f ? -rotations[key] : rotations[key];
+    *rotation = glm::normalize(from * (1.0f - time) + to * time);
+    *scale = scales[key - 1] * (1.0f - time) + scales[key] * time;
+    return true;
+}
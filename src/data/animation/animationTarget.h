@@ -6,6 +6,7 @@
 #include "data/entity.h"
 #include "utils/utils.h"
 #include <string>
+#include <vector>
 
 // Time in timestamp is 1.0 = 1000 ms or 1 second
 // Due to float precision sweat spot
@@ -30,12 +31,33 @@ public:
     // picks static
     EXPORT void getTransformByTimeFixedFrame(float timeStamp, Entity *entity);
 
+    // Index of the first key after the time stamp, amount of keys if there is none
+    // Cursor keeps the key found last time, time that moved forward a little finds its key right next to it
+    EXPORT int findKey(float timeStamp, int *cursor);
+
+    // Interpolates between 2 frames without going through entity, false if there are no keys
+    // Rotations are normalized lerps of the closer pair of quaternions
+    EXPORT bool sample(float timeStamp, int *cursor, Vector3 *position, Quat *rotation, Vector3 *scale);
+
     inline bool isName(std::string targetName) { return this->targetName == targetName; }
     inline std::string getTargetName() { return targetName; }
+    inline int getKeysAmount() { return (int)times.size(); }
+
+    // First key is the pose additive tracks are relative to
+    inline const Vector3 &getKeyPosition(int key) { return positions[key]; }
+    inline const Quat &getKeyRotation(int key) { return rotations[key]; }
+    inline const Vector3 &getKeyScale(int key) { return scales[key]; }
 
+    // Keys may come in any order, they are put in place by their time
+    // Euler rotation of the key is turned into quaternion here, so sampling never converts it
     void addKey(AnimationKeyTranform keyTransform);
 
 protected:
     std::string targetName;
-    std::vector<AnimationKeyTranform> keys;
-};
\ No newline at end of file
+
+    // Keys sorted by time, every channel in its own array
+    std::vector<float> times;
+    std::vector<Vector3> positions;
+    std::vector<Quat> rotations;
+    std::vector<Vector3> scales;
+};
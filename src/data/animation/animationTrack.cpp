@@ -43,6 +43,10 @@ void AnimationTrack::setWeight(float weight)
 
 void AnimationTrack::process(float delta)
 {
+    // Pose is evaluated after processing, so weights changed on the mask since the last frame are used by it
+    if (mask && mask->getRevision() != maskRevision)
+        setMask(mask);
+
     if (this->bIsPlaying)
     {
         this->playTime += delta * speed;
@@ -66,25 +70,53 @@ void AnimationTrack::process(float delta)
     }
 }
 
-float AnimationTrack::getNodeWeight(const std::string &name)
+void AnimationTrack::bind(const std::vector<std::string *> &nodeNames, const std::vector<int> &nodeParents)
 {
-    auto animator = animation->getTargetByName(name);
-    if (animator)
-        return weight;
-    return 0.0f;
+    this->nodeNames = nodeNames;
+    this->nodeParents = nodeParents;
+
+    nodeTargets.clear();
+    nodeCursors.assign(nodeNames.size(), 0);
+    for (auto &name : nodeNames)
+    {
+        int index = animation->getTargetIndex(*name);
+        nodeTargets.push_back(index != -1 ? animation->getTarget(index) : nullptr);
+    }
+    setMask(mask);
 }
 
-void AnimationTrack::addTransformation(float totalWeight, const std::string &nodeName, Vector3 *position, Quat *rotation, Vector3 *scale)
+void AnimationTrack::setMask(AnimationMask *mask)
 {
-    auto animator = animation->getTargetByName(nodeName);
-    if (animator && totalWeight > 0.0f && weight > 0.0f)
+    this->mask = mask;
+    if (mask)
     {
-        float dWeight = weight / totalWeight;
-
-        Entity entity;
-        animator->getTransformByTime(playTime, &entity);
-        *position += entity.getPosition() * dWeight;
-        *rotation = glm::slerp(*rotation, entity.getRotation(), dWeight);
-        *scale += entity.getScale() * dWeight;
+        maskRevision = mask->getRevision();
+        mask->resolve(nodeNames, nodeParents, &nodeMaskWeights);
     }
-}
\ No newline at end of file
+    else
+        nodeMaskWeights.assign(nodeNames.size(), 1.0f);
+}
+
+bool AnimationTrack::sample(int node, Vector3 *position, Quat *rotation, Vector3 *scale)
+{
+    auto animator = nodeTargets[node];
+    return animator && animator->sample(playTime, &nodeCursors[node], position, rotation, scale);
+}
+
+void AnimationTrack::addAdditive(int node, Vector3 *position, Quat *rotation, Vector3 *scale)
+{
+    float nodeWeight = getNodeWeight(node);
+    Vector3 keyPosition, keyScale;
+    Quat keyRotation;
+    if (nodeWeight <= 0.0f || !sample(node, &keyPosition, &keyRotation, &keyScale))
+        return;
+
+    auto animator = nodeTargets[node];
+    Quat difference = glm::inverse(animator->getKeyRotation(0)) * keyRotation;
+    if (difference.w < 0.0f)
+        difference = -difference;
+
+    *position += (keyPosition - animator->getKeyPosition(0)) * nodeWeight;
+    *rotation = glm::normalize(*rotation * glm::normalize(Quat(1.0f, 0.0f, 0.0f, 0.0f) * (1.0f - nodeWeight) + difference * nodeWeight));
+    *scale *= Vector3(1.0f) + (keyScale / animator->getKeyScale(0) - Vector3(1.0f)) * nodeWeight;
+}
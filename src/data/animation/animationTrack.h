@@ -4,6 +4,13 @@
 #pragma once
 #include "utils/utils.h"
 #include "animation.h"
+#include "animationMask.h"
+
+enum class AnimationBlendMode
+{
+    Override, // Tracks of a layer are blended together and replace the pose below by their total weight
+    Additive, // Difference from the first key of the animation is added on top of the pose below
+};
 
 class AnimationTrack
 {
@@ -15,9 +22,28 @@ public:
     EXPORT void setWeight(float weight);
     EXPORT void process(float delta);
 
-    float getNodeWeight(const std::string &name);
+    // Finds targets and mask weights for nodes of the mesh group once, after that nodes are only referred by their index in this list
+    // Parents are indices in the same list or -1
+    EXPORT void bind(const std::vector<std::string *> &nodeNames, const std::vector<int> &nodeParents);
+
+    // Nodes out of the mask keep the pose of lower layers, nullptr affects all the nodes
+    // Later changes of the mask are picked up by process
+    EXPORT void setMask(AnimationMask *mask);
+    inline AnimationMask *getMask() { return mask; }
+
+    // Layers are applied from the lowest one, tracks of the same layer are blended together
+    inline void setLayer(int layer) { this->layer = layer; }
+    inline int getLayer() { return layer; }
+    inline void setBlendMode(AnimationBlendMode blendMode) { this->blendMode = blendMode; }
+    inline AnimationBlendMode getBlendMode() { return blendMode; }
+
+    inline float getNodeWeight(int node) { return nodeTargets[node] ? weight * nodeMaskWeights[node] : 0.0f; }
 
-    EXPORT void addTransformation(float totalWeight, const std::string &nodeName, Vector3 *position, Quat *rotation, Vector3 *scale);
+    // Transformation of the node at the current time, false if the animation doesn't move it
+    EXPORT bool sample(int node, Vector3 *position, Quat *rotation, Vector3 *scale);
+
+    // Adds the difference from the first key scaled by the node weight
+    EXPORT void addAdditive(int node, Vector3 *position, Quat *rotation, Vector3 *scale);
 
     inline bool isPlaying() { return bIsPlaying; }
     inline bool isLooping() { return bIsLooping; }
@@ -36,4 +62,18 @@ protected:
     float targetWeight = 0.0f;
     float speed = 1.0f;
     float weightSwitchSpeed = 0.0f;
+
+    int layer = 0;
+    AnimationBlendMode blendMode = AnimationBlendMode::Override;
+    AnimationMask *mask = nullptr;
+    unsigned int maskRevision = 0;
+
+    // Target of every bound node or nullptr, with the key it was sampled at last time
+    std::vector<AnimationTarget *> nodeTargets;
+    std::vector<int> nodeCursors;
+    std::vector<float> nodeMaskWeights;
+
+    // Bound nodes, so the mask is resolved again when its revision changes
+    std::vector<std::string *> nodeNames;
+    std::vector<int> nodeParents;
 };
\ No newline at end of file
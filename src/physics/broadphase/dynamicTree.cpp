@@ -0,0 +1,277 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "dynamicTree.h"
+#include <algorithm>
+
+DynamicTree::DynamicTree()
+{
+}
+
+int DynamicTree::createProxy(const AABB &aabb, void *userData)
+{
+    int proxy = allocateNode();
+
+    DynamicTreeNode &node = nodes[proxy];
+    node.aabb = AABB(aabb.start - Vector3(margin), aabb.end + Vector3(margin));
+    node.userData = userData;
+    node.height = 0;
+
+    insertLeaf(proxy);
+    proxiesAmount++;
+    return proxy;
+}
+
+void DynamicTree::destroyProxy(int proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+    proxiesAmount--;
+}
+
+bool DynamicTree::moveProxy(int proxy, const AABB &aabb)
+{
+    if (nodes[proxy].aabb.contains(aabb))
+        return false;
+
+    removeLeaf(proxy);
+    nodes[proxy].aabb = AABB(aabb.start - Vector3(margin), aabb.end + Vector3(margin));
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicTree::clear()
+{
+    nodes.clear();
+    root = DYNAMIC_TREE_NULL;
+    freeList = DYNAMIC_TREE_NULL;
+    proxiesAmount = 0;
+}
+
+int DynamicTree::allocateNode()
+{
+    int nodeId;
+    if (freeList != DYNAMIC_TREE_NULL)
+    {
+        nodeId = freeList;
+        freeList = nodes[nodeId].parent;
+    }
+    else
+    {
+        nodeId = (int)nodes.size();
+        nodes.emplace_back();
+    }
+
+    DynamicTreeNode &node = nodes[nodeId];
+    node.userData = nullptr;
+    node.parent = DYNAMIC_TREE_NULL;
+    node.left = DYNAMIC_TREE_NULL;
+    node.right = DYNAMIC_TREE_NULL;
+    node.height = 0;
+    return nodeId;
+}
+
+void DynamicTree::freeNode(int nodeId)
+{
+    nodes[nodeId].parent = freeList;
+    nodes[nodeId].height = -1;
+    freeList = nodeId;
+}
+
+void DynamicTree::insertLeaf(int leaf)
+{
+    if (root == DYNAMIC_TREE_NULL)
+    {
+        root = leaf;
+        nodes[root].parent = DYNAMIC_TREE_NULL;
+        return;
+    }
+
+    // Find the best sibling by surface area heuristic
+    AABB leafAABB = nodes[leaf].aabb;
+    int index = root;
+    while (!nodes[index].isLeaf())
+    {
+        int left = nodes[index].left;
+        int right = nodes[index].right;
+
+        float area = nodes[index].aabb.getSurfaceArea();
+        float combinedArea = AABB::combine(nodes[index].aabb, leafAABB).getSurfaceArea();
+
+        // Cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float costLeft = AABB::combine(leafAABB, nodes[left].aabb).getSurfaceArea() + inheritanceCost;
+        if (!nodes[left].isLeaf())
+            costLeft -= nodes[left].aabb.getSurfaceArea();
+
+        float costRight = AABB::combine(leafAABB, nodes[right].aabb).getSurfaceArea() + inheritanceCost;
+        if (!nodes[right].isLeaf())
+            costRight -= nodes[right].aabb.getSurfaceArea();
+
+        if (cost < costLeft && cost < costRight)
+            break;
+
+        index = costLeft < costRight ? left : right;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].aabb = AABB::combine(leafAABB, nodes[sibling].aabb);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != DYNAMIC_TREE_NULL)
+    {
+        if (nodes[oldParent].left == sibling)
+            nodes[oldParent].left = newParent;
+        else
+            nodes[oldParent].right = newParent;
+    }
+    else
+        root = newParent;
+
+    // Walk back up fixing heights and bounds
+    index = nodes[leaf].parent;
+    while (index != DYNAMIC_TREE_NULL)
+    {
+        rotate(index);
+
+        int left = nodes[index].left;
+        int right = nodes[index].right;
+        nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+        nodes[index].aabb = AABB::combine(nodes[left].aabb, nodes[right].aabb);
+
+        index = nodes[index].parent;
+    }
+}
+
+void DynamicTree::removeLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = DYNAMIC_TREE_NULL;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent != DYNAMIC_TREE_NULL)
+    {
+        // Destroy parent and connect sibling to grand parent
+        if (nodes[grandParent].left == parent)
+            nodes[grandParent].left = sibling;
+        else
+            nodes[grandParent].right = sibling;
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        int index = grandParent;
+        while (index != DYNAMIC_TREE_NULL)
+        {
+            rotate(index);
+
+            int left = nodes[index].left;
+            int right = nodes[index].right;
+            nodes[index].aabb = AABB::combine(nodes[left].aabb, nodes[right].aabb);
+            nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+
+            index = nodes[index].parent;
+        }
+    }
+    else
+    {
+        root = sibling;
+        nodes[sibling].parent = DYNAMIC_TREE_NULL;
+        freeNode(parent);
+    }
+}
+
+void DynamicTree::rotate(int iA)
+{
+    DynamicTreeNode &A = nodes[iA];
+    if (A.height < 2)
+        return;
+
+    int iB = A.left;
+    int iC = A.right;
+    DynamicTreeNode &B = nodes[iB];
+    DynamicTreeNode &C = nodes[iC];
+
+    // Swapping one child with a grandchild from the other side changes only the area of the middle node
+    // Pick the swap that shrinks it the most, or nothing if none of them helps
+    float bestArea = 0.0f;
+    int bestChild = DYNAMIC_TREE_NULL, bestGrandChild = DYNAMIC_TREE_NULL, middle = DYNAMIC_TREE_NULL;
+
+    if (!C.isLeaf())
+    {
+        float area = C.aabb.getSurfaceArea();
+        float areaBF = AABB::combine(B.aabb, nodes[C.right].aabb).getSurfaceArea() - area;
+        float areaBG = AABB::combine(B.aabb, nodes[C.left].aabb).getSurfaceArea() - area;
+        if (areaBF < bestArea)
+        {
+            bestArea = areaBF;
+            bestChild = iB;
+            bestGrandChild = C.left;
+            middle = iC;
+        }
+        if (areaBG < bestArea)
+        {
+            bestArea = areaBG;
+            bestChild = iB;
+            bestGrandChild = C.right;
+            middle = iC;
+        }
+    }
+
+    if (!B.isLeaf())
+    {
+        float area = B.aabb.getSurfaceArea();
+        float areaCD = AABB::combine(C.aabb, nodes[B.right].aabb).getSurfaceArea() - area;
+        float areaCE = AABB::combine(C.aabb, nodes[B.left].aabb).getSurfaceArea() - area;
+        if (areaCD < bestArea)
+        {
+            bestArea = areaCD;
+            bestChild = iC;
+            bestGrandChild = B.left;
+            middle = iB;
+        }
+        if (areaCE < bestArea)
+        {
+            bestArea = areaCE;
+            bestChild = iC;
+            bestGrandChild = B.right;
+            middle = iB;
+        }
+    }
+
+    if (middle == DYNAMIC_TREE_NULL)
+        return;
+
+    // Child takes the place of grandchild and the other way around
+    DynamicTreeNode &M = nodes[middle];
+    if (A.left == bestChild)
+        A.left = bestGrandChild;
+    else
+        A.right = bestGrandChild;
+    if (M.left == bestGrandChild)
+        M.left = bestChild;
+    else
+        M.right = bestChild;
+    nodes[bestGrandChild].parent = iA;
+    nodes[bestChild].parent = middle;
+
+    M.aabb = AABB::combine(nodes[M.left].aabb, nodes[M.right].aabb);
+    M.height = 1 + std::max(nodes[M.left].height, nodes[M.right].height);
+}
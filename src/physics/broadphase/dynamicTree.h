@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+#include "utils/traversalStack.h"
+#include "rayPacket.h"
+#include <vector>
+
+#define DYNAMIC_TREE_NULL -1
+// Traversal stack entries kept in place, deeper trees move it to the heap
+#define DYNAMIC_TREE_STACK_SIZE 256
+
+struct DynamicTreeNode
+{
+    // Fattened bounds for leaves, union of children for branches
+    AABB aabb;
+    void *userData;
+
+    // Parent for nodes in use, next free node otherwise
+    int parent;
+    int left;
+    int right;
+
+    // Leaves have height 0, free nodes -1
+    int height;
+
+    inline bool isLeaf() const { return left == DYNAMIC_TREE_NULL; }
+};
+
+// Dynamic bounding volume tree with fattened leaves
+// Erin Catto - Dynamic AABB Tree, Box2D
+// Tree rotations - Kopta et al. Fast, Effective BVH Updates for Animated Scenes
+class DynamicTree
+{
+public:
+    EXPORT DynamicTree();
+
+    // Returns proxy id that stays the same while the proxy exists
+    EXPORT int createProxy(const AABB &aabb, void *userData);
+    EXPORT void destroyProxy(int proxy);
+
+    // Reinserts the proxy if aabb went out of its fattened bounds, returns true in that case
+    EXPORT bool moveProxy(int proxy, const AABB &aabb);
+
+    EXPORT void clear();
+
+    // Calls callback(int proxy, void *userData) for every leaf overlapping aabb
+    // Traversal stops when callback returns false
+    template <typename T>
+    inline void query(const AABB &aabb, T callback) const
+    {
+        if (root == DYNAMIC_TREE_NULL)
+            return;
+
+        TraversalStack<int, DYNAMIC_TREE_STACK_SIZE> stack;
+        stack.push(root);
+
+        while (!stack.isEmpty())
+        {
+            int nodeId = stack.pop();
+            const DynamicTreeNode &node = nodes[nodeId];
+            if (!node.aabb.test(aabb))
+                continue;
+
+            if (node.isLeaf())
+            {
+                if (!callback(nodeId, node.userData))
+                    return;
+            }
+            else
+            {
+                stack.push(node.left);
+                stack.push(node.right);
+            }
+        }
+    }
+
+    // Calls callback(int proxy, void *userData, int rayMask) for every leaf some rays of the packet cross
+    // Nodes are tested when taken from the stack, so rays shortened by callback skip them
+    template <typename T>
+    inline void queryRays(const RayPacket &packet, T callback) const
+    {
+        if (root == DYNAMIC_TREE_NULL || packet.mask == 0)
+            return;
+
+        struct Entry
+        {
+            int nodeId;
+            int rayMask;
+        };
+        TraversalStack<Entry, DYNAMIC_TREE_STACK_SIZE> stack;
+        stack.push({root, packet.mask});
+
+        // Children closer to the first ray's origin are visited first, so first hit rays get short early
+        int first = 0;
+        while (!(packet.mask & (1 << first)))
+            first++;
+        Vector3 origin(packet.originX[first], packet.originY[first], packet.originZ[first]);
+
+        while (!stack.isEmpty())
+        {
+            Entry entry = stack.pop();
+            const DynamicTreeNode &node = nodes[entry.nodeId];
+            int rayMask = packet.test(node.aabb, entry.rayMask);
+            if (!rayMask)
+                continue;
+
+            if (node.isLeaf())
+                callback(entry.nodeId, node.userData, rayMask);
+            else
+            {
+                int closer = node.left, further = node.right;
+                if (glm::length2(nodes[further].aabb.getCenter() - origin) < glm::length2(nodes[closer].aabb.getCenter() - origin))
+                    std::swap(closer, further);
+                stack.push({further, rayMask});
+                stack.push({closer, rayMask});
+            }
+        }
+    }
+
+    inline const AABB &getFatAABB(int proxy) const { return nodes[proxy].aabb; }
+    inline void *getUserData(int proxy) const { return nodes[proxy].userData; }
+    inline int getProxiesAmount() const { return proxiesAmount; }
+    inline int getHeight() const { return root == DYNAMIC_TREE_NULL ? 0 : nodes[root].height; }
+
+    inline void setMargin(float margin) { this->margin = margin; }
+    inline float getMargin() const { return margin; }
+
+protected:
+    int allocateNode();
+    void freeNode(int nodeId);
+
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+
+    // Swaps a child with a grandchild if that reduces surface area of the tree
+    // Keeps tree quality for incremental updates, balancing by height alone degrades queries badly
+    void rotate(int nodeId);
+
+    std::vector<DynamicTreeNode> nodes;
+    int root = DYNAMIC_TREE_NULL;
+    int freeList = DYNAMIC_TREE_NULL;
+    int proxiesAmount = 0;
+
+    // How much leaves are extended so small movement doesn't cause reinsertion
+    float margin = 0.05f;
+};
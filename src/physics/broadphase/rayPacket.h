@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RAY_PACKET_SSE
+#include <emmintrin.h>
+#endif
+
+#define RAY_PACKET_SIZE 4
+
+// Up to four rays stored by components, so a box is tested against all of them with one slab test
+// Andrew Kensler - Ray tracing with packets, slab test by Kay and Kajiya
+struct RayPacket
+{
+    alignas(16) float originX[RAY_PACKET_SIZE];
+    alignas(16) float originY[RAY_PACKET_SIZE];
+    alignas(16) float originZ[RAY_PACKET_SIZE];
+    alignas(16) float invDirectionX[RAY_PACKET_SIZE];
+    alignas(16) float invDirectionY[RAY_PACKET_SIZE];
+    alignas(16) float invDirectionZ[RAY_PACKET_SIZE];
+
+    // Part of the segment that is still tested, first hit queries shorten it
+    alignas(16) float maxFraction[RAY_PACKET_SIZE];
+
+    // Bit for every ray in the packet
+    int mask;
+
+    inline void set(const Segment *rays, int amount)
+    {
+        mask = 0;
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            // Unused lanes repeat the first ray and are masked out
+            const Segment &ray = rays[i < amount ? i : 0];
+            Vector3 direction = ray.b - ray.a;
+            originX[i] = ray.a.x;
+            originY[i] = ray.a.y;
+            originZ[i] = ray.a.z;
+            invDirectionX[i] = 1.0f / (fabsf(direction.x) > 1.0e-20f ? direction.x : 1.0e-20f);
+            invDirectionY[i] = 1.0f / (fabsf(direction.y) > 1.0e-20f ? direction.y : 1.0e-20f);
+            invDirectionZ[i] = 1.0f / (fabsf(direction.z) > 1.0e-20f ? direction.z : 1.0e-20f);
+            maxFraction[i] = 1.0f;
+            if (i < amount)
+                mask |= 1 << i;
+        }
+    }
+
+    // Bits of rays from the mask that cross the box before their max fraction
+    inline int test(const AABB &aabb, int rayMask) const
+    {
+#ifdef RAY_PACKET_SSE
+        __m128 tMin = _mm_setzero_ps();
+        __m128 tMax = _mm_load_ps(maxFraction);
+
+        __m128 origin = _mm_load_ps(originX);
+        __m128 invDirection = _mm_load_ps(invDirectionX);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.start.x), origin), invDirection);
+        __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.end.x), origin), invDirection);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+
+        origin = _mm_load_ps(originY);
+        invDirection = _mm_load_ps(invDirectionY);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.start.y), origin), invDirection);
+        t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.end.y), origin), invDirection);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+
+        origin = _mm_load_ps(originZ);
+        invDirection = _mm_load_ps(invDirectionZ);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.start.z), origin), invDirection);
+        t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabb.end.z), origin), invDirection);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+
+        return _mm_movemask_ps(_mm_cmple_ps(tMin, tMax)) & rayMask;
+#else
+        int out = 0;
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            if (!(rayMask & (1 << i)))
+                continue;
+            float tMin = 0.0f, tMax = maxFraction[i];
+            testSlab(aabb.start.x, aabb.end.x, originX[i], invDirectionX[i], tMin, tMax);
+            testSlab(aabb.start.y, aabb.end.y, originY[i], invDirectionY[i], tMin, tMax);
+            testSlab(aabb.start.z, aabb.end.z, originZ[i], invDirectionZ[i], tMin, tMax);
+            if (tMin <= tMax)
+                out |= 1 << i;
+        }
+        return out;
+#endif
+    }
+
+    inline static void testSlab(float start, float end, float origin, float invDirection, float &tMin, float &tMax)
+    {
+        float t1 = (start - origin) * invDirection;
+        float t2 = (end - origin) * invDirection;
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+    }
+};
@@ -0,0 +1,213 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "sweepAndPrune.h"
+#include "physics/physicsBody.h"
+#include <algorithm>
+
+// Starts go before ends at the same value, so flat bounds are active before their end removes them
+// and touching bounds meet in the active list, the same overlap test as for tree pairs decides then
+inline bool _endpointLess(const SweepEndpoint &a, const SweepEndpoint &b)
+{
+    return a.value < b.value || (a.value == b.value && !a.bMax && b.bMax);
+}
+
+SweepAndPrune::SweepAndPrune()
+{
+}
+
+void SweepAndPrune::updateBody(PhysicsBody *body, bool bResting)
+{
+    int proxy = body->getSweepProxy();
+    if (proxy == -1)
+    {
+        if (!freeProxies.empty())
+        {
+            proxy = freeProxies.back();
+            freeProxies.pop_back();
+        }
+        else
+        {
+            proxy = (int)proxies.size();
+            proxies.emplace_back();
+        }
+
+        proxies[proxy].body = body;
+        proxies[proxy].bInUse = true;
+        for (int i = 0; i < 3; i++)
+        {
+            endpoints[i].push_back({0.0f, proxy, false});
+            endpoints[i].push_back({0.0f, proxy, true});
+        }
+
+        body->setSweepProxy(proxy);
+        proxiesAmount++;
+        bNeedsFullSort = true;
+    }
+
+    proxies[proxy].aabb = body->getAABB();
+    proxies[proxy].bResting = bResting;
+}
+
+void SweepAndPrune::removeBody(PhysicsBody *body)
+{
+    int proxy = body->getSweepProxy();
+    if (proxy == -1)
+        return;
+
+    proxies[proxy].body = nullptr;
+    proxies[proxy].bInUse = false;
+    removedProxies.push_back(proxy);
+
+    body->setSweepProxy(-1);
+    proxiesAmount--;
+}
+
+void SweepAndPrune::clear()
+{
+    for (auto &proxy : proxies)
+    {
+        if (proxy.bInUse)
+            proxy.body->setSweepProxy(-1);
+    }
+
+    proxies.clear();
+    freeProxies.clear();
+    removedProxies.clear();
+    for (int i = 0; i < 3; i++)
+        endpoints[i].clear();
+    active.clear();
+    proxiesAmount = 0;
+    bNeedsFullSort = false;
+}
+
+void SweepAndPrune::findPairs(std::vector<PhysicsBody *> *unboundedBodies, std::vector<BodyPair> *list)
+{
+    removeDeadEndpoints();
+    sortEndpoints();
+    chooseSweepAxis();
+
+    active.clear();
+    for (auto &endpoint : endpoints[axis])
+    {
+        SweepProxy &proxy = proxies[endpoint.proxy];
+        if (endpoint.bMax)
+        {
+            int last = active.back();
+            active[proxy.activeIndex] = last;
+            proxies[last].activeIndex = proxy.activeIndex;
+            active.pop_back();
+            continue;
+        }
+
+        for (int other : active)
+        {
+            // Bounds are stored in proxies, cheap rejection before touching the bodies
+            SweepProxy &otherProxy = proxies[other];
+            if ((proxy.bResting && otherProxy.bResting) || !proxy.aabb.test(otherProxy.aabb))
+                continue;
+
+            if (_canCollide(proxy.body, otherProxy.body))
+            {
+                // Same order as tree broadphase gives, awake body goes second
+                if (proxy.bResting)
+                    list->push_back({proxy.body, otherProxy.body});
+                else
+                    list->push_back({otherProxy.body, proxy.body});
+            }
+        }
+
+        proxy.activeIndex = (int)active.size();
+        active.push_back(endpoint.proxy);
+    }
+
+    if (unboundedBodies->empty())
+        return;
+
+    for (auto &proxy : proxies)
+    {
+        if (!proxy.bInUse || proxy.bResting)
+            continue;
+
+        for (auto &other : *unboundedBodies)
+        {
+            if (_canCollide(proxy.body, other))
+                list->push_back({other, proxy.body});
+        }
+    }
+}
+
+void SweepAndPrune::removeDeadEndpoints()
+{
+    if (removedProxies.empty())
+        return;
+
+    for (int i = 0; i < 3; i++)
+    {
+        auto &list = endpoints[i];
+        list.erase(std::remove_if(list.begin(), list.end(), [this](const SweepEndpoint &endpoint)
+                                  { return !proxies[endpoint.proxy].bInUse; }),
+                   list.end());
+    }
+
+    freeProxies.insert(freeProxies.end(), removedProxies.begin(), removedProxies.end());
+    removedProxies.clear();
+}
+
+void SweepAndPrune::sortEndpoints()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        auto &list = endpoints[i];
+        for (auto &endpoint : list)
+        {
+            const AABB &aabb = proxies[endpoint.proxy].aabb;
+            endpoint.value = endpoint.bMax ? aabb.end[i] : aabb.start[i];
+        }
+
+        if (bNeedsFullSort)
+        {
+            std::sort(list.begin(), list.end(), _endpointLess);
+            continue;
+        }
+
+        int size = (int)list.size();
+        for (int j = 1; j < size; j++)
+        {
+            SweepEndpoint endpoint = list[j];
+            int k = j - 1;
+            while (k >= 0 && _endpointLess(endpoint, list[k]))
+            {
+                list[k + 1] = list[k];
+                k--;
+            }
+            list[k + 1] = endpoint;
+        }
+    }
+    bNeedsFullSort = false;
+}
+
+void SweepAndPrune::chooseSweepAxis()
+{
+    if (proxiesAmount < 2)
+        return;
+
+    // Axis with the biggest variance of centers has the least overlapping intervals
+    Vector3 sum = Vector3(0.0f);
+    Vector3 sumSquared = Vector3(0.0f);
+    for (auto &proxy : proxies)
+    {
+        if (!proxy.bInUse)
+            continue;
+        Vector3 center = proxy.aabb.getCenter();
+        sum += center;
+        sumSquared += center * center;
+    }
+
+    Vector3 variance = sumSquared - sum * sum / (float)proxiesAmount;
+    axis = 0;
+    if (variance.y > variance[axis])
+        axis = 1;
+    if (variance.z > variance[axis])
+        axis = 2;
+}
@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+#include "physics/physicsUtils.h"
+#include <vector>
+
+class PhysicsBody;
+
+struct SweepProxy
+{
+    PhysicsBody *body;
+    AABB aabb;
+
+    // Position in the list of open intervals while sweeping
+    int activeIndex;
+
+    // Resting bodies are not tested against each other
+    bool bResting;
+    bool bInUse;
+};
+
+struct SweepEndpoint
+{
+    float value;
+    int proxy;
+    bool bMax;
+};
+
+// Incremental sweep and prune
+// Endpoints of every axis are kept sorted between updates, bodies barely move during substep
+// so insertion sort is close to linear. Sweep goes along the axis where bodies are spread the most
+class SweepAndPrune
+{
+public:
+    EXPORT SweepAndPrune();
+
+    // Adds body or refreshes its bounds
+    EXPORT void updateBody(PhysicsBody *body, bool bResting);
+    EXPORT void removeBody(PhysicsBody *body);
+
+    EXPORT void clear();
+
+    // Sorts endpoints and adds every overlapping pair with at least one awake body to the list
+    // Awake bodies are also tested against unbounded bodies
+    EXPORT void findPairs(std::vector<PhysicsBody *> *unboundedBodies, std::vector<BodyPair> *list);
+
+    inline int getProxiesAmount() const { return proxiesAmount; }
+    inline int getSweepAxis() const { return axis; }
+
+protected:
+    void removeDeadEndpoints();
+    void sortEndpoints();
+    void chooseSweepAxis();
+
+    std::vector<SweepProxy> proxies;
+    std::vector<int> freeProxies;
+
+    // Removed proxies keep their endpoints until next sweep, they can't be reused before that
+    std::vector<int> removedProxies;
+
+    std::vector<SweepEndpoint> endpoints[3];
+
+    // Open intervals during the sweep
+    std::vector<int> active;
+
+    int proxiesAmount = 0;
+    int axis = 0;
+
+    // New endpoints are appended at the end, full sort is faster than insertion in that case
+    bool bNeedsFullSort = false;
+};
@@ -4,25 +4,111 @@
 #pragma once
 #include "collisionManifold.h"
 #include "physicsUtils.h"
+#include "contactCache.h"
 #include <vector>
-#include <thread>
-#include <mutex>
+#include <algorithm>
 
 class PhysicsBody;
 
+// Collisions found by a single job, jobs never share a collector so it doesn't need locking
+// Only the points manifold actually has are stored
 class CollisionCollector
 {
 public:
-    EXPORT inline void addBodyPair(PhysicsBody *a, PhysicsBody *b, CollisionManifold manifold)
+    EXPORT inline void addBodyPair(PhysicsBody *a, PhysicsBody *b, const CollisionManifold &manifold)
     {
-        lock.lock();
-        pairs.push_back({a, b, manifold});
-        lock.unlock();
+        pairs.push_back({a, b, (int)points.size(), manifold.collisionAmount});
+        for (int i = 0; i < manifold.collisionAmount; i++)
+            points.push_back({manifold.pointsOnA[i], manifold.pointsOnB[i], manifold.normal[i], manifold.depth[i], manifold.features[i]});
+    }
+
+    // Appends collisions of another collector, used to join job results after they are done
+    EXPORT inline void merge(const CollisionCollector &collector)
+    {
+        int offset = (int)points.size();
+        int pairsOffset = (int)pairs.size();
+        for (int pair : collector.refreshedPairs)
+            refreshedPairs.push_back(pair + pairsOffset);
+        for (auto &pair : collector.pairs)
+            pairs.push_back({pair.a, pair.b, pair.firstPoint + offset, pair.pointsAmount});
+        points.insert(points.end(), collector.points.begin(), collector.points.end());
+        axes.insert(axes.end(), collector.axes.begin(), collector.axes.end());
+    }
+
+    // Direction from A to B the pair ended the previous substep with
+    inline bool findAxis(PhysicsBody *a, PhysicsBody *b, Vector3 *axis) const { return axisCache && axisCache->find(a, b, axis); }
+
+    // Kept until jobs are done, then they go into the axis cache for the next substep
+    inline void addAxis(PhysicsBody *a, PhysicsBody *b, const Vector3 &axis) { axes.push_back({a, b, axis}); }
+
+    // Pair that barely moved since its manifold was found takes the cached points, false if narrowphase has to run
+    inline bool refreshManifold(PhysicsBody *a, PhysicsBody *b)
+    {
+        if (!manifoldCache)
+            return false;
+        const CachedManifold *cached = manifoldCache->find(a, b);
+        CollisionManifold manifold;
+        if (!cached || !manifoldCache->refresh(cached, &manifold))
+            return false;
+
+        if (manifold.collisionAmount > 0)
+        {
+            refreshedPairs.push_back((int)pairs.size());
+            addBodyPair(cached->a, cached->b, manifold);
+        }
+        Vector3 axis;
+        if (findAxis(cached->a, cached->b, &axis))
+            addAxis(cached->a, cached->b, axis);
+        return true;
+    }
+
+    // Pairs added since firstPair become one pair of a and b, so compound bodies get one manifold from all their shapes
+    // Points go from the deepest and the rest are cut when there are too many, single contact solver solves all of them
+    inline void joinPairs(int firstPair, PhysicsBody *a, PhysicsBody *b)
+    {
+        if ((int)pairs.size() <= firstPair)
+            return;
+
+        int firstPoint = pairs[firstPair].firstPoint;
+        for (int i = firstPair; i < (int)pairs.size(); i++)
+        {
+            if (pairs[i].a == a)
+                continue;
+            for (int p = pairs[i].firstPoint; p < pairs[i].firstPoint + pairs[i].pointsAmount; p++)
+            {
+                std::swap(points[p].pointOnA, points[p].pointOnB);
+                points[p].normal = -points[p].normal;
+            }
+        }
+
+        int pointsAmount = (int)points.size() - firstPoint;
+        int keptAmount = pointsAmount < MAX_POINTS ? pointsAmount : MAX_POINTS;
+        std::partial_sort(points.begin() + firstPoint, points.begin() + firstPoint + keptAmount, points.end(), [](const ContactPoint &left, const ContactPoint &right)
+                          { return left.depth > right.depth; });
+        points.resize(firstPoint + keptAmount);
+        pointsAmount = keptAmount;
+        pairs.resize(firstPair);
+        pairs.push_back({a, b, firstPoint, pointsAmount});
+    }
+
+    inline const ContactPoint &getPoint(const CollisionPair &pair, int index) const { return points[pair.firstPoint + index]; }
+
+    EXPORT inline void clear()
+    {
+        pairs.clear();
+        points.clear();
+        axes.clear();
+        refreshedPairs.clear();
     }
 
-    EXPORT inline void clear() { pairs.clear(); }
     std::vector<CollisionPair> pairs;
+    std::vector<ContactPoint> points;
+    std::vector<PairAxis> axes;
+
+    // Indices of pairs which points came from the manifold cache, in increasing order
+    std::vector<int> refreshedPairs;
 
-protected:
-    std::mutex lock;
-};
\ No newline at end of file
+    // Read only while jobs run, manifold cache is null when manifolds aren't reused
+    const AxisCache *axisCache = nullptr;
+    const ManifoldCache *manifoldCache = nullptr;
+};
@@ -9,197 +9,213 @@
 #include "renderer/renderer.h"
 
 #include <vector>
+#include <cfloat>
 
 HullEdge CollisionDispatcher::meshPolyEdges[6];
 HullPolygon CollisionDispatcher::meshPolygon;
 
+// Polygons of a mesh found near a shape, kept per thread so narrowphase jobs don't allocate
+thread_local std::vector<int> meshPolygonsBuffer;
+
+std::atomic<int> CollisionDispatcher::unsupportedPairs[(int)ShapeCollisionType::Amount][(int)ShapeCollisionType::Amount];
+
 CollisionDispatcher::CollisionDispatcher()
 {
     int amountOfTypes = (int)ShapeCollisionType::Amount;
     for (int a = 0; a < amountOfTypes; a++)
         for (int b = 0; b < amountOfTypes; b++)
-            collectCollisions[a][b] = [](PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector)
+            collectCollisions[a][b] = [](PhysicsBody *a, int aChild, PhysicsBody *b, int bChild, CollisionCollector *collector)
             {
-                printf("Collision of %s with %s is not implemented\n", Shape::getTypeName(a->getType()).c_str(), Shape::getTypeName(b->getType()).c_str());
+                // Pairs are only counted, the warning is printed once for every combination of types
+                ShapeCollisionType typeA = a->getForm()->getShape(aChild)->getType();
+                ShapeCollisionType typeB = b->getForm()->getShape(bChild)->getType();
+                if (unsupportedPairs[(int)typeA][(int)typeB].fetch_add(1, std::memory_order_relaxed) == 0)
+                    printf("Collision of %s with %s is not implemented\n", Shape::getTypeName(typeA).c_str(), Shape::getTypeName(typeB).c_str());
             };
 
-    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *plain, PhysicsBody *sphere, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *plain, int plainChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsPlain(sphere, plain, collector);
+        CollisionDispatcher::collideSphereVsPlain(sphere, sphereChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Plain] = [](PhysicsBody *sphere, PhysicsBody *plain, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Plain] = [](PhysicsBody *sphere, int sphereChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsPlain(sphere, plain, collector);
+        CollisionDispatcher::collideSphereVsPlain(sphere, sphereChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *sphere1, PhysicsBody *sphere2, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *sphere1, int sphere1Child, PhysicsBody *sphere2, int sphere2Child, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsSphere(sphere1, sphere2, collector);
+        CollisionDispatcher::collideSphereVsSphere(sphere1, sphere1Child, sphere2, sphere2Child, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Convex] = [](PhysicsBody *sphere, PhysicsBody *convex, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Convex] = [](PhysicsBody *sphere, int sphereChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsConvex(sphere, convex, collector);
+        CollisionDispatcher::collideSphereVsConvex(sphere, sphereChild, convex, convexChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *convex, PhysicsBody *sphere, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *convex, int convexChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsConvex(sphere, convex, collector);
+        CollisionDispatcher::collideSphereVsConvex(sphere, sphereChild, convex, convexChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Plain] = [](PhysicsBody *OBB, PhysicsBody *plain, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Plain] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsPlain(OBB, plain, collector);
+        CollisionDispatcher::collideOBBVsPlain(OBB, OBBChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::OBB] = [](PhysicsBody *plain, PhysicsBody *OBB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::OBB] = [](PhysicsBody *plain, int plainChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsPlain(OBB, plain, collector);
+        CollisionDispatcher::collideOBBVsPlain(OBB, OBBChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *OBB, PhysicsBody *sphere, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsSphere(OBB, sphere, collector);
+        CollisionDispatcher::collideOBBVsSphere(OBB, OBBChild, sphere, sphereChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::OBB] = [](PhysicsBody *sphere, PhysicsBody *OBB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::OBB] = [](PhysicsBody *sphere, int sphereChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsSphere(OBB, sphere, collector);
+        CollisionDispatcher::collideOBBVsSphere(OBB, OBBChild, sphere, sphereChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *OBB, PhysicsBody *mesh, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsMesh(OBB, mesh, collector);
+        CollisionDispatcher::collideOBBVsMesh(OBB, OBBChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::OBB] = [](PhysicsBody *mesh, PhysicsBody *OBB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::OBB] = [](PhysicsBody *mesh, int meshChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideOBBVsMesh(OBB, mesh, collector);
+        CollisionDispatcher::collideOBBVsMesh(OBB, OBBChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::OBB] = [](PhysicsBody *OBB_A, PhysicsBody *OBB_B, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::OBB] = [](PhysicsBody *OBB_A, int OBB_AChild, PhysicsBody *OBB_B, int OBB_BChild, CollisionCollector *collector)
     {
         // cache of OBB compatible with cache of convex
-        CollisionDispatcher::collideOBBVsOBB(OBB_A, OBB_B, collector);
+        CollisionDispatcher::collideOBBVsOBB(OBB_A, OBB_AChild, OBB_B, OBB_BChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Convex] = [](PhysicsBody *convexA, PhysicsBody *convexB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Convex] = [](PhysicsBody *convexA, int convexAChild, PhysicsBody *convexB, int convexBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsConvex(convexA, convexB, collector);
+        CollisionDispatcher::collideConvexVsConvex(convexA, convexAChild, convexB, convexBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::OBB] = [](PhysicsBody *convex, PhysicsBody *OBB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::OBB] = [](PhysicsBody *convex, int convexChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsOBB(convex, OBB, collector);
+        CollisionDispatcher::collideConvexVsOBB(convex, convexChild, OBB, OBBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Convex] = [](PhysicsBody *OBB, PhysicsBody *convex, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Convex] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsOBB(convex, OBB, collector);
+        CollisionDispatcher::collideConvexVsOBB(convex, convexChild, OBB, OBBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Plain] = [](PhysicsBody *convex, PhysicsBody *plain, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Plain] = [](PhysicsBody *convex, int convexChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsPlain(convex, plain, collector);
+        CollisionDispatcher::collideConvexVsPlain(convex, convexChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Convex] = [](PhysicsBody *plain, PhysicsBody *convex, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Convex] = [](PhysicsBody *plain, int plainChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsPlain(convex, plain, collector);
+        CollisionDispatcher::collideConvexVsPlain(convex, convexChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *convex, PhysicsBody *mesh, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *convex, int convexChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsMesh(convex, mesh, collector);
+        CollisionDispatcher::collideConvexVsMesh(convex, convexChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Convex] = [](PhysicsBody *mesh, PhysicsBody *convex, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Convex] = [](PhysicsBody *mesh, int meshChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideConvexVsMesh(convex, mesh, collector);
+        CollisionDispatcher::collideConvexVsMesh(convex, convexChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *sphere, PhysicsBody *mesh, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *meshA, int meshAChild, PhysicsBody *meshB, int meshBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsMesh(sphere, mesh, collector);
+        CollisionDispatcher::collideMeshVsMesh(meshA, meshAChild, meshB, meshBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *mesh, PhysicsBody *sphere, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *sphere, int sphereChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideSphereVsMesh(sphere, mesh, collector);
+        CollisionDispatcher::collideSphereVsMesh(sphere, sphereChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Plain] = [](PhysicsBody *capsule, PhysicsBody *plain, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *mesh, int meshChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsPlain(capsule, plain, collector);
+        CollisionDispatcher::collideSphereVsMesh(sphere, sphereChild, mesh, meshChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *plain, PhysicsBody *capsule, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Plain] = [](PhysicsBody *capsule, int capsuleChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsPlain(capsule, plain, collector);
+        CollisionDispatcher::collideCapsuleVsPlain(capsule, capsuleChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *capsuleA, PhysicsBody *capsuleB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Plain][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *plain, int plainChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsCapsule(capsuleA, capsuleB, collector);
+        CollisionDispatcher::collideCapsuleVsPlain(capsule, capsuleChild, plain, plainChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *capsule, PhysicsBody *sphere, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *capsuleA, int capsuleAChild, PhysicsBody *capsuleB, int capsuleBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsSphere(capsule, sphere, collector);
+        CollisionDispatcher::collideCapsuleVsCapsule(capsuleA, capsuleAChild, capsuleB, capsuleBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *sphere, PhysicsBody *capsule, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Sphere] = [](PhysicsBody *capsule, int capsuleChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsSphere(capsule, sphere, collector);
+        CollisionDispatcher::collideCapsuleVsSphere(capsule, capsuleChild, sphere, sphereChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *OBB, PhysicsBody *capsule, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Sphere][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *sphere, int sphereChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsOBB(capsule, OBB, collector);
+        CollisionDispatcher::collideCapsuleVsSphere(capsule, capsuleChild, sphere, sphereChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::OBB] = [](PhysicsBody *capsule, PhysicsBody *OBB, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::OBB][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsOBB(capsule, OBB, collector);
+        CollisionDispatcher::collideCapsuleVsOBB(capsule, capsuleChild, OBB, OBBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *convex, PhysicsBody *capsule, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::OBB] = [](PhysicsBody *capsule, int capsuleChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsConvex(capsule, convex, collector);
+        CollisionDispatcher::collideCapsuleVsOBB(capsule, capsuleChild, OBB, OBBChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Convex] = [](PhysicsBody *capsule, PhysicsBody *convex, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Convex][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *convex, int convexChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsConvex(capsule, convex, collector);
+        CollisionDispatcher::collideCapsuleVsConvex(capsule, capsuleChild, convex, convexChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *capsule, PhysicsBody *mesh, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Convex] = [](PhysicsBody *capsule, int capsuleChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsMesh(capsule, mesh, collector);
+        CollisionDispatcher::collideCapsuleVsConvex(capsule, capsuleChild, convex, convexChild, collector);
     };
 
-    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *mesh, PhysicsBody *capsule, CollisionCollector *collector)
+    collectCollisions[(int)ShapeCollisionType::Capsule][(int)ShapeCollisionType::Mesh] = [](PhysicsBody *capsule, int capsuleChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
     {
-        CollisionDispatcher::collideCapsuleVsMesh(capsule, mesh, collector);
+        CollisionDispatcher::collideCapsuleVsMesh(capsule, capsuleChild, mesh, meshChild, collector);
     };
 
+    collectCollisions[(int)ShapeCollisionType::Mesh][(int)ShapeCollisionType::Capsule] = [](PhysicsBody *mesh, int meshChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
+    {
+        CollisionDispatcher::collideCapsuleVsMesh(capsule, capsuleChild, mesh, meshChild, collector);
+    };
+
+    // Triangle is a flat hull, twin edges belong to its back side with the opposite normal
     meshPolyEdges[0].polygon = 0;
     meshPolyEdges[0].a = 0;
     meshPolyEdges[0].b = 1;
-    meshPolyEdges[1].polygon = -1;
+    meshPolyEdges[1].polygon = 1;
     meshPolyEdges[1].a = 1;
     meshPolyEdges[1].b = 0;
     meshPolyEdges[2].polygon = 0;
     meshPolyEdges[2].a = 1;
     meshPolyEdges[2].b = 2;
-    meshPolyEdges[3].polygon = -1;
+    meshPolyEdges[3].polygon = 1;
     meshPolyEdges[3].a = 2;
     meshPolyEdges[3].b = 1;
     meshPolyEdges[4].polygon = 0;
     meshPolyEdges[4].a = 2;
     meshPolyEdges[4].b = 0;
-    meshPolyEdges[5].polygon = -1;
+    meshPolyEdges[5].polygon = 1;
     meshPolyEdges[5].a = 0;
     meshPolyEdges[5].b = 2;
 
@@ -209,13 +225,71 @@ CollisionDispatcher::CollisionDispatcher()
     meshPolygon.points[0] = 0;
     meshPolygon.points[1] = 1;
     meshPolygon.points[2] = 2;
+
+    setNarrowphase(narrowphaseType);
 }
 
-void CollisionDispatcher::collideSphereVsPlain(PhysicsBody *sphere, PhysicsBody *plain, CollisionCollector *collector)
+void CollisionDispatcher::setNarrowphase(NarrowphaseType narrowphaseType)
 {
-    Vector3 sphereCenter = sphere->getCenterOfMass();
-    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(0);
-    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(0);
+    this->narrowphaseType = narrowphaseType;
+    int convex = (int)ShapeCollisionType::Convex;
+    int OBB = (int)ShapeCollisionType::OBB;
+    int capsule = (int)ShapeCollisionType::Capsule;
+
+    if (narrowphaseType == NarrowphaseType::GJK)
+    {
+        collectCollisions[convex][convex] = collideConvexVsConvexGJK;
+        collectCollisions[convex][OBB] = collideConvexVsOBBGJK;
+        collectCollisions[OBB][convex] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideConvexVsOBBGJK(convex, convexChild, OBB, OBBChild, collector);
+        };
+        collectCollisions[capsule][OBB] = collideCapsuleVsOBBGJK;
+        collectCollisions[OBB][capsule] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideCapsuleVsOBBGJK(capsule, capsuleChild, OBB, OBBChild, collector);
+        };
+        collectCollisions[capsule][convex] = collideCapsuleVsConvexGJK;
+        collectCollisions[convex][capsule] = [](PhysicsBody *convex, int convexChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideCapsuleVsConvexGJK(capsule, capsuleChild, convex, convexChild, collector);
+        };
+    }
+    else
+    {
+        collectCollisions[convex][convex] = collideConvexVsConvex;
+        collectCollisions[convex][OBB] = collideConvexVsOBB;
+        collectCollisions[OBB][convex] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideConvexVsOBB(convex, convexChild, OBB, OBBChild, collector);
+        };
+        collectCollisions[capsule][OBB] = collideCapsuleVsOBB;
+        collectCollisions[OBB][capsule] = [](PhysicsBody *OBB, int OBBChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideCapsuleVsOBB(capsule, capsuleChild, OBB, OBBChild, collector);
+        };
+        collectCollisions[capsule][convex] = collideCapsuleVsConvex;
+        collectCollisions[convex][capsule] = [](PhysicsBody *convex, int convexChild, PhysicsBody *capsule, int capsuleChild, CollisionCollector *collector)
+        {
+            CollisionDispatcher::collideCapsuleVsConvex(capsule, capsuleChild, convex, convexChild, collector);
+        };
+    }
+}
+
+int CollisionDispatcher::getUnsupportedPairsAmount()
+{
+    int amount = 0;
+    for (int a = 0; a < (int)ShapeCollisionType::Amount; a++)
+        for (int b = 0; b < (int)ShapeCollisionType::Amount; b++)
+            amount += unsupportedPairs[a][b].load(std::memory_order_relaxed);
+    return amount;
+}
+
+void CollisionDispatcher::collideSphereVsPlain(PhysicsBody *sphere, int sphereChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
+{
+    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(sphereChild);
+    Vector3 sphereCenter = sphereData->center;
+    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(plainChild);
     Plain plainShape = Plain(plainData->normal, plainData->distance);
     float radius = sphereData->radius;
 
@@ -227,18 +301,18 @@ void CollisionDispatcher::collideSphereVsPlain(PhysicsBody *sphere, PhysicsBody
     {
         CollisionManifold manifold;
         Vector3 normal = difference / distance;
-        manifold.addCollisionPoint(Vector3(sphereCenter + normal * radius), point, radius - distance, normal);
+        manifold.addCollisionPoint(Vector3(sphereCenter + normal * radius), point, radius - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(sphere, plain, manifold);
     }
 }
 
-void CollisionDispatcher::collideSphereVsSphere(PhysicsBody *sphereA, PhysicsBody *sphereB, CollisionCollector *collector)
+void CollisionDispatcher::collideSphereVsSphere(PhysicsBody *sphereA, int sphereAChild, PhysicsBody *sphereB, int sphereBChild, CollisionCollector *collector)
 {
-    ShapeSphere *sphereShapeA = (ShapeSphere *)sphereA->getForm()->getSimpleShape();
-    ShapeSphere *sphereShapeB = (ShapeSphere *)sphereB->getForm()->getSimpleShape();
+    ShapeSphere *sphereShapeA = (ShapeSphere *)sphereA->getForm()->getShape(sphereAChild);
+    ShapeSphere *sphereShapeB = (ShapeSphere *)sphereB->getForm()->getShape(sphereBChild);
 
-    Vector3 sphereAPosition = sphereA->getCenterOfMass();
-    Vector3 sphereBPosition = sphereB->getCenterOfMass();
+    Vector3 sphereAPosition = sphereA->getCacheSphere(sphereAChild)->center;
+    Vector3 sphereBPosition = sphereB->getCacheSphere(sphereBChild)->center;
 
     float shapeARadius = sphereShapeA->getRadius();
     float shapeBRadius = sphereShapeB->getRadius();
@@ -251,16 +325,16 @@ void CollisionDispatcher::collideSphereVsSphere(PhysicsBody *sphereA, PhysicsBod
     {
         CollisionManifold manifold;
         Vector3 normal = difference / distance;
-        manifold.addCollisionPoint(Vector3(sphereAPosition + normal * shapeARadius), Vector3(sphereBPosition - normal * shapeBRadius), radiusSumm - distance, normal);
+        manifold.addCollisionPoint(Vector3(sphereAPosition + normal * shapeARadius), Vector3(sphereBPosition - normal * shapeBRadius), radiusSumm - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(sphereA, sphereB, manifold);
     }
 }
 
-void CollisionDispatcher::collideSphereVsMesh(PhysicsBody *sphere, PhysicsBody *mesh, CollisionCollector *collector)
+void CollisionDispatcher::collideSphereVsMesh(PhysicsBody *sphere, int sphereChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
 {
-    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(0);
-    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(0);
+    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(sphereChild);
+    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getShape(meshChild);
+    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(meshChild);
 
     Vector3 center = sphereData->center;
     float radius = sphereData->radius;
@@ -276,18 +350,18 @@ void CollisionDispatcher::collideSphereVsMesh(PhysicsBody *sphere, PhysicsBody *
         CollisionManifold manifold;
         Vector3 normal = difference / distance;
         Vector3 collisionPoint = Vector3(center + normal * radius);
-        manifold.addCollisionPoint(collisionPoint, closest, radius - distance, normal);
+        manifold.addCollisionPoint(collisionPoint, closest, radius - distance, normal, makeContactFeature(0, 0));
 
         collector->addBodyPair(sphere, mesh, manifold);
     }
 }
 
-void CollisionDispatcher::collideSphereVsConvex(PhysicsBody *sphere, PhysicsBody *convex, CollisionCollector *collector)
+void CollisionDispatcher::collideSphereVsConvex(PhysicsBody *sphere, int sphereChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
 {
 
-    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(0);
-    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(0);
+    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(sphereChild);
 
     Vector3 center = sphereData->center;
     float radius = sphereData->radius;
@@ -301,16 +375,16 @@ void CollisionDispatcher::collideSphereVsConvex(PhysicsBody *sphere, PhysicsBody
         CollisionManifold manifold;
         Vector3 normal = difference / distance;
         Vector3 collisionPoint = Vector3(center + normal * radius);
-        manifold.addCollisionPoint(collisionPoint, closest, radius - distance, normal);
+        manifold.addCollisionPoint(collisionPoint, closest, radius - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(sphere, convex, manifold);
     }
 }
 
-void CollisionDispatcher::collideOBBVsPlain(PhysicsBody *OBB, PhysicsBody *plain, CollisionCollector *collector)
+void CollisionDispatcher::collideOBBVsPlain(PhysicsBody *OBB, int OBBChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
 {
-    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(0);
-    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(0);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
+    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(plainChild);
 
     Vector3 &axisX = OBBData->axisX;
     Vector3 &axisY = OBBData->axisY;
@@ -340,6 +414,7 @@ void CollisionDispatcher::collideOBBVsPlain(PhysicsBody *OBB, PhysicsBody *plain
         float n = 0.0f;
         Vector3 c = Vector3(0.0f);
         float depth = 0.0f;
+        int firstCorner = -1, lastCorner = -1;
         for (int i = 0; i < 8; i++)
         {
             Vector3 &p = OBBData->points[i];
@@ -351,24 +426,28 @@ void CollisionDispatcher::collideOBBVsPlain(PhysicsBody *OBB, PhysicsBody *plain
                 c += p;
                 n += 1.0f;
                 depth = fmaxf(glm::length(difference), depth);
+                if (firstCorner == -1)
+                    firstCorner = i;
+                lastCorner = i;
             }
         }
         if (n > 0.0f)
         {
             c /= n;
 
+            // Corners under the plain name the contact, box lying on the same side keeps the same feature
             CollisionManifold manifold;
-            manifold.addCollisionPoint(c, plainShape.getClosestPoint(c), depth, -sideNormal);
+            manifold.addCollisionPoint(c, plainShape.getClosestPoint(c), depth, -sideNormal, makeContactFeature(firstCorner, lastCorner));
             collector->addBodyPair(OBB, plain, manifold);
         }
     }
 }
 
-void CollisionDispatcher::collideOBBVsSphere(PhysicsBody *OBB, PhysicsBody *sphere, CollisionCollector *collector)
+void CollisionDispatcher::collideOBBVsSphere(PhysicsBody *OBB, int OBBChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
 {
-    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(0);
-    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(0);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
+    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(sphereChild);
 
     Vector3 &sphereCenter = sphereData->center;
     float sphereRadius = sphereData->radius;
@@ -380,18 +459,41 @@ void CollisionDispatcher::collideOBBVsSphere(PhysicsBody *OBB, PhysicsBody *sphe
     if (distance < sphereRadius)
     {
         CollisionManifold manifold;
-        Vector3 normal = difference / distance;
-        manifold.addCollisionPoint(sphereCenter + normal * sphereRadius, closestPoint, sphereRadius - distance, normal);
+        Vector3 normal;
+        float depth = sphereRadius - distance;
+        if (distance > 0.000001f)
+            normal = difference / distance;
+        else
+        {
+            // Center got inside the box, it goes out through the closest face
+            Vector3 axes[3] = {OBBData->axisX, OBBData->axisY, OBBData->axisZ};
+            float halfSizes[3] = {OBBShape->getHalfWidth(), OBBShape->getHalfHeight(), OBBShape->getHalfDepth()};
+            Vector3 local = sphereCenter - OBBData->center;
+            float closest = FLT_MAX;
+            for (int i = 0; i < 3; i++)
+            {
+                float projection = glm::dot(local, axes[i]);
+                float toFace = halfSizes[i] - fabsf(projection);
+                if (toFace < closest)
+                {
+                    closest = toFace;
+                    normal = projection < 0.0f ? -axes[i] : axes[i];
+                }
+            }
+            closestPoint = sphereCenter + normal * closest;
+            depth = sphereRadius + closest;
+        }
+        manifold.addCollisionPoint(sphereCenter + normal * sphereRadius, closestPoint, depth, normal, makeContactFeature(0, 0));
         collector->addBodyPair(OBB, sphere, manifold);
     }
 }
 
-void CollisionDispatcher::collideOBBVsMesh(PhysicsBody *OBB, PhysicsBody *mesh, CollisionCollector *collector)
+void CollisionDispatcher::collideOBBVsMesh(PhysicsBody *OBB, int OBBChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
 {
-    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(0);
-    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(0);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
+    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getShape(meshChild);
+    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(meshChild);
 
     Vector3 locOBBVerticies[8];
     Vector3 locOBBNormals[6];
@@ -403,19 +505,29 @@ void CollisionDispatcher::collideOBBVsMesh(PhysicsBody *OBB, PhysicsBody *mesh,
 
     Vector3 OBBCenter = Vector3(meshData->invTransformation * Vector4(OBBData->center, 1.0f));
 
-    int meshPolyAmount = meshShape->getPolygonsAmount();
     auto meshVerticies = meshShape->getVerticies();
     Vector3 meshPolyVerts[3];
 
     CollisionManifold manifold;
 
-    for (int i = 0; i < meshPolyAmount; i++)
+    // Only polygons near the other shape are tested
+    AABB locBounds(locOBBVerticies[0], locOBBVerticies[0]);
+    for (int i = 1; i < 8; i++)
+        locBounds.extend(AABB(locOBBVerticies[i], locOBBVerticies[i]));
+
+    std::vector<int> &nearPolygons = meshPolygonsBuffer;
+    nearPolygons.clear();
+    meshShape->queryPolygons(locBounds, [&nearPolygons](int polygon)
+                             { nearPolygons.push_back(polygon); return true; });
+
+    for (int i : nearPolygons)
     {
         PolygonTriPoints &poly = meshShape->getPolygons()[i];
         meshPolyVerts[0] = meshVerticies[poly.a];
         meshPolyVerts[1] = meshVerticies[poly.b];
         meshPolyVerts[2] = meshVerticies[poly.c];
         Vector3 normal = meshShape->getNormals()[i];
+        Vector3 meshPolyNormals[2] = {normal, -normal};
 
         FaceQuery faceQueryA = queryFaceDirection(
             OBBShape->getPolygons(),
@@ -448,7 +560,7 @@ void CollisionDispatcher::collideOBBVsMesh(PhysicsBody *OBB, PhysicsBody *mesh,
             meshPolyEdges,
             6,
             meshPolyVerts,
-            &normal);
+            meshPolyNormals);
 
         if (edgeQuery.separation > 0.0f)
             continue;
@@ -517,12 +629,12 @@ void CollisionDispatcher::collideOBBVsMesh(PhysicsBody *OBB, PhysicsBody *mesh,
     }
 }
 
-void CollisionDispatcher::collideOBBVsOBB(PhysicsBody *OBB_A, PhysicsBody *OBB_B, CollisionCollector *collector)
+void CollisionDispatcher::collideOBBVsOBB(PhysicsBody *OBB_A, int OBB_AChild, PhysicsBody *OBB_B, int OBB_BChild, CollisionCollector *collector)
 {
-    ShapeOBB *OBBShapeA = (ShapeOBB *)OBB_A->getForm()->getSimpleShape();
-    ShapeOBB *OBBShapeB = (ShapeOBB *)OBB_B->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeOBB *OBBDataA = OBB_A->getCacheOBB(0);
-    PhysicsBodyCacheTypeOBB *OBBDataB = OBB_B->getCacheOBB(0);
+    ShapeOBB *OBBShapeA = (ShapeOBB *)OBB_A->getForm()->getShape(OBB_AChild);
+    ShapeOBB *OBBShapeB = (ShapeOBB *)OBB_B->getForm()->getShape(OBB_BChild);
+    PhysicsBodyCacheTypeOBB *OBBDataA = OBB_A->getCacheOBB(OBB_AChild);
+    PhysicsBodyCacheTypeOBB *OBBDataB = OBB_B->getCacheOBB(OBB_BChild);
 
     FaceQuery faceQueryA = queryFaceDirection(OBBShapeA->getPolygons(), 6, OBBDataA->points, OBBDataA->normals, OBBDataB->points, 8);
     if (faceQueryA.separation > 0.0f)
@@ -607,12 +719,12 @@ void CollisionDispatcher::collideOBBVsOBB(PhysicsBody *OBB_A, PhysicsBody *OBB_B
 
 // SAT Hull vs Hull
 // Dirk Gregorius - Robust Contact Creation for Physics Simulations, Valve Software
-void CollisionDispatcher::collideConvexVsConvex(PhysicsBody *convexA, PhysicsBody *convexB, CollisionCollector *collector)
+void CollisionDispatcher::collideConvexVsConvex(PhysicsBody *convexA, int convexAChild, PhysicsBody *convexB, int convexBChild, CollisionCollector *collector)
 {
-    ShapeConvex *shapeConvexA = (ShapeConvex *)convexA->getForm()->getSimpleShape();
-    ShapeConvex *shapeConvexB = (ShapeConvex *)convexB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeConvex *convexDataA = convexA->getCacheConvex(0);
-    PhysicsBodyCacheTypeConvex *convexDataB = convexB->getCacheConvex(0);
+    ShapeConvex *shapeConvexA = (ShapeConvex *)convexA->getForm()->getShape(convexAChild);
+    ShapeConvex *shapeConvexB = (ShapeConvex *)convexB->getForm()->getShape(convexBChild);
+    PhysicsBodyCacheTypeConvex *convexDataA = convexA->getCacheConvex(convexAChild);
+    PhysicsBodyCacheTypeConvex *convexDataB = convexB->getCacheConvex(convexBChild);
 
     FaceQuery faceQueryA = queryFaceDirection(
         shapeConvexA->getPolygons(),
@@ -707,12 +819,12 @@ void CollisionDispatcher::collideConvexVsConvex(PhysicsBody *convexA, PhysicsBod
         collector->addBodyPair(convexA, convexB, manifold);
 }
 
-void CollisionDispatcher::collideConvexVsOBB(PhysicsBody *convex, PhysicsBody *OBB, CollisionCollector *collector)
+void CollisionDispatcher::collideConvexVsOBB(PhysicsBody *convex, int convexChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
 {
-    ShapeConvex *shapeConvex = (ShapeConvex *)convex->getForm()->getSimpleShape();
-    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(0);
-    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(0);
+    ShapeConvex *shapeConvex = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
 
     FaceQuery faceQueryA = queryFaceDirection(
         shapeConvex->getPolygons(),
@@ -807,11 +919,11 @@ void CollisionDispatcher::collideConvexVsOBB(PhysicsBody *convex, PhysicsBody *O
         collector->addBodyPair(convex, OBB, manifold);
 }
 
-void CollisionDispatcher::collideConvexVsPlain(PhysicsBody *convex, PhysicsBody *plain, CollisionCollector *collector)
+void CollisionDispatcher::collideConvexVsPlain(PhysicsBody *convex, int convexChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
 {
-    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(0);
-    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(0);
+    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(plainChild);
 
     Plain plainShape = Plain(plainData->normal, plainData->distance);
     Vector3 convexCenter = convexData->center;
@@ -821,6 +933,7 @@ void CollisionDispatcher::collideConvexVsPlain(PhysicsBody *convex, PhysicsBody
     float n = 0.0f;
     Vector3 c = Vector3(0.0f);
     float depth = 0.0f;
+    int firstVertex = -1, lastVertex = -1;
     Vector3 *verticies = convexData->verticies;
     for (int i = 0; i < convexShape->getVerticiesAmount(); i++)
     {
@@ -833,23 +946,26 @@ void CollisionDispatcher::collideConvexVsPlain(PhysicsBody *convex, PhysicsBody
             c += p;
             n += 1.0f;
             depth = fmaxf(glm::length(difference), depth);
+            if (firstVertex == -1)
+                firstVertex = i;
+            lastVertex = i;
         }
     }
     if (n > 0.0f)
     {
         c /= n;
         CollisionManifold manifold;
-        manifold.addCollisionPoint(c, plainShape.getClosestPoint(c), depth, -sideNormal);
+        manifold.addCollisionPoint(c, plainShape.getClosestPoint(c), depth, -sideNormal, makeContactFeature(firstVertex, lastVertex));
         collector->addBodyPair(convex, plain, manifold);
     }
 }
 
-void CollisionDispatcher::collideConvexVsMesh(PhysicsBody *convex, PhysicsBody *mesh, CollisionCollector *collector)
+void CollisionDispatcher::collideConvexVsMesh(PhysicsBody *convex, int convexChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
 {
-    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(0);
-    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(0);
+    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getShape(meshChild);
+    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(meshChild);
 
     int convexVertAmount = convexShape->getVerticiesAmount();
     int convexPolyAmount = convexShape->getPolygonsAmount();
@@ -860,19 +976,29 @@ void CollisionDispatcher::collideConvexVsMesh(PhysicsBody *convex, PhysicsBody *
 
     Vector3 convexCenter = Vector3(meshData->invTransformation * Vector4(convexData->center, 1.0f));
 
-    int meshPolyAmount = meshShape->getPolygonsAmount();
     auto meshVerticies = meshShape->getVerticies();
     Vector3 meshPolyVerts[3];
 
     CollisionManifold manifold;
 
-    for (int i = 0; i < meshPolyAmount; i++)
+    // Only polygons near the other shape are tested
+    AABB locBounds(convexData->locVerticies[0], convexData->locVerticies[0]);
+    for (int i = 1; i < convexVertAmount; i++)
+        locBounds.extend(AABB(convexData->locVerticies[i], convexData->locVerticies[i]));
+
+    std::vector<int> &nearPolygons = meshPolygonsBuffer;
+    nearPolygons.clear();
+    meshShape->queryPolygons(locBounds, [&nearPolygons](int polygon)
+                             { nearPolygons.push_back(polygon); return true; });
+
+    for (int i : nearPolygons)
     {
         PolygonTriPoints &poly = meshShape->getPolygons()[i];
         meshPolyVerts[0] = meshVerticies[poly.a];
         meshPolyVerts[1] = meshVerticies[poly.b];
         meshPolyVerts[2] = meshVerticies[poly.c];
         Vector3 normal = meshShape->getNormals()[i];
+        Vector3 meshPolyNormals[2] = {normal, -normal};
 
         FaceQuery faceQueryA = queryFaceDirection(
             convexShape->getPolygons(),
@@ -905,7 +1031,7 @@ void CollisionDispatcher::collideConvexVsMesh(PhysicsBody *convex, PhysicsBody *
             meshPolyEdges,
             6,
             meshPolyVerts,
-            &normal);
+            meshPolyNormals);
 
         if (edgeQuery.separation > 0.0f)
             continue;
@@ -974,10 +1100,10 @@ void CollisionDispatcher::collideConvexVsMesh(PhysicsBody *convex, PhysicsBody *
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsPlain(PhysicsBody *capsule, PhysicsBody *plain, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsPlain(PhysicsBody *capsule, int capsuleChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector)
 {
-    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(0);
-    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(0);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypePlain *plainData = plain->getCachePlain(plainChild);
 
     float radius = capsuleData->radius;
     Vector3 &pointA = capsuleData->a;
@@ -991,13 +1117,16 @@ void CollisionDispatcher::collideCapsuleVsPlain(PhysicsBody *capsule, PhysicsBod
     float distA = glm::length(pointA - closestA);
     float distB = glm::length(pointB - closestB);
 
+    // Feature is the end of the segment that touches, or both of them
     Vector3 point, segmentPoint;
     float distance;
+    int end;
     if (fabsf(distA - distB) < 0.0001f)
     {
         point = (closestA + closestB) * 0.5f;
         segmentPoint = (pointA + pointB) * 0.5f;
         distance = distA;
+        end = 2;
     }
     else
     {
@@ -1006,12 +1135,14 @@ void CollisionDispatcher::collideCapsuleVsPlain(PhysicsBody *capsule, PhysicsBod
             point = closestA;
             segmentPoint = pointA;
             distance = distA;
+            end = 0;
         }
         else
         {
             point = closestB;
             segmentPoint = pointB;
             distance = distB;
+            end = 1;
         }
     }
 
@@ -1019,16 +1150,16 @@ void CollisionDispatcher::collideCapsuleVsPlain(PhysicsBody *capsule, PhysicsBod
     {
         CollisionManifold manifold;
         Vector3 normal = glm::normalize(segmentPoint - point);
-        manifold.addCollisionPoint(point, segmentPoint - normal * radius, radius - distance, normal);
+        manifold.addCollisionPoint(point, segmentPoint - normal * radius, radius - distance, normal, makeContactFeature(0, end));
         collector->addBodyPair(plain, capsule, manifold);
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsCapsule(PhysicsBody *capsuleA, PhysicsBody *capsuleB, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsCapsule(PhysicsBody *capsuleA, int capsuleAChild, PhysicsBody *capsuleB, int capsuleBChild, CollisionCollector *collector)
 {
 
-    PhysicsBodyCacheTypeCapsule *capsuleDataA = capsuleA->getCacheCapsule(0);
-    PhysicsBodyCacheTypeCapsule *capsuleDataB = capsuleB->getCacheCapsule(0);
+    PhysicsBodyCacheTypeCapsule *capsuleDataA = capsuleA->getCacheCapsule(capsuleAChild);
+    PhysicsBodyCacheTypeCapsule *capsuleDataB = capsuleB->getCacheCapsule(capsuleBChild);
 
     Segment segmentA = Segment(capsuleDataA->a, capsuleDataA->b);
     Segment segmentB = Segment(capsuleDataB->a, capsuleDataB->b);
@@ -1043,15 +1174,15 @@ void CollisionDispatcher::collideCapsuleVsCapsule(PhysicsBody *capsuleA, Physics
     {
         CollisionManifold manifold;
         Vector3 normal = glm::normalize(onB - onA);
-        manifold.addCollisionPoint(onA + normal * capsuleDataA->radius, onB - normal * capsuleDataB->radius, rSumm - distance, normal);
+        manifold.addCollisionPoint(onA + normal * capsuleDataA->radius, onB - normal * capsuleDataB->radius, rSumm - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(capsuleA, capsuleB, manifold);
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsSphere(PhysicsBody *capsule, PhysicsBody *sphere, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsSphere(PhysicsBody *capsule, int capsuleChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector)
 {
-    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(0);
-    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(0);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypeSphere *sphereData = sphere->getCacheSphere(sphereChild);
 
     Segment segment = Segment(capsuleData->a, capsuleData->b);
     Vector3 sphereCenter = sphereData->center;
@@ -1064,16 +1195,16 @@ void CollisionDispatcher::collideCapsuleVsSphere(PhysicsBody *capsule, PhysicsBo
     {
         CollisionManifold manifold;
         Vector3 normal = difference / distance;
-        manifold.addCollisionPoint(closest + normal * capsuleData->radius, sphereCenter - normal * sphereData->radius, rSumm - distance, normal);
+        manifold.addCollisionPoint(closest + normal * capsuleData->radius, sphereCenter - normal * sphereData->radius, rSumm - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(capsule, sphere, manifold);
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsOBB(PhysicsBody *capsule, PhysicsBody *OBB, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsOBB(PhysicsBody *capsule, int capsuleChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
 {
-    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(0);
-    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(0);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
 
     float radius = capsuleData->radius;
 
@@ -1103,7 +1234,7 @@ void CollisionDispatcher::collideCapsuleVsOBB(PhysicsBody *capsule, PhysicsBody
         if (distance < radius && distance > 0.0f)
         {
             Vector3 normal = difference / distance;
-            manifold.addCollisionPoint(onPoly, onSegment + normal * radius, radius - distance, normal);
+            manifold.addCollisionPoint(onPoly, onSegment + normal * radius, radius - distance, normal, makeContactFeature(faceQuery.polygon->index, 0));
             collector->addBodyPair(OBB, capsule, manifold);
         }
     }
@@ -1113,16 +1244,16 @@ void CollisionDispatcher::collideCapsuleVsOBB(PhysicsBody *capsule, PhysicsBody
         Vector3 normal = faceQuery.axis;
         Vector3 closest = segment.getClosestPoint(OBBData->center);
         Vector3 point = closest + normal * radius;
-        manifold.addCollisionPoint(point, point, -faceQuery.separation, normal);
+        manifold.addCollisionPoint(point, point, -faceQuery.separation, normal, makeContactFeature(faceQuery.polygon->index, 0));
         collector->addBodyPair(OBB, capsule, manifold);
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsConvex(PhysicsBody *capsule, PhysicsBody *convex, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsConvex(PhysicsBody *capsule, int capsuleChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
 {
-    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(0);
-    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(0);
+    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
 
     float radius = capsuleData->radius;
 
@@ -1156,7 +1287,7 @@ void CollisionDispatcher::collideCapsuleVsConvex(PhysicsBody *capsule, PhysicsBo
         if (distance < radius && distance > 0.0f)
         {
             Vector3 normal = difference / distance;
-            manifold.addCollisionPoint(onPoly, onSegment + normal * radius, radius - distance, normal);
+            manifold.addCollisionPoint(onPoly, onSegment + normal * radius, radius - distance, normal, makeContactFeature(faceQuery.polygon->index, 0));
             collector->addBodyPair(convex, capsule, manifold);
         }
     }
@@ -1166,16 +1297,16 @@ void CollisionDispatcher::collideCapsuleVsConvex(PhysicsBody *capsule, PhysicsBo
         Vector3 normal = faceQuery.axis;
         Vector3 closest = segment.getClosestPoint(convexData->center);
         Vector3 point = closest + normal * radius;
-        manifold.addCollisionPoint(point, point, -faceQuery.separation, normal);
+        manifold.addCollisionPoint(point, point, -faceQuery.separation, normal, makeContactFeature(faceQuery.polygon->index, 0));
         collector->addBodyPair(convex, capsule, manifold);
     }
 }
 
-void CollisionDispatcher::collideCapsuleVsMesh(PhysicsBody *capsule, PhysicsBody *mesh, CollisionCollector *collector)
+void CollisionDispatcher::collideCapsuleVsMesh(PhysicsBody *capsule, int capsuleChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector)
 {
-    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(0);
-    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getSimpleShape();
-    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(0);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    ShapeMesh *meshShape = (ShapeMesh *)mesh->getForm()->getShape(meshChild);
+    PhysicsBodyCacheTypeMesh *meshData = mesh->getCacheMesh(meshChild);
 
     Vector3 locA = Vector3(meshData->invTransformation * Vector4(capsuleData->a, 1.0f));
     Vector3 locB = Vector3(meshData->invTransformation * Vector4(capsuleData->b, 1.0f));
@@ -1195,13 +1326,251 @@ void CollisionDispatcher::collideCapsuleVsMesh(PhysicsBody *capsule, PhysicsBody
         CollisionManifold manifold;
 
         Vector3 normal = glm::normalize(onMesh - onSegment);
-        manifold.addCollisionPoint(onSegment + normal * radius, onMesh, radius - distance, normal);
+        manifold.addCollisionPoint(onSegment + normal * radius, onMesh, radius - distance, normal, makeContactFeature(0, 0));
         collector->addBodyPair(capsule, mesh, manifold);
     }
 }
 
-void CollisionDispatcher::collideMeshVsMesh(PhysicsBody *meshA, PhysicsBody *meshB, CollisionCollector *collector)
+void CollisionDispatcher::collideMeshVsMesh(PhysicsBody *meshA, int meshAChild, PhysicsBody *meshB, int meshBChild, CollisionCollector *collector)
+{
+    ShapeMesh *meshShapeA = (ShapeMesh *)meshA->getForm()->getShape(meshAChild);
+    ShapeMesh *meshShapeB = (ShapeMesh *)meshB->getForm()->getShape(meshBChild);
+    PhysicsBodyCacheTypeMesh *meshDataA = meshA->getCacheMesh(meshAChild);
+    PhysicsBodyCacheTypeMesh *meshDataB = meshB->getCacheMesh(meshBChild);
+
+    Vector3 *verticiesA = meshShapeA->getVerticies();
+    Vector3 *verticiesB = meshShapeB->getVerticies();
+    PolygonTriPoints *polygonsA = meshShapeA->getPolygons();
+    PolygonTriPoints *polygonsB = meshShapeB->getPolygons();
+    Matrix4 bToA = meshDataA->invTransformation * meshDataB->transformation;
+
+    CollisionManifold manifold;
+    int shallowest = 0;
+
+    // Both trees are walked together, only triangles from leaves that overlap are tested
+    meshShapeA->getTree()->queryTree(*meshShapeB->getTree(), bToA, [&](int polygonA, int polygonB)
+                                     {
+        // Meshes may be scaled, so triangles are tested in world space
+        Vector3 triA[3], triB[3];
+        const PolygonTriPoints &polyA = polygonsA[polygonA];
+        const PolygonTriPoints &polyB = polygonsB[polygonB];
+        triA[0] = Vector3(meshDataA->transformation * Vector4(verticiesA[polyA.a], 1.0f));
+        triA[1] = Vector3(meshDataA->transformation * Vector4(verticiesA[polyA.b], 1.0f));
+        triA[2] = Vector3(meshDataA->transformation * Vector4(verticiesA[polyA.c], 1.0f));
+        triB[0] = Vector3(meshDataB->transformation * Vector4(verticiesB[polyB.a], 1.0f));
+        triB[1] = Vector3(meshDataB->transformation * Vector4(verticiesB[polyB.b], 1.0f));
+        triB[2] = Vector3(meshDataB->transformation * Vector4(verticiesB[polyB.c], 1.0f));
+
+        Vector3 normal;
+        float depth;
+        if (!getTrianglesPenetration(triA, triB, normal, depth))
+            return true;
+
+        // Vertex of B that went deepest into A
+        Vector3 onB = triB[0];
+        for (int v = 1; v < 3; v++)
+        {
+            if (glm::dot(triB[v], normal) < glm::dot(onB, normal))
+                onB = triB[v];
+        }
+        Vector3 onA = onB + normal * depth;
+        uint32_t feature = makeContactFeature(polygonA, polygonB);
+
+        // When the manifold is full the shallowest point gives way to deeper ones
+        if (!manifold.addCollisionPoint(onA, onB, depth, normal, feature) && depth > manifold.depth[shallowest])
+        {
+            manifold.pointsOnA[shallowest] = onA;
+            manifold.pointsOnB[shallowest] = onB;
+            manifold.normal[shallowest] = normal;
+            manifold.depth[shallowest] = depth;
+            manifold.features[shallowest] = feature;
+        }
+        for (int i = 0; i < manifold.collisionAmount; i++)
+        {
+            if (manifold.depth[i] < manifold.depth[shallowest])
+                shallowest = i;
+        }
+        return true; });
+
+    if (manifold.collisionAmount > 0)
+        collector->addBodyPair(meshA, meshB, manifold);
+}
+
+void CollisionDispatcher::collideCompound(PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector)
+{
+    int firstPair = (int)collector->pairs.size();
+    int firstAxis = (int)collector->axes.size();
+    PhysicsForm *formA = a->getForm();
+    PhysicsForm *formB = b->getForm();
+    bool bCompoundA = a->getType() == ShapeCollisionType::Combined;
+    bool bCompoundB = b->getType() == ShapeCollisionType::Combined;
+
+    // Shapes of B are brought into the space of A, where the shapes tree of A is
+    Matrix4 transformationA = glm::translate(Matrix4(1.0f), a->getPosition()) * glm::toMat4(a->getRotation());
+    Matrix4 transformationB = glm::translate(Matrix4(1.0f), b->getPosition()) * glm::toMat4(b->getRotation());
+    Matrix4 toSpaceA = glm::inverse(transformationA) * transformationB;
+
+    int shapesAmountB = bCompoundB ? formB->getShapesAmount() : 1;
+    for (int j = 0; j < shapesAmountB; j++)
+    {
+        AABB boundsB = bCompoundB ? formB->getShape(j)->getAABB(Matrix4(1.0f)) : formB->getAABB(Matrix4(1.0f));
+        AABB boundsInA = boundsB.getTransformed(toSpaceA);
+
+        if (!bCompoundA)
+        {
+            if (formA->getAABB(Matrix4(1.0f)).test(boundsInA) || !boundsInA.isFinite())
+                collideShapes(a, 0, b, j, collector);
+            continue;
+        }
+
+        // Endless shapes like plains can't be brought into another space, they are tested against every shape
+        if (!boundsInA.isFinite())
+        {
+            for (int i = 0; i < formA->getShapesAmount(); i++)
+                collideShapes(a, i, b, j, collector);
+            continue;
+        }
+
+        formA->getShapesTree()->query(boundsInA, [this, a, b, j, collector](int proxy, void *userData)
+                                      {
+                                          collideShapes(a, (int)(intptr_t)userData, b, j, collector);
+                                          return true; });
+    }
+
+    // Axes of single shapes can't be told apart by the pair, so none are kept
+    collector->axes.resize(firstAxis);
+    collector->joinPairs(firstPair, a, b);
+}
+
+void CollisionDispatcher::collideShapes(PhysicsBody *a, int aChild, PhysicsBody *b, int bChild, CollisionCollector *collector)
+{
+    int firstPoint = (int)collector->points.size();
+    ShapeCollisionType typeA = a->getForm()->getShape(aChild)->getType();
+    ShapeCollisionType typeB = b->getForm()->getShape(bChild)->getType();
+    collectCollisions[(int)typeA][(int)typeB](a, aChild, b, bChild, collector);
+
+    for (int p = firstPoint; p < (int)collector->points.size(); p++)
+        collector->points[p].feature = makeCompoundFeature(collector->points[p].feature, aChild, bChild);
+}
+
+GJKStatus CollisionDispatcher::collideSupportShapes(PhysicsBody *a, PhysicsBody *b, const GJKShape &shapeA, const GJKShape &shapeB, CollisionCollector *collector, GJKResult *result)
+{
+    Vector3 axis;
+    if (!collector->findAxis(a, b, &axis))
+        axis = b->getCenterOfMass() - a->getCenterOfMass();
+
+    GJKStatus status = GJK::collide(shapeA, shapeB, axis, 0.0f, result);
+    collector->addAxis(a, b, axis);
+    return status;
+}
+
+// GJK finds penetration axis in time linear to verticies, faces are clipped along it the same way SAT result is
+void CollisionDispatcher::collideConvexVsConvexGJK(PhysicsBody *convexA, int convexAChild, PhysicsBody *convexB, int convexBChild, CollisionCollector *collector)
 {
-    // Do nothing cause we don't process this
-    // TODO: make it work it's possible but terrible
+    ShapeConvex *shapeConvexA = (ShapeConvex *)convexA->getForm()->getShape(convexAChild);
+    ShapeConvex *shapeConvexB = (ShapeConvex *)convexB->getForm()->getShape(convexBChild);
+    PhysicsBodyCacheTypeConvex *convexDataA = convexA->getCacheConvex(convexAChild);
+    PhysicsBodyCacheTypeConvex *convexDataB = convexB->getCacheConvex(convexBChild);
+
+    GJKShape supportA = {convexDataA->verticies, shapeConvexA->getVerticiesAmount(), 0.0f};
+    GJKShape supportB = {convexDataB->verticies, shapeConvexB->getVerticiesAmount(), 0.0f};
+    GJKResult result;
+    GJKStatus status = collideSupportShapes(convexA, convexB, supportA, supportB, collector, &result);
+    if (status == GJKStatus::Failed)
+        return collideConvexVsConvex(convexA, convexAChild, convexB, convexBChild, collector);
+    if (status == GJKStatus::Separated || result.depth <= 0.0f)
+        return;
+
+    CollisionManifold manifold;
+    HullCliping::clipHullAgainstHull(-result.normal,
+                                     shapeConvexA->getPolygons(),
+                                     shapeConvexA->getPolygonsAmount(),
+                                     convexDataA->verticies,
+                                     shapeConvexA->getVerticiesAmount(),
+                                     convexDataA->normals,
+                                     shapeConvexB->getPolygons(),
+                                     shapeConvexB->getPolygonsAmount(),
+                                     convexDataB->verticies,
+                                     shapeConvexB->getVerticiesAmount(),
+                                     convexDataB->normals,
+                                     &manifold);
+    if (manifold.collisionAmount == 0)
+        manifold.addCollisionPoint(result.pointOnA, result.pointOnB, result.depth, result.normal);
+    collector->addBodyPair(convexA, convexB, manifold);
+}
+
+void CollisionDispatcher::collideConvexVsOBBGJK(PhysicsBody *convex, int convexChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
+{
+    ShapeConvex *shapeConvex = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    ShapeOBB *OBBShape = (ShapeOBB *)OBB->getForm()->getShape(OBBChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
+
+    GJKShape supportConvex = {convexData->verticies, shapeConvex->getVerticiesAmount(), 0.0f};
+    GJKShape supportOBB = {OBBData->points, 8, 0.0f};
+    GJKResult result;
+    GJKStatus status = collideSupportShapes(convex, OBB, supportConvex, supportOBB, collector, &result);
+    if (status == GJKStatus::Failed)
+        return collideConvexVsOBB(convex, convexChild, OBB, OBBChild, collector);
+    if (status == GJKStatus::Separated || result.depth <= 0.0f)
+        return;
+
+    CollisionManifold manifold;
+    HullCliping::clipHullAgainstHull(-result.normal,
+                                     shapeConvex->getPolygons(),
+                                     shapeConvex->getPolygonsAmount(),
+                                     convexData->verticies,
+                                     shapeConvex->getVerticiesAmount(),
+                                     convexData->normals,
+                                     OBBShape->getPolygons(),
+                                     6,
+                                     OBBData->points,
+                                     8,
+                                     OBBData->normals,
+                                     &manifold);
+    if (manifold.collisionAmount == 0)
+        manifold.addCollisionPoint(result.pointOnA, result.pointOnB, result.depth, result.normal);
+    collector->addBodyPair(convex, OBB, manifold);
+}
+
+// Capsule is its segment with radius around, so closest points of cores give the contact right away
+void CollisionDispatcher::collideCapsuleVsOBBGJK(PhysicsBody *capsule, int capsuleChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector)
+{
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypeOBB *OBBData = OBB->getCacheOBB(OBBChild);
+
+    Vector3 verticiesCapsule[2] = {capsuleData->a, capsuleData->b};
+    GJKShape supportOBB = {OBBData->points, 8, 0.0f};
+    GJKShape supportCapsule = {verticiesCapsule, 2, capsuleData->radius};
+    GJKResult result;
+    GJKStatus status = collideSupportShapes(OBB, capsule, supportOBB, supportCapsule, collector, &result);
+    if (status == GJKStatus::Failed)
+        return collideCapsuleVsOBB(capsule, capsuleChild, OBB, OBBChild, collector);
+    if (status == GJKStatus::Separated || result.depth <= 0.0f)
+        return;
+
+    CollisionManifold manifold;
+    manifold.addCollisionPoint(result.pointOnA, result.pointOnB, result.depth, result.normal, makeContactFeature(0, 0));
+    collector->addBodyPair(OBB, capsule, manifold);
+}
+
+void CollisionDispatcher::collideCapsuleVsConvexGJK(PhysicsBody *capsule, int capsuleChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector)
+{
+    ShapeConvex *convexShape = (ShapeConvex *)convex->getForm()->getShape(convexChild);
+    PhysicsBodyCacheTypeCapsule *capsuleData = capsule->getCacheCapsule(capsuleChild);
+    PhysicsBodyCacheTypeConvex *convexData = convex->getCacheConvex(convexChild);
+
+    Vector3 verticiesCapsule[2] = {capsuleData->a, capsuleData->b};
+    GJKShape supportConvex = {convexData->verticies, convexShape->getVerticiesAmount(), 0.0f};
+    GJKShape supportCapsule = {verticiesCapsule, 2, capsuleData->radius};
+    GJKResult result;
+    GJKStatus status = collideSupportShapes(convex, capsule, supportConvex, supportCapsule, collector, &result);
+    if (status == GJKStatus::Failed)
+        return collideCapsuleVsConvex(capsule, capsuleChild, convex, convexChild, collector);
+    if (status == GJKStatus::Separated || result.depth <= 0.0f)
+        return;
+
+    CollisionManifold manifold;
+    manifold.addCollisionPoint(result.pointOnA, result.pointOnB, result.depth, result.normal, makeContactFeature(0, 0));
+    collector->addBodyPair(convex, capsule, manifold);
 }
@@ -5,42 +5,81 @@
 #include "shapes/shape.h"
 #include "collisionCollector.h"
 #include "physicsBody.h"
+#include "utils/gjk.h"
+#include <atomic>
 
-typedef void (*CollectCollisions)(PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector);
+enum class NarrowphaseType
+{
+    SeparatingAxis, // Face and edge queries, cost grows with squares of faces and edges of hulls
+    GJK,            // Support points search started from the axis of the previous substep, cost grows with verticies
+};
+
+// Shapes are given by bodies and indices of shapes in their forms, forms of one shape only have index 0
+typedef void (*CollectCollisions)(PhysicsBody *a, int aChild, PhysicsBody *b, int bChild, CollisionCollector *collector);
 
 class CollisionDispatcher
 {
 public:
     CollisionDispatcher();
-    EXPORT inline void collide(PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector) { collectCollisions[(int)a->getType()][(int)b->getType()](a, b, collector); }
+    EXPORT inline void collide(PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector)
+    {
+        if (a->getType() == ShapeCollisionType::Combined || b->getType() == ShapeCollisionType::Combined)
+            collideCompound(a, b, collector);
+        else
+            collectCollisions[(int)a->getType()][(int)b->getType()](a, 0, b, 0, collector);
+    }
+
+    // Test used by hulls, boxes and capsules against hulls and boxes, boxes against each other always use separating axis
+    EXPORT void setNarrowphase(NarrowphaseType narrowphaseType);
+    inline NarrowphaseType getNarrowphase() { return narrowphaseType; }
+
+    // Pairs of shapes which types have no collision function, counted since start, warning is printed only for the first of every kind
+    EXPORT static int getUnsupportedPairsAmount();
+
+    static void collideSphereVsPlain(PhysicsBody *sphere, int sphereChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector);
+    static void collideSphereVsSphere(PhysicsBody *sphereA, int sphereAChild, PhysicsBody *sphereB, int sphereBChild, CollisionCollector *collector);
+    static void collideSphereVsMesh(PhysicsBody *sphere, int sphereChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector);
+    static void collideSphereVsConvex(PhysicsBody *sphere, int sphereChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector);
 
-    static void collideSphereVsPlain(PhysicsBody *sphere, PhysicsBody *plain, CollisionCollector *collector);
-    static void collideSphereVsSphere(PhysicsBody *sphereA, PhysicsBody *sphereB, CollisionCollector *collector);
-    static void collideSphereVsMesh(PhysicsBody *sphere, PhysicsBody *mesh, CollisionCollector *collector);
-    static void collideSphereVsConvex(PhysicsBody *sphere, PhysicsBody *convex, CollisionCollector *collector);
+    static void collideOBBVsPlain(PhysicsBody *OBB, int OBBChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector);
+    static void collideOBBVsSphere(PhysicsBody *OBB, int OBBChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector);
+    static void collideOBBVsMesh(PhysicsBody *OBB, int OBBChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector);
+    static void collideOBBVsOBB(PhysicsBody *OBB_A, int OBB_AChild, PhysicsBody *OBB_B, int OBB_BChild, CollisionCollector *collector);
 
-    static void collideOBBVsPlain(PhysicsBody *OBB, PhysicsBody *plain, CollisionCollector *collector);
-    static void collideOBBVsSphere(PhysicsBody *OBB, PhysicsBody *sphere, CollisionCollector *collector);
-    static void collideOBBVsMesh(PhysicsBody *OBB, PhysicsBody *mesh, CollisionCollector *collector);
-    static void collideOBBVsOBB(PhysicsBody *OBB_A, PhysicsBody *OBB_B, CollisionCollector *collector);
+    static void collideConvexVsConvex(PhysicsBody *convexA, int convexAChild, PhysicsBody *convexB, int convexBChild, CollisionCollector *collector);
+    static void collideConvexVsOBB(PhysicsBody *convex, int convexChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector);
+    static void collideConvexVsPlain(PhysicsBody *convex, int convexChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector);
+    static void collideConvexVsMesh(PhysicsBody *convex, int convexChild, PhysicsBody *geometry, int geometryChild, CollisionCollector *collector);
 
-    static void collideConvexVsConvex(PhysicsBody *convexA, PhysicsBody *convexB, CollisionCollector *collector);
-    static void collideConvexVsOBB(PhysicsBody *convex, PhysicsBody *OBB, CollisionCollector *collector);
-    static void collideConvexVsPlain(PhysicsBody *convex, PhysicsBody *plain, CollisionCollector *collector);
-    static void collideConvexVsMesh(PhysicsBody *convex, PhysicsBody *geometry, CollisionCollector *collector);
+    static void collideCapsuleVsPlain(PhysicsBody *capsule, int capsuleChild, PhysicsBody *plain, int plainChild, CollisionCollector *collector);
+    static void collideCapsuleVsCapsule(PhysicsBody *capsuleA, int capsuleAChild, PhysicsBody *capsuleB, int capsuleBChild, CollisionCollector *collector);
+    static void collideCapsuleVsSphere(PhysicsBody *capsule, int capsuleChild, PhysicsBody *sphere, int sphereChild, CollisionCollector *collector);
+    static void collideCapsuleVsOBB(PhysicsBody *capsule, int capsuleChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector);
+    static void collideCapsuleVsConvex(PhysicsBody *capsule, int capsuleChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector);
+    static void collideCapsuleVsMesh(PhysicsBody *capsule, int capsuleChild, PhysicsBody *mesh, int meshChild, CollisionCollector *collector);
 
-    static void collideCapsuleVsPlain(PhysicsBody *capsule, PhysicsBody *plain, CollisionCollector *collector);
-    static void collideCapsuleVsCapsule(PhysicsBody *capsuleA, PhysicsBody *capsuleB, CollisionCollector *collector);
-    static void collideCapsuleVsSphere(PhysicsBody *capsule, PhysicsBody *sphere, CollisionCollector *collector);
-    static void collideCapsuleVsOBB(PhysicsBody *capsule, PhysicsBody *OBB, CollisionCollector *collector);
-    static void collideCapsuleVsConvex(PhysicsBody *capsule, PhysicsBody *convex, CollisionCollector *collector);
-    static void collideCapsuleVsMesh(PhysicsBody *capsule, PhysicsBody *mesh, CollisionCollector *collector);
+    static void collideMeshVsMesh(PhysicsBody *meshA, int meshAChild, PhysicsBody *meshB, int meshBChild, CollisionCollector *collector);
 
-    static void collideMeshVsMesh(PhysicsBody *meshA, PhysicsBody *meshB, CollisionCollector *collector);
+    static void collideConvexVsConvexGJK(PhysicsBody *convexA, int convexAChild, PhysicsBody *convexB, int convexBChild, CollisionCollector *collector);
+    static void collideConvexVsOBBGJK(PhysicsBody *convex, int convexChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector);
+    static void collideCapsuleVsOBBGJK(PhysicsBody *capsule, int capsuleChild, PhysicsBody *OBB, int OBBChild, CollisionCollector *collector);
+    static void collideCapsuleVsConvexGJK(PhysicsBody *capsule, int capsuleChild, PhysicsBody *convex, int convexChild, CollisionCollector *collector);
 
 protected:
+    // Shapes of compound forms are collided one by one, only the ones the shapes tree finds near the other body
+    // Their manifolds are joined into one, so the pair is solved and cached as any other
+    EXPORT void collideCompound(PhysicsBody *a, PhysicsBody *b, CollisionCollector *collector);
+    void collideShapes(PhysicsBody *a, int aChild, PhysicsBody *b, int bChild, CollisionCollector *collector);
+
+    // Runs GJK from the axis the pair had in the previous substep and leaves the new one for the next
+    static GJKStatus collideSupportShapes(PhysicsBody *a, PhysicsBody *b, const GJKShape &shapeA, const GJKShape &shapeB, CollisionCollector *collector, GJKResult *result);
+
+    NarrowphaseType narrowphaseType = NarrowphaseType::GJK;
+
     CollectCollisions collectCollisions[(int)ShapeCollisionType::Amount][(int)ShapeCollisionType::Amount];
 
+    static std::atomic<int> unsupportedPairs[(int)ShapeCollisionType::Amount][(int)ShapeCollisionType::Amount];
+
     static HullEdge meshPolyEdges[6];
     static HullPolygon meshPolygon;
 };
\ No newline at end of file
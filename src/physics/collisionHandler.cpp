@@ -3,7 +3,13 @@
 
 #include "collisionHandler.h"
 
-void CollisionHandler::triggerCollision(PhysicsBody *bodyA, PhysicsBody *bodyB, Vector3 &pointA, Vector3 &pointB)
+inline unsigned int _hashBodyPair(PhysicsBody *bodyA, PhysicsBody *bodyB)
+{
+    uint64_t key = (uint64_t)(uintptr_t)bodyA * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uintptr_t)bodyB * 0xC2B2AE3D27D4EB4Full;
+    return (unsigned int)(key ^ (key >> 32));
+}
+
+void CollisionHandler::triggerCollision(PhysicsBody *bodyA, PhysicsBody *bodyB, const Vector3 &pointA, const Vector3 &pointB)
 {
     if (bodyA == bodyB)
         return;
@@ -15,68 +21,158 @@ void CollisionHandler::triggerCollision(PhysicsBody *bodyA, PhysicsBody *bodyB,
         bodyB = temp;
     }
 
-    for (auto it = bodyCollisionData.begin(); it != bodyCollisionData.end(); it++)
+    int index = findRecord(bodyA, bodyB);
+    if (index != -1)
     {
-        if (it->bodyA == bodyA && (*it).bodyB == bodyB)
-        {
-            it->pointA = pointA;
-            it->pointB = pointB;
-            it->reaccuredTimer = 0.0f;
-            collisionPersisted(&(*it));
-            return;
-        }
+        CollisionRecord &record = records[index];
+        record.data.pointA = pointA;
+        record.data.pointB = pointB;
+        record.touchGeneration = generation;
+        return;
     }
-    bodyCollisionData.push_back(BodyCollisionData({bodyA, bodyB, pointA, pointB, 0.0f, 0.0f}));
-    collisionStarted(&bodyCollisionData.back());
+
+    records.push_back(CollisionRecord({BodyCollisionData({bodyA, bodyB, pointA, pointB, 0.0f, 0.0f}), generation, generation, false}));
+    if ((records.size() * 2) > slots.size())
+        growSlots();
+    else
+        insertSlot((int)records.size() - 1);
 }
 
-void CollisionHandler::removeNotPersistedCollisions()
+void CollisionHandler::notifyBodyRemoved(PhysicsBody *body)
 {
-    auto it = bodyCollisionData.begin();
-    while (it != bodyCollisionData.end())
+    int index = 0;
+    while (index < (int)records.size())
     {
-        if (it->reaccuredTimer > 0.015f)
+        CollisionRecord &record = records[index];
+        if (record.data.bodyA == body || record.data.bodyB == body)
         {
-            it = bodyCollisionData.erase(it);
-            collisionEnded(&(*it));
+            // Collisions that weren't announced don't end either
+            if (record.bAnnounced)
+            {
+                updateTimers(&record);
+                collisionEnded(&record.data);
+            }
+            removeRecord(index);
         }
         else
-            ++it;
+            index++;
     }
 }
 
-void CollisionHandler::notifyBodyRemoved(PhysicsBody *body)
+void CollisionHandler::updateCollisionTimers(float delta)
 {
-    auto it = bodyCollisionData.begin();
-    while (it != bodyCollisionData.end())
+    generation++;
+    generationTime = delta;
+}
+
+void CollisionHandler::dispatchCollisionEvents()
+{
+    // Removed record is replaced by the last one, which wasn't visited yet
+    int index = 0;
+    while (index < (int)records.size())
     {
-        if (it->bodyA == body || it->bodyB == body)
+        CollisionRecord &record = records[index];
+        updateTimers(&record);
+        if (!record.bAnnounced)
+        {
+            record.bAnnounced = true;
+            collisionStarted(&record.data);
+        }
+        else if ((int)(record.touchGeneration - dispatchGeneration) >= 0)
+            collisionPersisted(&record.data);
+
+        if ((int)(generation - record.touchGeneration) > 1)
         {
-            collisionEnded(&(*it));
-            it = bodyCollisionData.erase(it);
+            collisionEnded(&record.data);
+            removeRecord(index);
         }
         else
-            ++it;
+            index++;
     }
+    dispatchGeneration = generation;
 }
 
-void CollisionHandler::updateCollisionTimers(float delta)
+void CollisionHandler::collisionStarted(BodyCollisionData *data)
 {
-    for (auto &data : bodyCollisionData)
+}
+
+void CollisionHandler::collisionPersisted(BodyCollisionData *data)
+{
+}
+
+void CollisionHandler::collisionEnded(BodyCollisionData *data)
+{
+}
+
+int CollisionHandler::findRecord(PhysicsBody *bodyA, PhysicsBody *bodyB)
+{
+    if (slots.size() == 0)
+        return -1;
+    return slots[findSlot(bodyA, bodyB)];
+}
+
+int CollisionHandler::findSlot(PhysicsBody *bodyA, PhysicsBody *bodyB)
+{
+    // Table is never more than half full, so probing always reaches an empty slot
+    unsigned int mask = (unsigned int)slots.size() - 1;
+    unsigned int slot = _hashBodyPair(bodyA, bodyB) & mask;
+    while (slots[slot] != -1)
     {
-        data.persistedTimer += delta;
-        data.reaccuredTimer += delta;
+        const BodyCollisionData &data = records[slots[slot]].data;
+        if (data.bodyA == bodyA && data.bodyB == bodyB)
+            break;
+        slot = (slot + 1) & mask;
     }
+    return (int)slot;
 }
 
-void CollisionHandler::collisionStarted(BodyCollisionData *data)
+void CollisionHandler::insertSlot(int record)
 {
+    slots[findSlot(records[record].data.bodyA, records[record].data.bodyB)] = record;
 }
 
-void CollisionHandler::collisionPersisted(BodyCollisionData *data)
+void CollisionHandler::removeRecord(int record)
 {
+    // Slots after the removed one move back into the gap, so probing doesn't stop on it
+    unsigned int mask = (unsigned int)slots.size() - 1;
+    unsigned int gap = (unsigned int)findSlot(records[record].data.bodyA, records[record].data.bodyB);
+    unsigned int slot = (gap + 1) & mask;
+    slots[gap] = -1;
+    while (slots[slot] != -1)
+    {
+        const BodyCollisionData &data = records[slots[slot]].data;
+        unsigned int home = _hashBodyPair(data.bodyA, data.bodyB) & mask;
+        if (((slot - home) & mask) >= ((slot - gap) & mask))
+        {
+            slots[gap] = slots[slot];
+            slots[slot] = -1;
+            gap = slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Last record takes the place of the removed one
+    int last = (int)records.size() - 1;
+    if (record != last)
+    {
+        slots[findSlot(records[last].data.bodyA, records[last].data.bodyB)] = record;
+        records[record] = records[last];
+    }
+    records.pop_back();
 }
 
-void CollisionHandler::collisionEnded(BodyCollisionData *data)
+void CollisionHandler::growSlots()
+{
+    int size = 64;
+    while (size < (int)records.size() * 4)
+        size *= 2;
+    slots.assign(size, -1);
+    for (int i = 0; i < (int)records.size(); i++)
+        insertSlot(i);
+}
+
+void CollisionHandler::updateTimers(CollisionRecord *record)
 {
+    record->data.persistedTimer = (float)(generation - record->startGeneration) * generationTime;
+    record->data.reaccuredTimer = (float)(generation - record->touchGeneration) * generationTime;
 }
@@ -7,19 +7,52 @@
 #include "utils/destroyable.h"
 #include <vector>
 
+// Collision as handler keeps it, generations are substeps it started and was last touched in
+// Collision ends when its bodies didn't touch in the last substep, so it doesn't depend on the length of substeps
+struct CollisionRecord
+{
+    BodyCollisionData data;
+    uint32_t startGeneration;
+    uint32_t touchGeneration;
+    bool bAnnounced;
+};
+
 class CollisionHandler : public Destroyable
 {
 public:
-    EXPORT void triggerCollision(PhysicsBody *bodyA, PhysicsBody *bodyB, Vector3 &pointA, Vector3 &pointB);
-    EXPORT void removeNotPersistedCollisions();
+    // Only remembers the collision, events are delivered by dispatchCollisionEvents
+    EXPORT void triggerCollision(PhysicsBody *bodyA, PhysicsBody *bodyB, const Vector3 &pointA, const Vector3 &pointB);
     EXPORT void notifyBodyRemoved(PhysicsBody *body);
+
+    // Goes to the next substep, collisions not touched in it get older
     EXPORT void updateCollisionTimers(float delta);
 
+    // Started and ended collisions get their events, collisions touched since the last dispatch are persisted once
+    EXPORT void dispatchCollisionEvents();
+
+    inline int getCollisionsAmount() { return (int)records.size(); }
+
     EXPORT virtual void collisionStarted(BodyCollisionData *data);
     EXPORT virtual void collisionPersisted(BodyCollisionData *data);
     EXPORT virtual void collisionEnded(BodyCollisionData *data);
 
 protected:
+    // Index of the record of the pair or -1
+    int findRecord(PhysicsBody *bodyA, PhysicsBody *bodyB);
+    int findSlot(PhysicsBody *bodyA, PhysicsBody *bodyB);
+    void insertSlot(int record);
+    void removeRecord(int record);
+    void growSlots();
+    void updateTimers(CollisionRecord *record);
+
     // Holds happened collisions information
-    std::vector<BodyCollisionData> bodyCollisionData;
-};
\ No newline at end of file
+    std::vector<CollisionRecord> records;
+
+    // Open addressing table of record indices keyed by the pair of bodies, -1 is an empty slot
+    std::vector<int> slots;
+
+    // Substeps counted by updateCollisionTimers, timers given to events are generations multiplied by substep time
+    uint32_t generation = 0;
+    uint32_t dispatchGeneration = 0;
+    float generationTime = 0.0f;
+};
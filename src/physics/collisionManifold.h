@@ -9,6 +9,31 @@ class PhysicsBody;
 
 const int MAX_POINTS = 8;
 
+// Feature id names the faces, edges or verticies of both shapes a contact is made by
+// Same feature in the next substep is the same contact even if it slid, 0 is for contacts that can only be matched by position
+inline uint32_t makeContactFeature(int featureA, int featureB)
+{
+    return ((uint32_t)(featureA + 1) << 16) | ((uint32_t)(featureB + 1) & 0xffff);
+}
+
+// Features of shapes of compound forms also name the shapes, so contacts of different pieces don't match
+inline uint32_t makeCompoundFeature(uint32_t feature, int shapeA, int shapeB)
+{
+    if (feature == 0)
+        return 0;
+    return feature ^ ((uint32_t)((shapeA & 0xff) + 1) << 24) ^ ((uint32_t)((shapeB & 0xff) + 1) << 8);
+}
+
+/// Single point of collision as it is stored after detection
+struct ContactPoint
+{
+    Vector3 pointOnA;
+    Vector3 pointOnB;
+    Vector3 normal;
+    float depth;
+    uint32_t feature;
+};
+
 /// Collision information between 2 bodies
 class CollisionManifold
 {
@@ -25,10 +50,13 @@ public:
     // Shortest distance to escape collision by normal
     float depth[MAX_POINTS];
 
+    // Parts of shapes every point is made by, see makeContactFeature
+    uint32_t features[MAX_POINTS];
+
     // Amount of points of collision
     int collisionAmount = 0;
 
-    inline bool addCollisionPoint(const Vector3 &onA, const Vector3 &onB, float depth, const Vector3 &normal)
+    inline bool addCollisionPoint(const Vector3 &onA, const Vector3 &onB, float depth, const Vector3 &normal, uint32_t feature = 0)
     {
         if (collisionAmount < MAX_POINTS)
         {
@@ -36,6 +64,7 @@ public:
             this->pointsOnB[collisionAmount] = onB;
             this->normal[collisionAmount] = normal;
             this->depth[collisionAmount] = depth;
+            this->features[collisionAmount] = feature;
             collisionAmount++;
             return true;
         }
@@ -61,6 +90,7 @@ public:
         pointsOnB[0] = combineOnB;
         depth[0] = glm::length(combinedNormal);
         normal[0] = glm::normalize(combinedNormal);
+        features[0] = 0;
         collisionAmount = 1;
     }
 };
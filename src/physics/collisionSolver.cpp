@@ -9,13 +9,27 @@ CollisionSolver::CollisionSolver(float simScale)
     minRenormalVelocity = simScale * -0.02f;
 }
 
-void CollisionSolver::solve(PhysicsBody *a, PhysicsBody *b, CollisionManifold &manifold, float delta)
+void CollisionSolver::solve(PhysicsBody *a, PhysicsBody *b, const ContactPoint *points, int pointsAmount, float delta)
 {
-    if (!a->isSimulatingPhysics() || !b->isSimulatingPhysics())
+    if (!a->isSimulatingPhysics() || !b->isSimulatingPhysics() || pointsAmount == 0)
         return;
 
-    Vector3 normal = manifold.normal[0];
-    float depth = manifold.depth[0];
+    // Joined compound pairs have points of different shapes, the deepest alone would leave the rest unsupported
+    // Every one of them is solved then and they share the push out
+    if (pointsAmount > 1 && (a->getType() == ShapeCollisionType::Combined || b->getType() == ShapeCollisionType::Combined))
+    {
+        for (int i = 0; i < pointsAmount; i++)
+            solvePoint(a, b, points[i], 1.0f / (float)pointsAmount);
+        return;
+    }
+
+    solvePoint(a, b, points[0], 1.0f);
+}
+
+void CollisionSolver::solvePoint(PhysicsBody *a, PhysicsBody *b, const ContactPoint &point, float pushShare)
+{
+    Vector3 normal = point.normal;
+    float depth = point.depth * pushShare;
     if (depth <= 0.0f)
         return;
 
@@ -31,8 +45,8 @@ void CollisionSolver::solve(PhysicsBody *a, PhysicsBody *b, CollisionManifold &m
     if (b->getMotionType() != PhysicsMotionType::Static)
         b->translate((a->getMotionType() != PhysicsMotionType::Static) ? translateB : translateA + translateB);
 
-    Vector3 pointA = manifold.pointsOnA[0];
-    Vector3 pointB = manifold.pointsOnB[0];
+    Vector3 pointA = point.pointOnA;
+    Vector3 pointB = point.pointOnB;
     Vector3 localPointA = pointA - a->getCenterOfMass();
     Vector3 localPointB = pointB - b->getCenterOfMass();
 
@@ -170,14 +184,173 @@ float CollisionSolver::solveAxis(
     float mEffectiveMass = 1.0f / invEffectiveMass;
     float lambda = fminf(fmaxf(fMin, mEffectiveMass * (jv - bias)), fMax);
 
+    // Static bodies are shared between pairs solved in parallel, they never receive impulses
     if (lambda != 0.0f)
     {
-        a->addLinearVelocity(-(lambda * formA->getInvertedMass()) * axis);
-        a->addAngularVelocity(-lambda * mInvI1_R1Axis);
+        if (a->getMotionType() != PhysicsMotionType::Static)
+        {
+            a->addLinearVelocity(-(lambda * formA->getInvertedMass()) * axis);
+            a->addAngularVelocity(-lambda * mInvI1_R1Axis);
+        }
 
-        b->addLinearVelocity((lambda * formB->getInvertedMass()) * axis);
-        b->addAngularVelocity(lambda * mInvI2_R2Axis);
+        if (b->getMotionType() != PhysicsMotionType::Static)
+        {
+            b->addLinearVelocity((lambda * formB->getInvertedMass()) * axis);
+            b->addAngularVelocity(lambda * mInvI2_R2Axis);
+        }
     }
 
     return lambda;
 }
+
+void CollisionSolver::prepare(PhysicsBody *a, PhysicsBody *b, const ContactPoint *points, int pointsAmount, ContactConstraint *constraints, const ContactCache *contactCache, float delta)
+{
+    if (!a->isSimulatingPhysics() || !b->isSimulatingPhysics())
+        return;
+
+    PhysicsForm *formA = a->getForm();
+    PhysicsForm *formB = b->getForm();
+    float friction = sqrtf(formA->getFriction() * formB->getFriction());
+    float restitution = fmaxf(formA->getRestitution(), formB->getRestitution());
+
+    // Only dynamic bodies have mass, static ones act like infinitely heavy
+    float invMassA = 0.0f, invMassB = 0.0f;
+    Matrix3 invInertiaA(0.0f), invInertiaB(0.0f);
+    if (a->getMotionType() == PhysicsMotionType::Dynamic)
+    {
+        Matrix3 r = glm::toMat3(a->getRotation());
+        invMassA = formA->getInvertedMass();
+        invInertiaA = r * formA->getInvertedInertia() * glm::transpose(r);
+    }
+    if (b->getMotionType() == PhysicsMotionType::Dynamic)
+    {
+        Matrix3 r = glm::toMat3(b->getRotation());
+        invMassB = formB->getInvertedMass();
+        invInertiaB = r * formB->getInvertedInertia() * glm::transpose(r);
+    }
+
+    int cachedAmount = 0;
+    const CachedContact *cached = contactCache->find(a, b, &cachedAmount);
+    Quat invRotationA = glm::inverse(a->getRotation());
+    float slop = SOLVER_LINEAR_SLOP * simScale;
+
+    for (int i = 0; i < pointsAmount; i++)
+    {
+        const ContactPoint &point = points[i];
+        ContactConstraint &constraint = constraints[i];
+
+        constraint.localPointA = invRotationA * (point.pointOnA - a->getCenterOfMass());
+        constraint.feature = point.feature;
+        constraint.rA = point.pointOnA - a->getCenterOfMass();
+        constraint.rB = point.pointOnB - b->getCenterOfMass();
+        constraint.normal = point.normal;
+        constraint.tangent1 = getNormalizedPerpendicular(point.normal);
+        constraint.tangent2 = glm::cross(point.normal, constraint.tangent1);
+        constraint.invMassA = invMassA;
+        constraint.invMassB = invMassB;
+        constraint.invInertiaA = invInertiaA;
+        constraint.invInertiaB = invInertiaB;
+        constraint.normalMass = getEffectiveMass(constraint, constraint.normal);
+        constraint.tangentMass1 = getEffectiveMass(constraint, constraint.tangent1);
+        constraint.tangentMass2 = getEffectiveMass(constraint, constraint.tangent2);
+        constraint.friction = friction;
+
+        // Push out part of the penetration, bounce if bodies hit each other fast enough
+        Vector3 relativeVelocity = b->getPointVelocity(constraint.rB) - a->getPointVelocity(constraint.rA);
+        float normalVelocity = glm::dot(relativeVelocity, constraint.normal);
+        constraint.bias = SOLVER_BAUMGARTE / delta * fmaxf(point.depth - slop, 0.0f);
+        if (restitution > 0.0f && normalVelocity < minRenormalVelocity)
+            constraint.bias = fmaxf(constraint.bias, -restitution * normalVelocity);
+
+        const CachedContact *previous = contactCache->match(cached, cachedAmount, constraint.localPointA, constraint.feature);
+        if (previous)
+        {
+            constraint.normalImpulse = previous->normalImpulse;
+            constraint.tangentImpulse1 = glm::dot(previous->tangentImpulse, constraint.tangent1);
+            constraint.tangentImpulse2 = glm::dot(previous->tangentImpulse, constraint.tangent2);
+        }
+        else
+        {
+            constraint.normalImpulse = 0.0f;
+            constraint.tangentImpulse1 = 0.0f;
+            constraint.tangentImpulse2 = 0.0f;
+        }
+    }
+}
+
+void CollisionSolver::warmStart(PhysicsBody *a, PhysicsBody *b, const ContactConstraint *constraints, int amount)
+{
+    if (!a->isSimulatingPhysics() || !b->isSimulatingPhysics())
+        return;
+
+    for (int i = 0; i < amount; i++)
+    {
+        const ContactConstraint &constraint = constraints[i];
+        Vector3 impulse = constraint.normal * constraint.normalImpulse +
+                          constraint.tangent1 * constraint.tangentImpulse1 +
+                          constraint.tangent2 * constraint.tangentImpulse2;
+        applyImpulse(a, b, constraint, impulse);
+    }
+}
+
+void CollisionSolver::solveIterative(PhysicsBody *a, PhysicsBody *b, ContactConstraint *constraints, int amount)
+{
+    if (!a->isSimulatingPhysics() || !b->isSimulatingPhysics())
+        return;
+
+    for (int i = 0; i < amount; i++)
+    {
+        ContactConstraint &constraint = constraints[i];
+
+        // Friction is limited by the normal impulse, so it goes first while that one is from the previous iteration
+        float maxFriction = constraint.friction * constraint.normalImpulse;
+        Vector3 relativeVelocity = b->getPointVelocity(constraint.rB) - a->getPointVelocity(constraint.rA);
+
+        float lambda = -constraint.tangentMass1 * glm::dot(relativeVelocity, constraint.tangent1);
+        float accumulated = fminf(fmaxf(constraint.tangentImpulse1 + lambda, -maxFriction), maxFriction);
+        lambda = accumulated - constraint.tangentImpulse1;
+        constraint.tangentImpulse1 = accumulated;
+        Vector3 impulse = constraint.tangent1 * lambda;
+
+        lambda = -constraint.tangentMass2 * glm::dot(relativeVelocity, constraint.tangent2);
+        accumulated = fminf(fmaxf(constraint.tangentImpulse2 + lambda, -maxFriction), maxFriction);
+        lambda = accumulated - constraint.tangentImpulse2;
+        constraint.tangentImpulse2 = accumulated;
+        impulse += constraint.tangent2 * lambda;
+
+        applyImpulse(a, b, constraint, impulse);
+
+        // Normal impulse can only push, total of all iterations is clamped instead of every single one
+        relativeVelocity = b->getPointVelocity(constraint.rB) - a->getPointVelocity(constraint.rA);
+        lambda = constraint.normalMass * (constraint.bias - glm::dot(relativeVelocity, constraint.normal));
+        accumulated = fmaxf(constraint.normalImpulse + lambda, 0.0f);
+        lambda = accumulated - constraint.normalImpulse;
+        constraint.normalImpulse = accumulated;
+
+        applyImpulse(a, b, constraint, constraint.normal * lambda);
+    }
+}
+
+void CollisionSolver::applyImpulse(PhysicsBody *a, PhysicsBody *b, const ContactConstraint &constraint, const Vector3 &impulse)
+{
+    if (a->getMotionType() == PhysicsMotionType::Dynamic)
+    {
+        a->addLinearVelocity(-impulse * constraint.invMassA);
+        a->addAngularVelocity(-(constraint.invInertiaA * glm::cross(constraint.rA, impulse)));
+    }
+    if (b->getMotionType() == PhysicsMotionType::Dynamic)
+    {
+        b->addLinearVelocity(impulse * constraint.invMassB);
+        b->addAngularVelocity(constraint.invInertiaB * glm::cross(constraint.rB, impulse));
+    }
+}
+
+float CollisionSolver::getEffectiveMass(const ContactConstraint &constraint, const Vector3 &axis)
+{
+    Vector3 rnA = glm::cross(constraint.rA, axis);
+    Vector3 rnB = glm::cross(constraint.rB, axis);
+    float invEffectiveMass = constraint.invMassA + constraint.invMassB +
+                             glm::dot(rnA, constraint.invInertiaA * rnA) +
+                             glm::dot(rnB, constraint.invInertiaB * rnB);
+    return invEffectiveMass > 0.0f ? 1.0f / invEffectiveMass : 0.0f;
+}
@@ -4,6 +4,13 @@
 #pragma once
 #include "physicsBody.h"
 #include "collisionManifold.h"
+#include "contactCache.h"
+
+// Part of penetration iterative solver pushes bodies apart by per substep
+#define SOLVER_BAUMGARTE 0.2f
+
+// Penetration that is left alone so resting contacts don't jitter, multiplied by simScale
+#define SOLVER_LINEAR_SLOP 0.002f
 
 struct Collision
 {
@@ -12,12 +19,32 @@ struct Collision
     CollisionPoint point;
 };
 
+// Contact point prepared for iterative solving
+// Impulses are accumulated over iterations, so every iteration only corrects what the previous ones did
+struct ContactConstraint
+{
+    Vector3 localPointA;
+    uint32_t feature;
+    Vector3 rA, rB;
+    Vector3 normal, tangent1, tangent2;
+    Matrix3 invInertiaA, invInertiaB;
+    float invMassA, invMassB;
+    float normalMass, tangentMass1, tangentMass2;
+    float bias;
+    float friction;
+    float normalImpulse, tangentImpulse1, tangentImpulse2;
+};
+
 class CollisionSolver
 {
 public:
     CollisionSolver(float simScale);
 
-    void solve(PhysicsBody *a, PhysicsBody *b, CollisionManifold &manifold, float delta);
+    // Deepest point of the pair, or all of them for compound bodies
+    void solve(PhysicsBody *a, PhysicsBody *b, const ContactPoint *points, int pointsAmount, float delta);
+
+    // Pushes bodies apart by pushShare of the penetration and solves velocities at the point
+    void solvePoint(PhysicsBody *a, PhysicsBody *b, const ContactPoint &point, float pushShare);
 
     float solveAxis(
         PhysicsBody *a,
@@ -33,7 +60,15 @@ public:
         float fMax,
         float bias);
 
+    // Iterative mode, every point of the pair is solved and impulses are carried between substeps
+    void prepare(PhysicsBody *a, PhysicsBody *b, const ContactPoint *points, int pointsAmount, ContactConstraint *constraints, const ContactCache *contactCache, float delta);
+    void warmStart(PhysicsBody *a, PhysicsBody *b, const ContactConstraint *constraints, int amount);
+    void solveIterative(PhysicsBody *a, PhysicsBody *b, ContactConstraint *constraints, int amount);
+
 protected:
+    void applyImpulse(PhysicsBody *a, PhysicsBody *b, const ContactConstraint &constraint, const Vector3 &impulse);
+    float getEffectiveMass(const ContactConstraint &constraint, const Vector3 &axis);
+
     float simScale;
     float minRenormalVelocity;
     float totalLambda;
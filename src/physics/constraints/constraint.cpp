@@ -9,4 +9,9 @@ void Constraint::processTranslation(Vector3 *translation)
 
 void Constraint::processMotion(Vector3 *linearVelocity, Vector3 *angularVelocity)
 {
+}
+
+PhysicsBody *Constraint::getLinkedBody()
+{
+    return nullptr;
 }
\ No newline at end of file
@@ -5,9 +5,15 @@
 #include "utils/utils.h"
 #include "utils/primitives.h"
 
+class PhysicsBody;
+
 class Constraint
 {
 public:
     EXPORT virtual void processTranslation(Vector3 *translation);
     EXPORT virtual void processMotion(Vector3 *linearVelocity, Vector3 *angularVelocity);
+
+    // Body this constraint ties its body to, both of them share an island and sleep and wake together
+    // Constraints limiting a single body return nullptr
+    EXPORT virtual PhysicsBody *getLinkedBody();
 };
\ No newline at end of file
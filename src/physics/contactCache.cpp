@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "contactCache.h"
+#include "collisionSolver.h"
+#include "physicsBodyStorage.h"
+#include "physicsState.h"
+
+// Pair of bodies in a saved state, false if ids don't belong to the storage
+static bool _readBodies(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage, ContactCacheKey *key)
+{
+    int ids[2];
+    if (!buffer->read(ids, 2))
+        return false;
+    int size = (int)storage->bodies.size();
+    if (ids[0] < 0 || ids[0] >= size || ids[1] < 0 || ids[1] >= size)
+        return false;
+    key->a = storage->bodies[ids[0]];
+    key->b = storage->bodies[ids[1]];
+    return true;
+}
+
+static void _writeBodies(PhysicsStateBuffer *buffer, const ContactCacheKey &key)
+{
+    int ids[2] = {key.a->getStorageId(), key.b->getStorageId()};
+    buffer->write(ids, 2);
+}
+
+const CachedContact *ContactCache::find(PhysicsBody *a, PhysicsBody *b, int *amount) const
+{
+    auto it = ranges[current].find({a, b});
+    if (it == ranges[current].end())
+    {
+        *amount = 0;
+        return nullptr;
+    }
+    *amount = it->second.amount;
+    return contacts[current].data() + it->second.start;
+}
+
+const CachedContact *ContactCache::match(const CachedContact *contacts, int amount, const Vector3 &localPointA, uint32_t feature) const
+{
+    // Same feature is the same contact even if it slid further than the match distance
+    if (feature != 0)
+    {
+        for (int i = 0; i < amount; i++)
+            if (contacts[i].feature == feature)
+                return contacts + i;
+    }
+
+    const CachedContact *closest = nullptr;
+    float closestDistance = matchDistanceSquared;
+    for (int i = 0; i < amount; i++)
+    {
+        float distance = glm::length2(contacts[i].localPointA - localPointA);
+        if (distance < closestDistance)
+        {
+            closest = contacts + i;
+            closestDistance = distance;
+        }
+    }
+    return closest;
+}
+
+void ContactCache::store(PhysicsBody *a, PhysicsBody *b, const ContactConstraint *constraints, int amount)
+{
+    int next = current ^ 1;
+    ranges[next][{a, b}] = {(int)contacts[next].size(), amount};
+    for (int i = 0; i < amount; i++)
+    {
+        const ContactConstraint &constraint = constraints[i];
+        Vector3 tangentImpulse = constraint.tangent1 * constraint.tangentImpulse1 + constraint.tangent2 * constraint.tangentImpulse2;
+        contacts[next].push_back({constraint.localPointA, constraint.feature, constraint.normal, constraint.normalImpulse, tangentImpulse});
+    }
+}
+
+void ContactCache::swap()
+{
+    ranges[current].clear();
+    contacts[current].clear();
+    current ^= 1;
+}
+
+void ContactCache::clear()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        ranges[i].clear();
+        contacts[i].clear();
+    }
+}
+
+void ContactCache::save(PhysicsStateBuffer *buffer) const
+{
+    buffer->write((int)ranges[current].size());
+    for (auto &it : ranges[current])
+    {
+        _writeBodies(buffer, it.first);
+        buffer->write(it.second.amount);
+        buffer->write(contacts[current].data() + it.second.start, it.second.amount);
+    }
+}
+
+bool ContactCache::load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage)
+{
+    clear();
+    int amount;
+    if (!buffer->read(amount))
+        return false;
+    for (int i = 0; i < amount; i++)
+    {
+        ContactCacheKey key;
+        Range range;
+        if (!_readBodies(buffer, storage, &key) || !buffer->read(range.amount) || range.amount < 0)
+            return false;
+        range.start = (int)contacts[current].size();
+        contacts[current].resize(range.start + range.amount);
+        if (!buffer->read(contacts[current].data() + range.start, range.amount))
+            return false;
+        ranges[current][key] = range;
+    }
+    return true;
+}
+
+bool AxisCache::find(PhysicsBody *a, PhysicsBody *b, Vector3 *axis) const
+{
+    // Bodies of the same type may come in any order
+    auto it = axes[current].find({a, b});
+    if (it != axes[current].end())
+    {
+        *axis = it->second;
+        return true;
+    }
+    it = axes[current].find({b, a});
+    if (it != axes[current].end())
+    {
+        *axis = -it->second;
+        return true;
+    }
+    return false;
+}
+
+void AxisCache::store(PhysicsBody *a, PhysicsBody *b, const Vector3 &axis)
+{
+    axes[current ^ 1][{a, b}] = axis;
+}
+
+void AxisCache::swap()
+{
+    axes[current].clear();
+    current ^= 1;
+}
+
+void AxisCache::clear()
+{
+    axes[0].clear();
+    axes[1].clear();
+}
+
+void AxisCache::save(PhysicsStateBuffer *buffer) const
+{
+    buffer->write((int)axes[current].size());
+    for (auto &it : axes[current])
+    {
+        _writeBodies(buffer, it.first);
+        buffer->write(it.second);
+    }
+}
+
+bool AxisCache::load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage)
+{
+    clear();
+    int amount;
+    if (!buffer->read(amount))
+        return false;
+    for (int i = 0; i < amount; i++)
+    {
+        ContactCacheKey key;
+        Vector3 axis;
+        if (!_readBodies(buffer, storage, &key) || !buffer->read(axis))
+            return false;
+        axes[current][key] = axis;
+    }
+    return true;
+}
+
+const CachedManifold *ManifoldCache::find(PhysicsBody *a, PhysicsBody *b) const
+{
+    auto it = manifolds[current].find({a, b});
+    if (it != manifolds[current].end())
+        return &it->second;
+    it = manifolds[current].find({b, a});
+    if (it != manifolds[current].end())
+        return &it->second;
+    return nullptr;
+}
+
+bool ManifoldCache::refresh(const CachedManifold *cached, CollisionManifold *manifold) const
+{
+    PhysicsBody *a = cached->a;
+    PhysicsBody *b = cached->b;
+    const Quat &rotationA = a->getRotation();
+    const Quat &rotationB = b->getRotation();
+    Quat invRotationA = glm::inverse(rotationA);
+
+    Vector3 relativePosition = invRotationA * (b->getPosition() - a->getPosition());
+    if (glm::length2(relativePosition - cached->relativePosition) > distanceSquared)
+        return false;
+    Quat relativeRotation = invRotationA * rotationB;
+    if (fabsf(glm::dot(relativeRotation, cached->relativeRotation)) < minRotationDot)
+        return false;
+
+    const CachedManifoldPoint *point = points[current].data() + cached->start;
+    for (int i = 0; i < cached->amount; i++, point++)
+    {
+        Vector3 pointOnA = a->getPosition() + rotationA * point->localPointA;
+        Vector3 pointOnB = b->getPosition() + rotationB * point->localPointB;
+        Vector3 normal = rotationA * point->localNormal;
+        float depth = glm::dot(pointOnA - pointOnB, normal) + point->depthOffset;
+        if (depth > 0.0f)
+            manifold->addCollisionPoint(pointOnA, pointOnB, depth, normal, point->feature);
+    }
+    return true;
+}
+
+void ManifoldCache::store(PhysicsBody *a, PhysicsBody *b, const ContactPoint *contactPoints, int amount)
+{
+    int next = current ^ 1;
+    Quat invRotationA = glm::inverse(a->getRotation());
+    Quat invRotationB = glm::inverse(b->getRotation());
+
+    CachedManifold cached;
+    cached.a = a;
+    cached.b = b;
+    cached.relativePosition = invRotationA * (b->getPosition() - a->getPosition());
+    cached.relativeRotation = invRotationA * b->getRotation();
+    cached.start = (int)points[next].size();
+    cached.amount = amount;
+    manifolds[next][{a, b}] = cached;
+
+    for (int i = 0; i < amount; i++)
+    {
+        const ContactPoint &contactPoint = contactPoints[i];
+        CachedManifoldPoint point;
+        point.localPointA = invRotationA * (contactPoint.pointOnA - a->getPosition());
+        point.localPointB = invRotationB * (contactPoint.pointOnB - b->getPosition());
+        point.localNormal = invRotationA * contactPoint.normal;
+        point.depthOffset = contactPoint.depth - glm::dot(contactPoint.pointOnA - contactPoint.pointOnB, contactPoint.normal);
+        point.feature = contactPoint.feature;
+        points[next].push_back(point);
+    }
+}
+
+void ManifoldCache::keep(const CachedManifold *cached)
+{
+    int next = current ^ 1;
+    CachedManifold kept = *cached;
+    kept.start = (int)points[next].size();
+    manifolds[next][{cached->a, cached->b}] = kept;
+    points[next].insert(points[next].end(), points[current].begin() + cached->start, points[current].begin() + cached->start + cached->amount);
+}
+
+void ManifoldCache::swap()
+{
+    manifolds[current].clear();
+    points[current].clear();
+    current ^= 1;
+}
+
+void ManifoldCache::clear()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        manifolds[i].clear();
+        points[i].clear();
+    }
+}
+
+void ManifoldCache::save(PhysicsStateBuffer *buffer) const
+{
+    buffer->write((int)manifolds[current].size());
+    for (auto &it : manifolds[current])
+    {
+        const CachedManifold &cached = it.second;
+        _writeBodies(buffer, it.first);
+        buffer->write(cached.relativePosition);
+        buffer->write(cached.relativeRotation);
+        buffer->write(cached.amount);
+        buffer->write(points[current].data() + cached.start, cached.amount);
+    }
+}
+
+bool ManifoldCache::load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage)
+{
+    clear();
+    int amount;
+    if (!buffer->read(amount))
+        return false;
+    for (int i = 0; i < amount; i++)
+    {
+        ContactCacheKey key;
+        CachedManifold cached;
+        if (!_readBodies(buffer, storage, &key) || !buffer->read(cached.relativePosition) || !buffer->read(cached.relativeRotation) ||
+            !buffer->read(cached.amount) || cached.amount < 0)
+            return false;
+        cached.a = key.a;
+        cached.b = key.b;
+        cached.start = (int)points[current].size();
+        points[current].resize(cached.start + cached.amount);
+        if (!buffer->read(points[current].data() + cached.start, cached.amount))
+            return false;
+        manifolds[current][key] = cached;
+    }
+    return true;
+}
@@ -0,0 +1,173 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+#include <vector>
+#include <unordered_map>
+
+class PhysicsBody;
+class PhysicsBodyStorage;
+class PhysicsStateBuffer;
+struct ContactConstraint;
+struct ContactPoint;
+class CollisionManifold;
+
+// Impulses a contact point ended the substep with, next substep starts solving from them
+struct CachedContact
+{
+    // Point in the space of body A, contacts of the next substep without the same feature are matched by it
+    Vector3 localPointA;
+    uint32_t feature;
+    Vector3 normal;
+    float normalImpulse;
+    Vector3 tangentImpulse;
+};
+
+struct ContactCacheKey
+{
+    PhysicsBody *a;
+    PhysicsBody *b;
+
+    inline bool operator==(const ContactCacheKey &other) const { return a == other.a && b == other.b; }
+};
+
+struct ContactCacheKeyHash
+{
+    inline size_t operator()(const ContactCacheKey &key) const
+    {
+        size_t hashA = std::hash<PhysicsBody *>()(key.a);
+        size_t hashB = std::hash<PhysicsBody *>()(key.b);
+        return hashA ^ (hashB + 0x9e3779b9 + (hashA << 6) + (hashA >> 2));
+    }
+};
+
+// Contacts of body pairs from the previous substep
+// Lookups are done by many jobs at once, storing is sequential and goes into a separate buffer until swap
+class ContactCache
+{
+public:
+    // Contacts pair had at the end of the previous substep, nullptr if it wasn't touching
+    EXPORT const CachedContact *find(PhysicsBody *a, PhysicsBody *b, int *amount) const;
+
+    // Contact made by the same feature inherits impulses of the cached one, ones without it are matched within this distance
+    EXPORT const CachedContact *match(const CachedContact *contacts, int amount, const Vector3 &localPointA, uint32_t feature) const;
+
+    EXPORT void store(PhysicsBody *a, PhysicsBody *b, const ContactConstraint *constraints, int amount);
+
+    // Stored contacts become the ones find returns
+    EXPORT void swap();
+
+    EXPORT void clear();
+
+    // Contacts find returns, bodies are written as their storage ids
+    EXPORT void save(PhysicsStateBuffer *buffer) const;
+    EXPORT bool load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage);
+
+    inline void setMatchDistance(float distance) { this->matchDistanceSquared = distance * distance; }
+
+protected:
+    struct Range
+    {
+        int start;
+        int amount;
+    };
+
+    std::unordered_map<ContactCacheKey, Range, ContactCacheKeyHash> ranges[2];
+    std::vector<CachedContact> contacts[2];
+    int current = 0;
+
+    float matchDistanceSquared = 0.0001f;
+};
+
+// Directions GJK ended with for body pairs of the previous substep, pairs that stay apart or keep touching start from them
+// Same as with contacts, lookups are done by many jobs at once and storing goes into a separate buffer until swap
+class AxisCache
+{
+public:
+    // Direction from A to B, false if the pair wasn't tested in the previous substep
+    EXPORT bool find(PhysicsBody *a, PhysicsBody *b, Vector3 *axis) const;
+
+    EXPORT void store(PhysicsBody *a, PhysicsBody *b, const Vector3 &axis);
+
+    EXPORT void swap();
+
+    EXPORT void clear();
+
+    EXPORT void save(PhysicsStateBuffer *buffer) const;
+    EXPORT bool load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage);
+
+protected:
+    std::unordered_map<ContactCacheKey, Vector3, ContactCacheKeyHash> axes[2];
+    int current = 0;
+};
+
+// Contact point kept in spaces of its bodies, so it can be moved along with them
+struct CachedManifoldPoint
+{
+    Vector3 localPointA;
+    Vector3 localPointB;
+
+    // Normal in the space of body A
+    Vector3 localNormal;
+
+    // Part of the depth that doesn't come from the distance between the points, some shapes put both points at one place
+    float depthOffset;
+    uint32_t feature;
+};
+
+struct CachedManifold
+{
+    PhysicsBody *a;
+    PhysicsBody *b;
+
+    // Transformation of B in the space of A when narrowphase found the points
+    Vector3 relativePosition;
+    Quat relativeRotation;
+
+    int start;
+    int amount;
+};
+
+// Manifolds of body pairs found by narrowphase in previous substeps
+// While bodies of a pair barely move against each other, their points are moved along with them instead of running narrowphase again
+// Same as with contacts, lookups are done by many jobs at once and storing goes into a separate buffer until swap
+class ManifoldCache
+{
+public:
+    // Manifold of the pair in any order of bodies, nullptr if the pair wasn't touching
+    EXPORT const CachedManifold *find(PhysicsBody *a, PhysicsBody *b) const;
+
+    // Points of the manifold at current transformations of its bodies, points that went apart are dropped
+    // False when bodies moved too far since the points were found and narrowphase has to run again
+    EXPORT bool refresh(const CachedManifold *cached, CollisionManifold *manifold) const;
+
+    // Points narrowphase has just found, bodies are where they were found at
+    EXPORT void store(PhysicsBody *a, PhysicsBody *b, const ContactPoint *points, int amount);
+
+    // Refreshed manifold goes to the next substep as it is, so small motions don't add up
+    EXPORT void keep(const CachedManifold *cached);
+
+    EXPORT void swap();
+
+    EXPORT void clear();
+
+    EXPORT void save(PhysicsStateBuffer *buffer) const;
+    EXPORT bool load(PhysicsStateBuffer *buffer, const PhysicsBodyStorage *storage);
+
+    // Distance and angle bodies may move against each other before points have to be found again
+    inline void setThresholds(float distance, float angle)
+    {
+        this->distanceSquared = distance * distance;
+        this->minRotationDot = cosf(angle * 0.5f);
+    }
+
+protected:
+    std::unordered_map<ContactCacheKey, CachedManifold, ContactCacheKeyHash> manifolds[2];
+    std::vector<CachedManifoldPoint> points[2];
+    int current = 0;
+
+    float distanceSquared = 0.000004f;
+    float minRotationDot = 0.99999f;
+};
@@ -17,174 +17,175 @@ PhysicsBody::PhysicsBody(
     this->form = form;
     this->world = world;
     this->entity = entity;
-    this->position = initialPosition;
-    this->rotation = initialRotation;
-    this->bSimulatePhysics = simulatePhysics;
 
-    sleepCheck = world->getSimScale() * 0.006f;
+    storage = world->getBodyStorage();
+    id = storage->add(this);
+    storage->positions[id] = initialPosition;
+    storage->rotations[id] = initialRotation;
+    setFlag(BODY_ENABLED, true);
+    setFlag(BODY_SIMULATED, simulatePhysics);
+    setFlag(BODY_DYNAMIC, motionType == PhysicsMotionType::Dynamic);
 
     prepareForSimulation();
 }
 
 PhysicsBody::~PhysicsBody()
 {
+    storage->remove(id);
 }
 
 void PhysicsBody::prepareForSimulation()
 {
-    if (bSimulatePhysics)
+    Vector3 &position = storage->positions[id];
+    Quat &rotation = storage->rotations[id];
+    if (isSimulatingPhysics())
     {
-        this->position = entity->getPosition() * world->getSimScale();
-        this->rotation = entity->getRotation();
+        // Interpolated entity is behind the simulation, it goes on from the transformation in storage
+        if (!isEntityInterpolated())
+        {
+            position = entity->getPosition() * world->getSimScale();
+            rotation = entity->getRotation();
+            storage->previousPositions[id] = position;
+            storage->previousRotations[id] = rotation;
+            bRendered = false;
+        }
     }
     else
     {
         const Matrix4 &model = entity->getModelMatrix();
-        this->position = Vector3(model * Vector4(0.0f, 0.0f, 0.0f, 1.0f));
-        this->rotation = glm::quat_cast(model);
+        position = Vector3(model * Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+        rotation = glm::quat_cast(model);
     }
-    updateAABB();
-    updateCache();
-}
 
-void PhysicsBody::finishSimulation()
-{
-    if (bSimulatePhysics)
+    // Form might have changed since the last frame
+    storage->invertedMasses[id] = form->getInvertedMass();
+    storage->gravityFactors[id] = form->getGravityFactor();
+    storage->invertedInertias[id] = form->getInvertedInertia();
+    storage->centersOfMass[id] = form->getCenterOfMass();
+
+    ShapeCollisionType type = form->getType();
+    bool bFormBounds = type == ShapeCollisionType::Plain || type == ShapeCollisionType::Capsule ||
+                       type == ShapeCollisionType::Combined || type == ShapeCollisionType::None;
+    setFlag(BODY_FORM_BOUNDS, bFormBounds);
+    if (!bFormBounds)
     {
-        entity->setPosition(this->position / world->getSimScale());
-        entity->setRotation(this->rotation);
+        // Bounds of the rest of the shapes are boxes around their rotated center
+        AABB local = form->getAABB(Matrix4(1.0f));
+        storage->boundsCenters[id] = (local.start + local.end) * 0.5f;
+        storage->boundsExtents[id] = (local.end - local.start) * 0.5f;
     }
+
+    _updateBounds(storage, id, id + 1);
+    updateCache();
 }
 
-void PhysicsBody::processStep(float delta, const Vector3 &gravity)
+void PhysicsBody::finishSimulation(float alpha)
 {
-    if (!bIsEnabled || !bSimulatePhysics)
+    if (!isSimulatingPhysics())
         return;
 
-    if (bIsSleeping && motionType == PhysicsMotionType::Dynamic)
+    if (!world->isInterpolating())
     {
-        if (glm::length(translationAccumulator) > sleepCheck ||
-            glm::length(linearVelocity) > sleepCheck ||
-            glm::length(angularVelocity) > sleepCheck)
-            setAwake();
-        else
-            return;
+        entity->setPosition(storage->positions[id] / world->getSimScale());
+        entity->setRotation(storage->rotations[id]);
+        return;
     }
 
-    if (motionType == PhysicsMotionType::Static)
-        return setAsleep();
-
-    Matrix3 r = glm::toMat3(rotation);
+    // Game placed the entity since the last frame, simulation takes it with the next substep
+    if (bRendered && !isEntityInterpolated())
+        return;
 
-    linearVelocity += (gravity * form->getGravityFactor() + form->getInvertedMass() * force) * delta;
-    angularVelocity += (r * (form->getInvertedInertia() * glm::transpose(r) * torque)) * delta;
+    renderPosition = glm::mix(storage->previousPositions[id], storage->positions[id], alpha) / world->getSimScale();
+    renderRotation = glm::slerp(storage->previousRotations[id], storage->rotations[id], alpha);
+    entity->setPosition(renderPosition);
+    entity->setRotation(renderRotation);
+    bRendered = true;
+}
 
-    linearVelocity -= linearVelocity * linearDamping * delta;
-    angularVelocity -= angularVelocity * angularDamping * delta;
+bool PhysicsBody::isEntityInterpolated()
+{
+    return world->isInterpolating() && bRendered && entity->getPosition() == renderPosition && entity->getRotation() == renderRotation;
+}
 
-    force = Vector3(0.0f, 0.0f, 0.0f);
-    torque = Vector3(0.0f, 0.0f, 0.0f);
+void PhysicsBody::processStep(float delta, const Vector3 &gravity)
+{
+    _integrateVelocities(storage, id, id + 1, delta, gravity);
 }
 
 void PhysicsBody::applyStep(float delta)
 {
-    if (motionType == PhysicsMotionType::Static || !bSimulatePhysics)
-        return;
-
-    if (glm::length2(translationAccumulator) > 0.0000000001f)
-    {
-        for (auto &constraint : constraints)
-            constraint->processTranslation(&translationAccumulator);
-
-        position += translationAccumulator;
-        translationAccumulator = Vector3(0.0f);
-        bIsSleeping = false;
-    }
-
-    if (!bIsSleeping && bIsEnabled)
-    {
-        checkLimits(120.0f * world->getSimScale());
-
-        for (auto &constraint : constraints)
-            constraint->processMotion(&linearVelocity, &angularVelocity);
-
-        position += linearVelocity * delta;
-
-        Vector3 angularVelocityDelta = angularVelocity * delta;
-        float len = glm::length(angularVelocityDelta);
-        if (len > 1.0e-6f)
-        {
-            rotation = glm::normalize(glm::angleAxis(len, angularVelocityDelta / len) * rotation);
-        }
-
-        if (glm::length2(linearVelocity) < sleepCheck && glm::length2(angularVelocity) < sleepCheck)
-        {
-            sleepAccumulator += delta;
-            if (sleepAccumulator > 0.2f)
-                setAsleep();
-        }
-        else
-            sleepAccumulator = 0.0f;
-
-        updateAABB();
-        updateCache();
-    }
+    _integratePositions(storage, id, id + 1, delta);
 }
 
 void PhysicsBody::translate(const Vector3 &v)
 {
     lock.lock();
-    translationAccumulator += v;
+    storage->translations[id] += v;
     lock.unlock();
 }
 
 void PhysicsBody::addLinearVelocity(const Vector3 &velocity)
 {
     lock.lock();
-    linearVelocity += velocity;
+    storage->linearVelocities[id] += velocity;
     lock.unlock();
 }
 
 void PhysicsBody::addAngularVelocity(const Vector3 &velocity)
 {
     lock.lock();
-    angularVelocity += velocity;
+    storage->angularVelocities[id] += velocity;
     lock.unlock();
 }
 
 void PhysicsBody::updateCache()
 {
-    if (!cache)
+    int shapesAmount = form->getShapesAmount();
+    if (!cache || cacheBodies != shapesAmount)
     {
-        cacheBodies = 1;
-        cache = new PhysicsBodyCache[1];
-        memset(cache, 0, sizeof(PhysicsBodyCache) * cacheBodies);
+        // Form without shapes still gets one, so queries don't need to check
+        delete[] cache;
+        cacheBodies = shapesAmount;
+        int cacheAmount = shapesAmount > 0 ? shapesAmount : 1;
+        cache = new PhysicsBodyCache[cacheAmount];
+        memset(cache, 0, sizeof(PhysicsBodyCache) * cacheAmount);
     }
 
-    if (form->getType() == ShapeCollisionType::Sphere)
+    // Every shape of a compound form has its own cache
+    for (int i = 0; i < shapesAmount; i++)
+        updateShapeCache(form->getShape(i), &cache[i]);
+}
+
+void PhysicsBody::updateShapeCache(Shape *shape, PhysicsBodyCache *shapeCache)
+{
+    const Vector3 &position = storage->positions[id];
+    const Quat &rotation = storage->rotations[id];
+    ShapeCollisionType type = shape->getType();
+
+    if (type == ShapeCollisionType::Sphere)
     {
-        ShapeSphere *sphere = (ShapeSphere *)form->getSimpleShape();
-        cache[0].sphere.center = position;
-        cache[0].sphere.radius = sphere->getRadius();
+        ShapeSphere *sphere = (ShapeSphere *)shape;
+        shapeCache->sphere.center = position + rotation * sphere->getCenter();
+        shapeCache->sphere.radius = sphere->getRadius();
         return;
     }
 
-    if (form->getType() == ShapeCollisionType::Capsule)
+    if (type == ShapeCollisionType::Capsule)
     {
-        ShapeCapsule *capsule = (ShapeCapsule *)form->getSimpleShape();
+        ShapeCapsule *capsule = (ShapeCapsule *)shape;
 
         Matrix4 m = glm::toMat4(rotation);
         Matrix4 transformation = glm::translate(Matrix4(1.0f), position) * m;
 
-        cache[0].capsule.a = Vector3(transformation * Vector4(capsule->getA(), 1.0f));
-        cache[0].capsule.b = Vector3(transformation * Vector4(capsule->getB(), 1.0f));
-        cache[0].capsule.radius = capsule->getRadius();
+        shapeCache->capsule.a = Vector3(transformation * Vector4(capsule->getA(), 1.0f));
+        shapeCache->capsule.b = Vector3(transformation * Vector4(capsule->getB(), 1.0f));
+        shapeCache->capsule.radius = capsule->getRadius();
         return;
     }
 
-    if (form->getType() == ShapeCollisionType::Convex)
+    if (type == ShapeCollisionType::Convex)
     {
-        ShapeConvex *convex = (ShapeConvex *)form->getSimpleShape();
+        ShapeConvex *convex = (ShapeConvex *)shape;
         Matrix4 m = glm::toMat4(rotation);
         Matrix4 transformation = glm::translate(Matrix4(1.0f), position) * m;
         Vector3 *verticies = convex->getVerticies();
@@ -192,73 +193,72 @@ void PhysicsBody::updateCache()
         int verticiesAmount = convex->getVerticiesAmount();
         int polygonsAmount = convex->getPolygonsAmount();
 
-        if (!cache[0].convex.verticies)
+        if (!shapeCache->convex.verticies)
         {
-            cache[0].convex.verticies = new Vector3[verticiesAmount];
-            cache[0].convex.locVerticies = new Vector3[verticiesAmount];
-            cache[0].convex.normals = new Vector3[polygonsAmount];
-            cache[0].convex.locNormals = new Vector3[polygonsAmount];
+            shapeCache->convex.verticies = new Vector3[verticiesAmount];
+            shapeCache->convex.locVerticies = new Vector3[verticiesAmount];
+            shapeCache->convex.normals = new Vector3[polygonsAmount];
+            shapeCache->convex.locNormals = new Vector3[polygonsAmount];
         }
 
-        cache[0].convex.center = position;
+        shapeCache->convex.center = position + rotation * convex->getCenter();
         for (int i = 0; i < verticiesAmount; i++)
-            cache[0].convex.verticies[i] = Vector3(transformation * Vector4(verticies[i], 1.0f));
+            shapeCache->convex.verticies[i] = Vector3(transformation * Vector4(verticies[i], 1.0f));
         for (int p = 0; p < polygonsAmount; p++)
-            cache[0].convex.normals[p] = rotateNormal(polygons[p].normal, rotation);
+            shapeCache->convex.normals[p] = rotateNormal(polygons[p].normal, rotation);
 
         return;
     }
 
-    if (form->getType() == ShapeCollisionType::OBB)
+    if (type == ShapeCollisionType::OBB)
     {
-        ShapeOBB *OBBShape = (ShapeOBB *)form->getSimpleShape();
+        ShapeOBB *OBBShape = (ShapeOBB *)shape;
         Matrix4 m = glm::toMat4(rotation);
-        Matrix4 transformation = glm::translate(Matrix4(1.0f), position) * m;
+        Matrix4 transformation = glm::translate(Matrix4(1.0f), position) * m * glm::translate(Matrix4(1.0f), OBBShape->getCenter());
 
         float halfWidth = OBBShape->getHalfWidth();
         float halfHeight = OBBShape->getHalfHeight();
         float halfDepth = OBBShape->getHalfDepth();
 
-        cache[0].OBB.center = position;
-
-        cache[0].OBB.points[0] = Vector3(transformation * Vector4(halfWidth, halfHeight, halfDepth, 1.0f));
-        cache[0].OBB.points[1] = Vector3(transformation * Vector4(halfWidth, halfHeight, -halfDepth, 1.0f));
-        cache[0].OBB.points[2] = Vector3(transformation * Vector4(-halfWidth, halfHeight, halfDepth, 1.0f));
-        cache[0].OBB.points[3] = Vector3(transformation * Vector4(-halfWidth, halfHeight, -halfDepth, 1.0f));
-        cache[0].OBB.points[4] = Vector3(transformation * Vector4(halfWidth, -halfHeight, halfDepth, 1.0f));
-        cache[0].OBB.points[5] = Vector3(transformation * Vector4(halfWidth, -halfHeight, -halfDepth, 1.0f));
-        cache[0].OBB.points[6] = Vector3(transformation * Vector4(-halfWidth, -halfHeight, halfDepth, 1.0f));
-        cache[0].OBB.points[7] = Vector3(transformation * Vector4(-halfWidth, -halfHeight, -halfDepth, 1.0f));
-
-        cache[0].OBB.normals[0] = rotateNormal(glm::vec4(0.0f, 1.0f, 0.0f, 0.0f), rotation);
-        cache[0].OBB.normals[1] = rotateNormal(glm::vec4(0.0f, -1.0f, 0.0f, 0.0f), rotation);
-        cache[0].OBB.normals[2] = rotateNormal(glm::vec4(1.0f, 0.0f, 0.0f, 0.0f), rotation);
-        cache[0].OBB.normals[3] = rotateNormal(glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f), rotation);
-        cache[0].OBB.normals[4] = rotateNormal(glm::vec4(0.0f, 0.0f, 1.0f, 0.0f), rotation);
-        cache[0].OBB.normals[5] = rotateNormal(glm::vec4(0.0f, 0.0f, -1.0f, 0.0f), rotation);
-
-        cache[0].OBB.axisX = Vector3(m * Vector4(1.0f, 0.0f, 0.0f, 1.0f));
-        cache[0].OBB.axisY = Vector3(m * Vector4(0.0f, 1.0f, 0.0f, 1.0f));
-        cache[0].OBB.axisZ = Vector3(m * Vector4(0.0f, 0.0f, 1.0f, 1.0f));
-
-        cache[0].OBB.transformation = transformation;
+        shapeCache->OBB.center = Vector3(transformation * Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+
+        shapeCache->OBB.points[0] = Vector3(transformation * Vector4(halfWidth, halfHeight, halfDepth, 1.0f));
+        shapeCache->OBB.points[1] = Vector3(transformation * Vector4(halfWidth, halfHeight, -halfDepth, 1.0f));
+        shapeCache->OBB.points[2] = Vector3(transformation * Vector4(-halfWidth, halfHeight, halfDepth, 1.0f));
+        shapeCache->OBB.points[3] = Vector3(transformation * Vector4(-halfWidth, halfHeight, -halfDepth, 1.0f));
+        shapeCache->OBB.points[4] = Vector3(transformation * Vector4(halfWidth, -halfHeight, halfDepth, 1.0f));
+        shapeCache->OBB.points[5] = Vector3(transformation * Vector4(halfWidth, -halfHeight, -halfDepth, 1.0f));
+        shapeCache->OBB.points[6] = Vector3(transformation * Vector4(-halfWidth, -halfHeight, halfDepth, 1.0f));
+        shapeCache->OBB.points[7] = Vector3(transformation * Vector4(-halfWidth, -halfHeight, -halfDepth, 1.0f));
+
+        shapeCache->OBB.normals[0] = rotateNormal(glm::vec4(0.0f, 1.0f, 0.0f, 0.0f), rotation);
+        shapeCache->OBB.normals[1] = rotateNormal(glm::vec4(0.0f, -1.0f, 0.0f, 0.0f), rotation);
+        shapeCache->OBB.normals[2] = rotateNormal(glm::vec4(1.0f, 0.0f, 0.0f, 0.0f), rotation);
+        shapeCache->OBB.normals[3] = rotateNormal(glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f), rotation);
+        shapeCache->OBB.normals[4] = rotateNormal(glm::vec4(0.0f, 0.0f, 1.0f, 0.0f), rotation);
+        shapeCache->OBB.normals[5] = rotateNormal(glm::vec4(0.0f, 0.0f, -1.0f, 0.0f), rotation);
+
+        shapeCache->OBB.axisX = Vector3(m * Vector4(1.0f, 0.0f, 0.0f, 1.0f));
+        shapeCache->OBB.axisY = Vector3(m * Vector4(0.0f, 1.0f, 0.0f, 1.0f));
+        shapeCache->OBB.axisZ = Vector3(m * Vector4(0.0f, 0.0f, 1.0f, 1.0f));
+
+        shapeCache->OBB.transformation = transformation;
         return;
     }
 
-    if (form->getType() == ShapeCollisionType::Mesh)
+    if (type == ShapeCollisionType::Mesh)
     {
-        // ShapeMesh *meshShape = (ShapeMesh *)form->getSimpleShape();
-        cache[0].mesh.transformation = glm::translate(Matrix4(1.0f), position) * glm::toMat4(rotation) * glm::scale(Matrix4(1.0f), entity->getScale());
-        cache[0].mesh.invTransformation = glm::inverse(cache[0].mesh.transformation);
+        shapeCache->mesh.transformation = glm::translate(Matrix4(1.0f), position) * glm::toMat4(rotation) * glm::scale(Matrix4(1.0f), entity->getScale());
+        shapeCache->mesh.invTransformation = glm::inverse(shapeCache->mesh.transformation);
         return;
     }
 
-    if (form->getType() == ShapeCollisionType::Plain)
+    if (type == ShapeCollisionType::Plain)
     {
-        ShapePlain *plain = (ShapePlain *)form->getSimpleShape();
+        ShapePlain *plain = (ShapePlain *)shape;
         Vector3 normal = rotation * plain->getNormal();
-        cache[0].plain.normal = normal;
-        cache[0].plain.distance = plain->getDistance() + glm::dot(position, normal);
+        shapeCache->plain.normal = normal;
+        shapeCache->plain.distance = plain->getDistance() + glm::dot(position, normal);
         return;
     }
 }
@@ -275,10 +275,39 @@ int PhysicsBody::castRay(const Segment &ray, PhysicsBodyPoint *newPoints)
     return 0;
 }
 
+float PhysicsBody::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest)
+{
+    if (cache)
+    {
+        float distance = form->getSegmentDistance(segment, closest, cache);
+        closest->userData = userData;
+        return distance;
+    }
+    return FLT_MAX;
+}
+
+float PhysicsBody::sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, bool bApproachingOnly)
+{
+    if (cache)
+    {
+        float time = form->sweepSegment(segment, radius, translation, maxTime, tolerance, closest, cache, bApproachingOnly);
+        closest->userData = userData;
+        return time;
+    }
+    return FLT_MAX;
+}
+
+void PhysicsBody::enableCCD(float radius)
+{
+    ccdRadius = radius > 0.0f ? radius * world->getSimScale() : form->getInnerRadius();
+    setFlag(BODY_CCD, ccdRadius > 0.0f);
+}
+
 void PhysicsBody::addConstraint(Constraint *constraint)
 {
     removeConstraint(constraint);
     constraints.push_back(constraint);
+    setFlag(BODY_CONSTRAINED, true);
 }
 
 void PhysicsBody::removeConstraint(Constraint *constraint)
@@ -288,6 +317,7 @@ void PhysicsBody::removeConstraint(Constraint *constraint)
         if ((*it) == constraint)
         {
             constraints.erase(it);
+            setFlag(BODY_CONSTRAINED, !constraints.empty());
             return;
         }
     }
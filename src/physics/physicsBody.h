@@ -8,11 +8,16 @@
 #include "utils/primitives.h"
 #include "constraints/constraint.h"
 #include "physicsForm.h"
+#include "physicsBodyStorage.h"
 #include "collisionHandler.h"
 #include "channels.h"
 #include <mutex>
 
 class PhysicsWorld;
+class DynamicTree;
+
+// Time body has to rest before its island is allowed to fall asleep
+#define PHYSICS_SLEEP_TIME 0.2f
 
 enum class PhysicsMotionType
 {
@@ -34,7 +39,8 @@ public:
     EXPORT virtual ~PhysicsBody();
 
     EXPORT void prepareForSimulation();
-    EXPORT void finishSimulation();
+    // Alpha is the part of substep simulated since the previous transformation, 1 puts entity at the current one
+    EXPORT void finishSimulation(float alpha = 1.0f);
     EXPORT void processStep(float delta, const Vector3 &gravity);
     EXPORT void applyStep(float delta);
 
@@ -45,10 +51,24 @@ public:
     EXPORT void updateCache();
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints);
+    // Closest point of the body to the segment, FLT_MAX if the body has no shape
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest);
+    // Time of the capsule around the segment moved along translation touching the body, FLT_MAX if it doesn't before maxTime
+    // With bApproachingOnly contacts the capsule starts in don't stop it unless it moves into them
+    EXPORT float sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, bool bApproachingOnly = false);
+
+    // Continuous collision detection, a body that moves further than a part of radius in a substep is swept
+    // as a sphere of this radius and stopped right behind the first surface it touches, so it can't tunnel
+    // Radius 0 takes the sphere that fits into the form
+    EXPORT void enableCCD(float radius = 0.0f);
+    inline void disableCCD() { setFlag(BODY_CCD, false); }
+    inline bool isCCDEnabled() { return storage->flags[id] & BODY_CCD; }
+    inline float getCCDRadius() const { return ccdRadius; }
 
     EXPORT void addConstraint(Constraint *constraint);
     EXPORT void removeConstraint(Constraint *constraint);
     EXPORT std::vector<Constraint *> *getConstraints();
+    inline bool isConstrained() { return storage->flags[id] & BODY_CONSTRAINED; }
 
     inline void setUserData(void *userData) { this->userData = userData; }
     inline void *getUserData() { return userData; }
@@ -59,42 +79,69 @@ public:
     inline void setCollisionHandler(CollisionHandler *collisionHandler) { this->collisionHandler = collisionHandler; }
     inline CollisionHandler *getCollisionHandler() { return this->collisionHandler; }
 
-    inline Vector3 getPointVelocity(const Vector3 &localPoint) { return linearVelocity + glm::cross(angularVelocity, localPoint); }
-    inline const Vector3 &getLinearVelocity() { return linearVelocity; }
-    inline const Vector3 &getAngularVelocity() { return angularVelocity; }
+    inline Vector3 getPointVelocity(const Vector3 &localPoint) { return storage->linearVelocities[id] + glm::cross(storage->angularVelocities[id], localPoint); }
+    inline const Vector3 &getLinearVelocity() { return storage->linearVelocities[id]; }
+    inline const Vector3 &getAngularVelocity() { return storage->angularVelocities[id]; }
 
-    inline bool isSleeping() { return bIsSleeping; }
-    inline void forceWake() { bIsSleeping = false; }
-    inline bool isEnabled() { return this->bIsEnabled; }
-    inline void setEnabled(bool bState) { this->bIsEnabled = bState; }
-    inline bool isSimulatingPhysics() { return this->bSimulatePhysics; }
+    inline bool isSleeping() { return storage->flags[id] & BODY_SLEEPING; }
+    inline bool isReadyToSleep() { return storage->sleepAccumulators[id] > PHYSICS_SLEEP_TIME; }
+    inline void forceWake() { setFlag(BODY_SLEEPING, false); }
+    inline bool isEnabled() { return storage->flags[id] & BODY_ENABLED; }
+    inline void setEnabled(bool bState) { setFlag(BODY_ENABLED, bState); }
+    inline bool isSimulatingPhysics() { return storage->flags[id] & BODY_SIMULATED; }
     inline PhysicsMotionType getMotionType() { return motionType; }
 
     inline void setAsleep()
     {
-        bIsSleeping = true;
-        linearVelocity = Vector3(0.0f);
-        angularVelocity = Vector3(0.0f);
-        translationAccumulator = Vector3(0.0f);
+        setFlag(BODY_SLEEPING, true);
+        storage->linearVelocities[id] = Vector3(0.0f);
+        storage->angularVelocities[id] = Vector3(0.0f);
+        storage->translations[id] = Vector3(0.0f);
     }
 
     inline void setAwake()
     {
-        bIsSleeping = false;
-        sleepAccumulator = 0.0f;
+        setFlag(BODY_SLEEPING, false);
+        storage->sleepAccumulators[id] = 0.0f;
     }
 
     inline ShapeCollisionType getType() const { return form->getType(); }
-    inline const AABB &getAABB() const { return aabb; }
+    inline const AABB &getAABB() const { return storage->aabbs[id]; }
 
-    inline const Vector3 &getCenterOfMass() const { return position; }
+    inline Vector3 getCenterOfMass() const { return storage->positions[id] + storage->rotations[id] * storage->centersOfMass[id]; }
 
     inline PhysicsForm *getForm() const { return form; }
 
     inline PhysicsWorld *getPhysicsWorld() const { return world; }
 
-    inline const Quat &getRotation() const { return rotation; }
-    inline const Vector3 &getPosition() const { return position; }
+    inline DynamicTree *getBroadphaseTree() const { return broadphaseTree; }
+    inline int getBroadphaseProxy() const { return broadphaseProxy; }
+    inline void setBroadphaseProxy(DynamicTree *tree, int proxy)
+    {
+        this->broadphaseTree = tree;
+        this->broadphaseProxy = proxy;
+    }
+
+    inline uint64_t getSolverBatches() const { return solverBatches; }
+    inline void setSolverBatches(uint64_t solverBatches) { this->solverBatches = solverBatches; }
+
+    inline int getSweepProxy() const { return sweepProxy; }
+    inline void setSweepProxy(int proxy) { this->sweepProxy = proxy; }
+
+    // Entity gets the simulated transformation with the next finish even if the game moved it
+    inline void resetRenderTransformation() { bRendered = false; }
+
+    inline int getIsland() const { return island; }
+    inline void setIsland(int island) { this->island = island; }
+    inline int getIslandNode() const { return islandNode; }
+    inline void setIslandNode(int islandNode) { this->islandNode = islandNode; }
+
+    inline const Quat &getRotation() const { return storage->rotations[id]; }
+    inline const Vector3 &getPosition() const { return storage->positions[id]; }
+
+    // Index of the body's state in world's body storage, changes when other bodies are removed
+    inline int getStorageId() const { return id; }
+    inline void setStorageId(int id) { this->id = id; }
 
     PhysicsBodyCacheTypeSphere *getCacheSphere(int bodyNum) { return &cache[bodyNum].sphere; }
     PhysicsBodyCacheTypePlain *getCachePlain(int bodyNum) { return &cache[bodyNum].plain; }
@@ -104,16 +151,17 @@ public:
     PhysicsBodyCacheTypeMesh *getCacheMesh(int bodyNum) { return &cache[bodyNum].mesh; }
 
 protected:
-    inline void checkLimits(float limit)
-    {
-        if (glm::length(linearVelocity) > limit)
-            linearVelocity = glm::normalize(linearVelocity) * limit;
-    }
-    inline void updateAABB()
+    void updateShapeCache(Shape *shape, PhysicsBodyCache *shapeCache);
+
+    // Entity still has the transformation interpolation gave it
+    bool isEntityInterpolated();
+
+    inline void setFlag(uint8_t flag, bool bState)
     {
-        aabbEntity.setPosition(position);
-        aabbEntity.setRotation(rotation);
-        aabb = form->getAABB(aabbEntity.getModelMatrix());
+        if (bState)
+            storage->flags[id] |= flag;
+        else
+            storage->flags[id] &= ~flag;
     }
 
     // Cached data used by collision dataction
@@ -129,43 +177,41 @@ protected:
 
     // Channel
     Channel channel = CHANNEL_NONE;
-    // Constraints
-    std::vector<Constraint *> constraints;
 
-    // Main movement parameters
-    Vector3 position = Vector3({0.0f, 0.0f, 0.0f});
-    Quat rotation = Quat(1.0f, 0.0f, 0.0f, 0.0f);
-    Vector3 linearVelocity = Vector3(0.0f, 0.0f, 0.0f);
-    Vector3 angularVelocity = Vector3(0.0f, 0.0f, 0.0f);
-    float linearDamping = 0.2f;
-    float angularDamping = 0.25f;
+    // Sphere swept by continuous collision detection, in simulation scale
+    float ccdRadius = 0.0f;
 
-    // If body rests for enough time put it to sleep
-    float sleepAccumulator = 0.0f;
+    // Interpolated transformation last written into the entity, if the entity has another one then the game moved it
+    Vector3 renderPosition = Vector3(0.0f);
+    Quat renderRotation = Quat(1.0f, 0.0f, 0.0f, 0.0f);
+    bool bRendered = false;
 
-    // Physics space force, reseted to zero on process
-    Vector3 force = Vector3(0.0f, 0.0f, 0.0f);
-
-    // Physics space torque, reseted to zero on process
-    Vector3 torque = Vector3(0.0f, 0.0f, 0.0f);
+    // Constraints
+    std::vector<Constraint *> constraints;
 
-    // Accumulates translation in space from collisions
-    Vector3 translationAccumulator = Vector3(0.0f);
+    // Movement state, velocities, flags and bounds live in world's storage under this id
+    PhysicsBodyStorage *storage = nullptr;
+    int id = -1;
 
     // Motion type
     PhysicsMotionType motionType = PhysicsMotionType::Static;
 
-    // If velocity or translation is lower than this then entity falls asleep
-    float sleepCheck;
-
-    // Flags
-    bool bIsSleeping = false;
-    bool bIsEnabled = true;
-    bool bSimulatePhysics = true;
-
     // Multithreading protection
     std::mutex lock;
 
-    Entity aabbEntity;
-    AABB aabb;
+    // Broadphase tree the body is currently in, managed by the world
+    DynamicTree *broadphaseTree = nullptr;
+    int broadphaseProxy = -1;
+
+    // Proxy in sweep and prune lists, managed by the world
+    int sweepProxy = -1;
+
+    // Bit for every solver batch that already has a contact with this body
+    uint64_t solverBatches = 0;
+
+    // Sleeping island the body is in, -1 while awake
+    int island = -1;
+
+    // Position in the world's body list while islands are built
+    int islandNode = -1;
 };
@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "physicsBodyStorage.h"
+#include "physicsBody.h"
+
+int PhysicsBodyStorage::add(PhysicsBody *body)
+{
+    int id = (int)bodies.size();
+    bodies.push_back(body);
+    positions.push_back(Vector3(0.0f));
+    rotations.push_back(Quat(1.0f, 0.0f, 0.0f, 0.0f));
+    linearVelocities.push_back(Vector3(0.0f));
+    angularVelocities.push_back(Vector3(0.0f));
+    forces.push_back(Vector3(0.0f));
+    torques.push_back(Vector3(0.0f));
+    translations.push_back(Vector3(0.0f));
+    previousPositions.push_back(Vector3(0.0f));
+    previousRotations.push_back(Quat(1.0f, 0.0f, 0.0f, 0.0f));
+    sleepAccumulators.push_back(0.0f);
+    linearDampings.push_back(0.2f);
+    angularDampings.push_back(0.25f);
+    invertedMasses.push_back(0.0f);
+    gravityFactors.push_back(1.0f);
+    invertedInertias.push_back(Matrix3(1.0f));
+    centersOfMass.push_back(Vector3(0.0f));
+    boundsCenters.push_back(Vector3(0.0f));
+    boundsExtents.push_back(Vector3(0.0f));
+    aabbs.push_back(AABB(Vector3(0.0f), Vector3(0.0f)));
+    flags.push_back(0);
+    return id;
+}
+
+void PhysicsBodyStorage::remove(int id)
+{
+    int last = (int)bodies.size() - 1;
+    if (id != last)
+    {
+        bodies[id] = bodies[last];
+        positions[id] = positions[last];
+        rotations[id] = rotations[last];
+        linearVelocities[id] = linearVelocities[last];
+        angularVelocities[id] = angularVelocities[last];
+        forces[id] = forces[last];
+        torques[id] = torques[last];
+        translations[id] = translations[last];
+        previousPositions[id] = previousPositions[last];
+        previousRotations[id] = previousRotations[last];
+        sleepAccumulators[id] = sleepAccumulators[last];
+        linearDampings[id] = linearDampings[last];
+        angularDampings[id] = angularDampings[last];
+        invertedMasses[id] = invertedMasses[last];
+        gravityFactors[id] = gravityFactors[last];
+        invertedInertias[id] = invertedInertias[last];
+        centersOfMass[id] = centersOfMass[last];
+        boundsCenters[id] = boundsCenters[last];
+        boundsExtents[id] = boundsExtents[last];
+        aabbs[id] = aabbs[last];
+        flags[id] = flags[last];
+        bodies[id]->setStorageId(id);
+    }
+
+    bodies.pop_back();
+    positions.pop_back();
+    rotations.pop_back();
+    linearVelocities.pop_back();
+    angularVelocities.pop_back();
+    forces.pop_back();
+    torques.pop_back();
+    translations.pop_back();
+    previousPositions.pop_back();
+    previousRotations.pop_back();
+    sleepAccumulators.pop_back();
+    linearDampings.pop_back();
+    angularDampings.pop_back();
+    invertedMasses.pop_back();
+    gravityFactors.pop_back();
+    invertedInertias.pop_back();
+    centersOfMass.pop_back();
+    boundsCenters.pop_back();
+    boundsExtents.pop_back();
+    aabbs.pop_back();
+    flags.pop_back();
+}
@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/primitives.h"
+#include "utils/AABB.h"
+#include "physicsKernels.h"
+#include <vector>
+
+class PhysicsBody;
+
+#define BODY_ENABLED 1
+#define BODY_SIMULATED 2
+#define BODY_SLEEPING 4
+#define BODY_DYNAMIC 8
+#define BODY_CONSTRAINED 16
+#define BODY_FORM_BOUNDS 32 // Bounds depend on rotation, form has to calculate them
+#define BODY_CCD 64          // Fast movement is swept against other bodies
+
+// Hot state of all the bodies of a world, every field is its own array indexed by body id
+// Integration walks these arrays instead of jumping between body objects scattered over the heap
+class PhysicsBodyStorage
+{
+public:
+    EXPORT int add(PhysicsBody *body);
+
+    // Last body takes the place of the removed one and gets its id
+    EXPORT void remove(int id);
+
+    inline int size() { return (int)bodies.size(); }
+
+    std::vector<PhysicsBody *> bodies;
+    std::vector<Vector3> positions;
+    std::vector<Quat> rotations;
+    std::vector<Vector3> linearVelocities;
+    std::vector<Vector3> angularVelocities;
+
+    // Reseted to zero by integration
+    std::vector<Vector3> forces;
+    std::vector<Vector3> torques;
+
+    // Translation from collisions, applied with the next step
+    std::vector<Vector3> translations;
+
+    // Transformation before the last substep, entities are placed between it and the current one
+    std::vector<Vector3> previousPositions;
+    std::vector<Quat> previousRotations;
+
+    std::vector<float> sleepAccumulators;
+    std::vector<float> linearDampings;
+    std::vector<float> angularDampings;
+
+    // Copied from forms every frame, so integration doesn't have to go through the form pointer
+    std::vector<float> invertedMasses;
+    std::vector<float> gravityFactors;
+    std::vector<Matrix3> invertedInertias;
+
+    // Point in body space the body rotates around, positions stay at the origin of the form
+    std::vector<Vector3> centersOfMass;
+
+    // Bounds in body space, world bounds are the same box moved with body's center
+    std::vector<Vector3> boundsCenters;
+    std::vector<Vector3> boundsExtents;
+    std::vector<AABB> aabbs;
+
+    std::vector<uint8_t> flags;
+
+    // If velocity or translation is lower than this then body is resting
+    float sleepCheck = 0.006f;
+
+    // Bodies never move faster than this
+    float velocityLimit = 120.0f;
+
+    SimdLevel simdLevel = SimdLevel::Scalar;
+};
@@ -104,12 +104,19 @@ ShapeMesh *PhysicsForm::createMesh(Mesh *mesh, float density)
     return newMesh;
 }
 
+// Inertia of a point mass at this offset, moves inertia from the center of a shape to another point
+inline Matrix3 _getOffsetInertia(float mass, const Vector3 &offset)
+{
+    return mass * (glm::dot(offset, offset) * Matrix3(1.0f) - glm::outerProduct(offset, offset));
+}
+
 void PhysicsForm::recalcParameters()
 {
     if (isDataDirty)
     {
         isDataDirty = false;
 
+        centerOfMass = Vector3(0.0f);
         if (shapes.size() == 0)
         {
             type = ShapeCollisionType::None;
@@ -125,10 +132,37 @@ void PhysicsForm::recalcParameters()
         if (shapes.size() > 1)
         {
             type = ShapeCollisionType::Combined;
-            invertedInteria = glm::inverse(shapes.at(0)->getInertiaTensor());
+
+            // Center of every shape, hulls use the average of their verticies
+            std::vector<Vector3> centers(shapes.size());
             mass = 0.0f;
-            for (auto &shape : shapes)
+            shapesTree.clear();
+            shapesTree.setMargin(0.0f);
+            for (int i = 0; i < (int)shapes.size(); i++)
+            {
+                Shape *shape = shapes.at(i);
+                AABB bounds = shape->getAABB(Matrix4(1.0f));
+                centers[i] = shape->getType() == ShapeCollisionType::Convex ? ((ShapeConvex *)shape)->getCenter() : bounds.getCenter();
                 mass += shape->getMass();
+                centerOfMass += centers[i] * shape->getMass();
+                shapesTree.createProxy(bounds, (void *)(intptr_t)i);
+            }
+            if (mass > 0.0f)
+                centerOfMass /= mass;
+
+            // Body rotates around the center of mass, inertia of every shape is moved there from its center
+            // Hull inertia is taken around the origin of the form, so it is moved to the center of the hull first
+            Matrix3 inertia(0.0f);
+            for (int i = 0; i < (int)shapes.size(); i++)
+            {
+                Shape *shape = shapes.at(i);
+                float shapeMass = shape->getMass();
+                inertia += shape->getInertiaTensor();
+                if (shape->getType() == ShapeCollisionType::Convex)
+                    inertia -= _getOffsetInertia(shapeMass, centers[i]);
+                inertia += _getOffsetInertia(shapeMass, centers[i] - centerOfMass);
+            }
+            invertedInteria = glm::inverse(inertia);
         }
 
         invertedMass = 1.0f / mass;
@@ -154,6 +188,28 @@ AABB PhysicsForm::getAABB(const Matrix4 &model)
     return AABB(p, p);
 }
 
+float PhysicsForm::getInnerRadius()
+{
+    if (shapes.size() == 1)
+    {
+        Shape *shape = shapes.at(0);
+        if (type == ShapeCollisionType::Sphere)
+            return ((ShapeSphere *)shape)->getRadius();
+        if (type == ShapeCollisionType::Capsule)
+            return ((ShapeCapsule *)shape)->getRadius();
+        if (type == ShapeCollisionType::OBB)
+        {
+            ShapeOBB *OBB = (ShapeOBB *)shape;
+            return fminf(OBB->getHalfWidth(), fminf(OBB->getHalfHeight(), OBB->getHalfDepth()));
+        }
+    }
+
+    // Other shapes are only guessed by their bounds
+    AABB bounds = getAABB(Matrix4(1.0f));
+    Vector3 size = bounds.end - bounds.start;
+    return fminf(size.x, fminf(size.y, size.z)) * 0.25f;
+}
+
 int PhysicsForm::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache)
 {
     if (shapes.size() == 0)
@@ -164,5 +220,60 @@ int PhysicsForm::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, Physic
     {
         return shapes.at(0)->castRay(ray, newPoints, &cache[0]);
     }
-    return 0;
+
+    // Hits of every shape, the furthest ones are replaced when there are too many
+    int count = 0;
+    PhysicsBodyPoint shapePoints[FORM_MAX_RAY_POINTS];
+    for (int i = 0; i < (int)shapes.size(); i++)
+    {
+        int shapeCount = shapes.at(i)->castRay(ray, shapePoints, &cache[i]);
+        for (int p = 0; p < shapeCount; p++)
+        {
+            if (count < FORM_MAX_RAY_POINTS)
+            {
+                newPoints[count++] = shapePoints[p];
+                continue;
+            }
+            int furthest = 0;
+            for (int n = 1; n < count; n++)
+                if (newPoints[n].distance > newPoints[furthest].distance)
+                    furthest = n;
+            if (shapePoints[p].distance < newPoints[furthest].distance)
+                newPoints[furthest] = shapePoints[p];
+        }
+    }
+    return count;
+}
+
+float PhysicsForm::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    float distance = FLT_MAX;
+    PhysicsBodyPoint shapeClosest;
+    for (int i = 0; i < (int)shapes.size(); i++)
+    {
+        float shapeDistance = shapes.at(i)->getSegmentDistance(segment, &shapeClosest, &cache[i]);
+        if (shapeDistance < distance)
+        {
+            distance = shapeDistance;
+            *closest = shapeClosest;
+        }
+    }
+    return distance;
+}
+
+float PhysicsForm::sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly)
+{
+    // Every next shape only has to be hit before the earliest hit found
+    float time = FLT_MAX;
+    PhysicsBodyPoint shapeClosest;
+    for (int i = 0; i < (int)shapes.size(); i++)
+    {
+        float shapeTime = shapes.at(i)->sweepSegment(segment, radius, translation, time == FLT_MAX ? maxTime : time, tolerance, &shapeClosest, &cache[i], bApproachingOnly);
+        if (shapeTime < time)
+        {
+            time = shapeTime;
+            *closest = shapeClosest;
+        }
+    }
+    return time;
 }
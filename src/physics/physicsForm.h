@@ -12,8 +12,12 @@
 #include "shapes/shapeCapsule.h"
 #include "shapes/shapeMesh.h"
 #include "physicsUtils.h"
+#include "broadphase/dynamicTree.h"
 #include <vector>
 
+// Ray hits a form returns at most, compound forms keep the closest ones
+#define FORM_MAX_RAY_POINTS 8
+
 class PhysicsForm
 {
 public:
@@ -34,10 +38,18 @@ public:
 
     EXPORT AABB getAABB(const Matrix4 &model);
 
+    // Radius of a sphere around the center that fits into the form, in simulation scale
+    EXPORT float getInnerRadius();
+
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache);
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache);
+    EXPORT float sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly = false);
 
     inline Matrix3 &getInvertedInertia() { return invertedInteria; }
 
+    // Point in the space of the form bodies rotate around, zero for forms of a single shape
+    inline const Vector3 &getCenterOfMass() { return centerOfMass; }
+
     inline float getMass() { return mass; }
     inline void setMass(float mass) { this->mass = mass; }
 
@@ -53,6 +65,14 @@ public:
 
     inline Shape *getSimpleShape() { return shapes.at(0); }
 
+    // Forms with more than one shape are compound, every shape is collided on its own
+    inline Shape *getShape(int index) { return shapes[index]; }
+    inline int getShapesAmount() { return (int)shapes.size(); }
+
+    // Bounds of shapes of compound forms in the space of the form, user data of a leaf is the index of the shape
+    // Only shapes that overlap the other body are collided
+    inline const DynamicTree *getShapesTree() { return &shapesTree; }
+
 protected:
     std::vector<Shape *> shapes;
     float simScale;
@@ -69,9 +89,12 @@ protected:
     float mass = 0.1f;
     float invertedMass;
 
-    // Intertia
+    // Intertia around the center of mass
     Matrix3 invertedInteria;
+    Vector3 centerOfMass = Vector3(0.0f);
 
     // Type of the shape
     ShapeCollisionType type;
+
+    DynamicTree shapesTree;
 };
\ No newline at end of file
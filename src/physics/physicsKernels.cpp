@@ -0,0 +1,482 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "physicsKernels.h"
+#include "physicsBodyStorage.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHYSICS_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KERNEL_AVX2
+#else
+#include <cpuid.h>
+#define KERNEL_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Vector kernels read body arrays as raw floats
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 has to be packed");
+static_assert(sizeof(Quat) == 4 * sizeof(float), "Quat has to be packed");
+static_assert(sizeof(AABB) == 2 * sizeof(Vector3), "AABB has to be two packed vectors");
+
+SimdLevel _detectSimdLevel()
+{
+    static SimdLevel level = []()
+    {
+#ifdef PHYSICS_KERNELS_X86
+        unsigned int regs[4] = {0, 0, 0, 0};
+#if defined(_MSC_VER) && !defined(__clang__)
+        __cpuid((int *)regs, 0);
+        unsigned int maxLeaf = regs[0];
+        __cpuid((int *)regs, 1);
+#else
+        unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+        __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        bool bSSE2 = regs[3] & (1u << 26);
+        bool bAVX = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28));
+        if (!bSSE2)
+            return SimdLevel::Scalar;
+
+        // System has to save ymm registers on context switch too
+        if (bAVX)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long long xcr0 = _xgetbv(0);
+#else
+            unsigned int eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+            bAVX = (xcr0 & 6) == 6;
+        }
+
+        if (bAVX && maxLeaf >= 7)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            __cpuidex((int *)regs, 7, 0);
+#else
+            __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            if (regs[1] & (1u << 5))
+                return SimdLevel::AVX2;
+        }
+        return SimdLevel::SSE2;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }();
+    return level;
+}
+
+// Scalar versions, every vector kernel repeats their operations in the same order
+
+static void _integrateVelocitiesScalar(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep, const Vector3 &localGravity)
+{
+    for (int i = start; i < end; i++)
+    {
+        if ((storage->flags[i] & mask) != value)
+            continue;
+
+        Vector3 &linearVelocity = storage->linearVelocities[i];
+        Vector3 &angularVelocity = storage->angularVelocities[i];
+        linearVelocity += (localGravity * storage->gravityFactors[i] + storage->invertedMasses[i] * storage->forces[i]) * subStep;
+        linearVelocity -= linearVelocity * storage->linearDampings[i] * subStep;
+        angularVelocity -= angularVelocity * storage->angularDampings[i] * subStep;
+        storage->forces[i] = Vector3(0.0f);
+        storage->torques[i] = Vector3(0.0f);
+    }
+}
+
+static void _advancePositionsScalar(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep)
+{
+    for (int i = start; i < end; i++)
+    {
+        if ((storage->flags[i] & mask) == value)
+            storage->positions[i] += storage->linearVelocities[i] * subStep;
+    }
+}
+
+static void _refitBoundsScalar(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value)
+{
+    for (int i = start; i < end; i++)
+    {
+        if ((storage->flags[i] & mask) != value)
+            continue;
+
+        Vector3 center = storage->positions[i] + storage->rotations[i] * storage->boundsCenters[i];
+        storage->aabbs[i] = AABB(center - storage->boundsExtents[i], center + storage->boundsExtents[i]);
+    }
+}
+
+#ifdef PHYSICS_KERNELS_X86
+
+// 4 packed vectors to one register per component and back
+inline void _load4(const Vector3 *v, __m128 &x, __m128 &y, __m128 &z)
+{
+    const float *p = (const float *)v;
+    __m128 a = _mm_loadu_ps(p);     // x0 y0 z0 x1
+    __m128 b = _mm_loadu_ps(p + 4); // y1 z1 x2 y2
+    __m128 c = _mm_loadu_ps(p + 8); // z2 x3 y3 z3
+
+    x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(3, 0, 3, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+inline void _store4(Vector3 *v, __m128 x, __m128 y, __m128 z)
+{
+    float *p = (float *)v;
+    __m128 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    _mm_storeu_ps(p, a);
+    _mm_storeu_ps(p + 4, b);
+    _mm_storeu_ps(p + 8, c);
+}
+
+inline void _loadQuat4(const Quat *q, __m128 &x, __m128 &y, __m128 &z, __m128 &w)
+{
+    const float *p = (const float *)q;
+    __m128 r0 = _mm_loadu_ps(p);
+    __m128 r1 = _mm_loadu_ps(p + 4);
+    __m128 r2 = _mm_loadu_ps(p + 8);
+    __m128 r3 = _mm_loadu_ps(p + 12);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+#ifdef GLM_FORCE_QUAT_DATA_XYZW
+    x = r0, y = r1, z = r2, w = r3;
+#else
+    w = r0, x = r1, y = r2, z = r3;
+#endif
+}
+
+inline void _loadBounds4(const AABB *aabbs, __m128 *start, __m128 *end)
+{
+    // Bounds are start and end vectors one after another, two groups of 4 vectors hold 4 boxes
+    __m128 a[3], b[3];
+    _load4((const Vector3 *)aabbs, a[0], a[1], a[2]);
+    _load4((const Vector3 *)aabbs + 4, b[0], b[1], b[2]);
+    for (int c = 0; c < 3; c++)
+    {
+        start[c] = _mm_shuffle_ps(a[c], b[c], _MM_SHUFFLE(2, 0, 2, 0));
+        end[c] = _mm_shuffle_ps(a[c], b[c], _MM_SHUFFLE(3, 1, 3, 1));
+    }
+}
+
+inline void _storeBounds4(AABB *aabbs, const __m128 *start, const __m128 *end)
+{
+    _store4((Vector3 *)aabbs, _mm_unpacklo_ps(start[0], end[0]), _mm_unpacklo_ps(start[1], end[1]), _mm_unpacklo_ps(start[2], end[2]));
+    _store4((Vector3 *)aabbs + 4, _mm_unpackhi_ps(start[0], end[0]), _mm_unpackhi_ps(start[1], end[1]), _mm_unpackhi_ps(start[2], end[2]));
+}
+
+// All bits set in lanes of bodies kernel works with
+inline __m128 _mask4(const uint8_t *flags, uint8_t mask, uint8_t value)
+{
+    __m128i f = _mm_setr_epi32(flags[0], flags[1], flags[2], flags[3]);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(f, _mm_set1_epi32(mask)), _mm_set1_epi32(value)));
+}
+
+inline __m128 _select4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Same operations glm does for quaternion by vector multiplication
+inline void _rotate4(__m128 qx, __m128 qy, __m128 qz, __m128 qw, __m128 vx, __m128 vy, __m128 vz, __m128 &ox, __m128 &oy, __m128 &oz)
+{
+    __m128 uvx = _mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(vy, qz));
+    __m128 uvy = _mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(vz, qx));
+    __m128 uvz = _mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(vx, qy));
+    __m128 uuvx = _mm_sub_ps(_mm_mul_ps(qy, uvz), _mm_mul_ps(uvy, qz));
+    __m128 uuvy = _mm_sub_ps(_mm_mul_ps(qz, uvx), _mm_mul_ps(uvz, qx));
+    __m128 uuvz = _mm_sub_ps(_mm_mul_ps(qx, uvy), _mm_mul_ps(uvx, qy));
+    __m128 two = _mm_set1_ps(2.0f);
+    ox = _mm_add_ps(vx, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvx, qw), uuvx), two));
+    oy = _mm_add_ps(vy, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvy, qw), uuvy), two));
+    oz = _mm_add_ps(vz, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvz, qw), uuvz), two));
+}
+
+static void _integrateVelocitiesSSE2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep, const Vector3 &localGravity)
+{
+    __m128 delta = _mm_set1_ps(subStep);
+    __m128 gx = _mm_set1_ps(localGravity.x), gy = _mm_set1_ps(localGravity.y), gz = _mm_set1_ps(localGravity.z);
+    __m128 zero = _mm_setzero_ps();
+
+    int i = start;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 active = _mask4(&storage->flags[i], mask, value);
+        if (_mm_movemask_ps(active) == 0)
+            continue;
+
+        __m128 gravityFactor = _mm_loadu_ps(&storage->gravityFactors[i]);
+        __m128 invertedMass = _mm_loadu_ps(&storage->invertedMasses[i]);
+        __m128 linearDamping = _mm_loadu_ps(&storage->linearDampings[i]);
+        __m128 angularDamping = _mm_loadu_ps(&storage->angularDampings[i]);
+
+        __m128 lx, ly, lz, ax, ay, az, fx, fy, fz, tx, ty, tz;
+        _load4(&storage->linearVelocities[i], lx, ly, lz);
+        _load4(&storage->angularVelocities[i], ax, ay, az);
+        _load4(&storage->forces[i], fx, fy, fz);
+        _load4(&storage->torques[i], tx, ty, tz);
+
+        __m128 nlx = _mm_add_ps(lx, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(gx, gravityFactor), _mm_mul_ps(invertedMass, fx)), delta));
+        __m128 nly = _mm_add_ps(ly, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(gy, gravityFactor), _mm_mul_ps(invertedMass, fy)), delta));
+        __m128 nlz = _mm_add_ps(lz, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(gz, gravityFactor), _mm_mul_ps(invertedMass, fz)), delta));
+        nlx = _mm_sub_ps(nlx, _mm_mul_ps(_mm_mul_ps(nlx, linearDamping), delta));
+        nly = _mm_sub_ps(nly, _mm_mul_ps(_mm_mul_ps(nly, linearDamping), delta));
+        nlz = _mm_sub_ps(nlz, _mm_mul_ps(_mm_mul_ps(nlz, linearDamping), delta));
+        __m128 nax = _mm_sub_ps(ax, _mm_mul_ps(_mm_mul_ps(ax, angularDamping), delta));
+        __m128 nay = _mm_sub_ps(ay, _mm_mul_ps(_mm_mul_ps(ay, angularDamping), delta));
+        __m128 naz = _mm_sub_ps(az, _mm_mul_ps(_mm_mul_ps(az, angularDamping), delta));
+
+        _store4(&storage->linearVelocities[i], _select4(active, nlx, lx), _select4(active, nly, ly), _select4(active, nlz, lz));
+        _store4(&storage->angularVelocities[i], _select4(active, nax, ax), _select4(active, nay, ay), _select4(active, naz, az));
+        _store4(&storage->forces[i], _select4(active, zero, fx), _select4(active, zero, fy), _select4(active, zero, fz));
+        _store4(&storage->torques[i], _select4(active, zero, tx), _select4(active, zero, ty), _select4(active, zero, tz));
+    }
+    _integrateVelocitiesScalar(storage, i, end, mask, value, subStep, localGravity);
+}
+
+static void _advancePositionsSSE2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep)
+{
+    __m128 delta = _mm_set1_ps(subStep);
+
+    int i = start;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 active = _mask4(&storage->flags[i], mask, value);
+        if (_mm_movemask_ps(active) == 0)
+            continue;
+
+        __m128 px, py, pz, lx, ly, lz;
+        _load4(&storage->positions[i], px, py, pz);
+        _load4(&storage->linearVelocities[i], lx, ly, lz);
+        _store4(&storage->positions[i],
+                _select4(active, _mm_add_ps(px, _mm_mul_ps(lx, delta)), px),
+                _select4(active, _mm_add_ps(py, _mm_mul_ps(ly, delta)), py),
+                _select4(active, _mm_add_ps(pz, _mm_mul_ps(lz, delta)), pz));
+    }
+    _advancePositionsScalar(storage, i, end, mask, value, subStep);
+}
+
+static void _refitBoundsSSE2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value)
+{
+    int i = start;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 active = _mask4(&storage->flags[i], mask, value);
+        int activeBits = _mm_movemask_ps(active);
+        if (activeBits == 0)
+            continue;
+
+        __m128 px, py, pz, qx, qy, qz, qw, cx, cy, cz, ex, ey, ez;
+        _load4(&storage->positions[i], px, py, pz);
+        _loadQuat4(&storage->rotations[i], qx, qy, qz, qw);
+        _load4(&storage->boundsCenters[i], cx, cy, cz);
+        _load4(&storage->boundsExtents[i], ex, ey, ez);
+
+        __m128 rx, ry, rz;
+        _rotate4(qx, qy, qz, qw, cx, cy, cz, rx, ry, rz);
+        rx = _mm_add_ps(px, rx);
+        ry = _mm_add_ps(py, ry);
+        rz = _mm_add_ps(pz, rz);
+
+        __m128 boundsStart[3] = {_mm_sub_ps(rx, ex), _mm_sub_ps(ry, ey), _mm_sub_ps(rz, ez)};
+        __m128 boundsEnd[3] = {_mm_add_ps(rx, ex), _mm_add_ps(ry, ey), _mm_add_ps(rz, ez)};
+        if (activeBits != 15)
+        {
+            __m128 oldStart[3], oldEnd[3];
+            _loadBounds4(&storage->aabbs[i], oldStart, oldEnd);
+            for (int c = 0; c < 3; c++)
+            {
+                boundsStart[c] = _select4(active, boundsStart[c], oldStart[c]);
+                boundsEnd[c] = _select4(active, boundsEnd[c], oldEnd[c]);
+            }
+        }
+        _storeBounds4(&storage->aabbs[i], boundsStart, boundsEnd);
+    }
+    _refitBoundsScalar(storage, i, end, mask, value);
+}
+
+// AVX2 kernels take 8 bodies as two groups of 4, joined into 256 bit registers after transposing
+
+KERNEL_AVX2 inline void _load8(const Vector3 *v, __m256 &x, __m256 &y, __m256 &z)
+{
+    __m128 x0, y0, z0, x1, y1, z1;
+    _load4(v, x0, y0, z0);
+    _load4(v + 4, x1, y1, z1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+}
+
+KERNEL_AVX2 inline void _store8(Vector3 *v, __m256 x, __m256 y, __m256 z)
+{
+    _store4(v, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+    _store4(v + 4, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+}
+
+KERNEL_AVX2 inline void _loadQuat8(const Quat *q, __m256 &x, __m256 &y, __m256 &z, __m256 &w)
+{
+    __m128 x0, y0, z0, w0, x1, y1, z1, w1;
+    _loadQuat4(q, x0, y0, z0, w0);
+    _loadQuat4(q + 4, x1, y1, z1, w1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+    w = _mm256_insertf128_ps(_mm256_castps128_ps256(w0), w1, 1);
+}
+
+KERNEL_AVX2 inline __m256 _mask8(const uint8_t *flags, uint8_t mask, uint8_t value)
+{
+    __m256i f = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)flags));
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(f, _mm256_set1_epi32(mask)), _mm256_set1_epi32(value)));
+}
+
+KERNEL_AVX2 static void _integrateVelocitiesAVX2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep, const Vector3 &localGravity)
+{
+    __m256 delta = _mm256_set1_ps(subStep);
+    __m256 gx = _mm256_set1_ps(localGravity.x), gy = _mm256_set1_ps(localGravity.y), gz = _mm256_set1_ps(localGravity.z);
+    __m256 zero = _mm256_setzero_ps();
+
+    int i = start;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 active = _mask8(&storage->flags[i], mask, value);
+        if (_mm256_movemask_ps(active) == 0)
+            continue;
+
+        __m256 gravityFactor = _mm256_loadu_ps(&storage->gravityFactors[i]);
+        __m256 invertedMass = _mm256_loadu_ps(&storage->invertedMasses[i]);
+        __m256 linearDamping = _mm256_loadu_ps(&storage->linearDampings[i]);
+        __m256 angularDamping = _mm256_loadu_ps(&storage->angularDampings[i]);
+
+        __m256 lx, ly, lz, ax, ay, az, fx, fy, fz, tx, ty, tz;
+        _load8(&storage->linearVelocities[i], lx, ly, lz);
+        _load8(&storage->angularVelocities[i], ax, ay, az);
+        _load8(&storage->forces[i], fx, fy, fz);
+        _load8(&storage->torques[i], tx, ty, tz);
+
+        __m256 nlx = _mm256_add_ps(lx, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(gx, gravityFactor), _mm256_mul_ps(invertedMass, fx)), delta));
+        __m256 nly = _mm256_add_ps(ly, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(gy, gravityFactor), _mm256_mul_ps(invertedMass, fy)), delta));
+        __m256 nlz = _mm256_add_ps(lz, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(gz, gravityFactor), _mm256_mul_ps(invertedMass, fz)), delta));
+        nlx = _mm256_sub_ps(nlx, _mm256_mul_ps(_mm256_mul_ps(nlx, linearDamping), delta));
+        nly = _mm256_sub_ps(nly, _mm256_mul_ps(_mm256_mul_ps(nly, linearDamping), delta));
+        nlz = _mm256_sub_ps(nlz, _mm256_mul_ps(_mm256_mul_ps(nlz, linearDamping), delta));
+        __m256 nax = _mm256_sub_ps(ax, _mm256_mul_ps(_mm256_mul_ps(ax, angularDamping), delta));
+        __m256 nay = _mm256_sub_ps(ay, _mm256_mul_ps(_mm256_mul_ps(ay, angularDamping), delta));
+        __m256 naz = _mm256_sub_ps(az, _mm256_mul_ps(_mm256_mul_ps(az, angularDamping), delta));
+
+        _store8(&storage->linearVelocities[i], _mm256_blendv_ps(lx, nlx, active), _mm256_blendv_ps(ly, nly, active), _mm256_blendv_ps(lz, nlz, active));
+        _store8(&storage->angularVelocities[i], _mm256_blendv_ps(ax, nax, active), _mm256_blendv_ps(ay, nay, active), _mm256_blendv_ps(az, naz, active));
+        _store8(&storage->forces[i], _mm256_blendv_ps(fx, zero, active), _mm256_blendv_ps(fy, zero, active), _mm256_blendv_ps(fz, zero, active));
+        _store8(&storage->torques[i], _mm256_blendv_ps(tx, zero, active), _mm256_blendv_ps(ty, zero, active), _mm256_blendv_ps(tz, zero, active));
+    }
+    _integrateVelocitiesSSE2(storage, i, end, mask, value, subStep, localGravity);
+}
+
+KERNEL_AVX2 static void _advancePositionsAVX2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep)
+{
+    __m256 delta = _mm256_set1_ps(subStep);
+
+    int i = start;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 active = _mask8(&storage->flags[i], mask, value);
+        if (_mm256_movemask_ps(active) == 0)
+            continue;
+
+        __m256 px, py, pz, lx, ly, lz;
+        _load8(&storage->positions[i], px, py, pz);
+        _load8(&storage->linearVelocities[i], lx, ly, lz);
+        _store8(&storage->positions[i],
+                _mm256_blendv_ps(px, _mm256_add_ps(px, _mm256_mul_ps(lx, delta)), active),
+                _mm256_blendv_ps(py, _mm256_add_ps(py, _mm256_mul_ps(ly, delta)), active),
+                _mm256_blendv_ps(pz, _mm256_add_ps(pz, _mm256_mul_ps(lz, delta)), active));
+    }
+    _advancePositionsSSE2(storage, i, end, mask, value, subStep);
+}
+
+KERNEL_AVX2 static void _refitBoundsAVX2(PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value)
+{
+    __m256 two = _mm256_set1_ps(2.0f);
+
+    int i = start;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 active = _mask8(&storage->flags[i], mask, value);
+        if (_mm256_movemask_ps(active) != 255)
+        {
+            // Partially active groups are rare, 4 wide kernel blends them with old bounds
+            if (_mm256_movemask_ps(active) != 0)
+                _refitBoundsSSE2(storage, i, i + 8, mask, value);
+            continue;
+        }
+
+        __m256 px, py, pz, qx, qy, qz, qw, vx, vy, vz, ex, ey, ez;
+        _load8(&storage->positions[i], px, py, pz);
+        _loadQuat8(&storage->rotations[i], qx, qy, qz, qw);
+        _load8(&storage->boundsCenters[i], vx, vy, vz);
+        _load8(&storage->boundsExtents[i], ex, ey, ez);
+
+        __m256 uvx = _mm256_sub_ps(_mm256_mul_ps(qy, vz), _mm256_mul_ps(vy, qz));
+        __m256 uvy = _mm256_sub_ps(_mm256_mul_ps(qz, vx), _mm256_mul_ps(vz, qx));
+        __m256 uvz = _mm256_sub_ps(_mm256_mul_ps(qx, vy), _mm256_mul_ps(vx, qy));
+        __m256 uuvx = _mm256_sub_ps(_mm256_mul_ps(qy, uvz), _mm256_mul_ps(uvy, qz));
+        __m256 uuvy = _mm256_sub_ps(_mm256_mul_ps(qz, uvx), _mm256_mul_ps(uvz, qx));
+        __m256 uuvz = _mm256_sub_ps(_mm256_mul_ps(qx, uvy), _mm256_mul_ps(uvx, qy));
+        __m256 rx = _mm256_add_ps(px, _mm256_add_ps(vx, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvx, qw), uuvx), two)));
+        __m256 ry = _mm256_add_ps(py, _mm256_add_ps(vy, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvy, qw), uuvy), two)));
+        __m256 rz = _mm256_add_ps(pz, _mm256_add_ps(vz, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvz, qw), uuvz), two)));
+
+        __m256 sx = _mm256_sub_ps(rx, ex), sy = _mm256_sub_ps(ry, ey), sz = _mm256_sub_ps(rz, ez);
+        __m256 tx = _mm256_add_ps(rx, ex), ty = _mm256_add_ps(ry, ey), tz = _mm256_add_ps(rz, ez);
+
+        // Unpacking works inside 128 bit halves, low halves hold boxes 0-3 and high ones boxes 4-7
+        __m256 lo[3] = {_mm256_unpacklo_ps(sx, tx), _mm256_unpacklo_ps(sy, ty), _mm256_unpacklo_ps(sz, tz)};
+        __m256 hi[3] = {_mm256_unpackhi_ps(sx, tx), _mm256_unpackhi_ps(sy, ty), _mm256_unpackhi_ps(sz, tz)};
+        _store8((Vector3 *)&storage->aabbs[i],
+                _mm256_permute2f128_ps(lo[0], hi[0], 0x20), _mm256_permute2f128_ps(lo[1], hi[1], 0x20), _mm256_permute2f128_ps(lo[2], hi[2], 0x20));
+        _store8((Vector3 *)&storage->aabbs[i] + 8,
+                _mm256_permute2f128_ps(lo[0], hi[0], 0x31), _mm256_permute2f128_ps(lo[1], hi[1], 0x31), _mm256_permute2f128_ps(lo[2], hi[2], 0x31));
+    }
+    _refitBoundsSSE2(storage, i, end, mask, value);
+}
+
+#endif
+
+void _integrateVelocitiesKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep, const Vector3 &localGravity)
+{
+#ifdef PHYSICS_KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return _integrateVelocitiesAVX2(storage, start, end, mask, value, subStep, localGravity);
+    if (level == SimdLevel::SSE2)
+        return _integrateVelocitiesSSE2(storage, start, end, mask, value, subStep, localGravity);
+#endif
+    _integrateVelocitiesScalar(storage, start, end, mask, value, subStep, localGravity);
+}
+
+void _advancePositionsKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep)
+{
+#ifdef PHYSICS_KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return _advancePositionsAVX2(storage, start, end, mask, value, subStep);
+    if (level == SimdLevel::SSE2)
+        return _advancePositionsSSE2(storage, start, end, mask, value, subStep);
+#endif
+    _advancePositionsScalar(storage, start, end, mask, value, subStep);
+}
+
+void _refitBoundsKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value)
+{
+#ifdef PHYSICS_KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return _refitBoundsAVX2(storage, start, end, mask, value);
+    if (level == SimdLevel::SSE2)
+        return _refitBoundsSSE2(storage, start, end, mask, value);
+#endif
+    _refitBoundsScalar(storage, start, end, mask, value);
+}
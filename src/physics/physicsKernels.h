@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/primitives.h"
+
+class PhysicsBodyStorage;
+
+// Instruction set body integration kernels are using, every level gives the same results bit to bit
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2
+};
+
+// Best level the cpu and the system support, detected once
+SimdLevel _detectSimdLevel();
+
+// Kernels work with [start, end) of storage arrays on bodies which flags masked by mask equal to value
+// Other bodies are left as they were
+
+// Adds gravity and forces to linear velocity, damps both velocities, resets forces and torques
+void _integrateVelocitiesKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep, const Vector3 &localGravity);
+
+// Moves positions by linear velocity
+void _advancePositionsKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value, float subStep);
+
+// World bounds from local bounds box moved to body's position and rotation
+void _refitBoundsKernel(SimdLevel level, PhysicsBodyStorage *storage, int start, int end, uint8_t mask, uint8_t value);
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include <vector>
+#include <string.h>
+
+// Changes whenever the layout of saved states does, states of other versions are not loaded
+#define PHYSICS_STATE_VERSION 1
+
+// Mutable state of a world written one array after another, used to roll simulation back
+// Memory is kept between saves, so once the buffer grew to the size of the state saving doesn't allocate
+class PhysicsStateBuffer
+{
+public:
+    // Makes place for states of this size, so the first save doesn't allocate either
+    inline void reserve(size_t size)
+    {
+        if (data.size() < size)
+            data.resize(size);
+    }
+
+    // Forgets the state, memory stays
+    inline void clear()
+    {
+        size = 0;
+        cursor = 0;
+    }
+
+    // State that came from somewhere else, like the network
+    inline void assign(const uint8_t *bytes, size_t amount)
+    {
+        clear();
+        write(bytes, (int)amount);
+    }
+
+    // Reading starts from the beginning of the saved state again
+    inline void rewind() { cursor = 0; }
+
+    template <typename T>
+    inline void write(const T *values, int amount)
+    {
+        size_t bytes = sizeof(T) * amount;
+        if (size + bytes > data.size())
+            data.resize((size + bytes) * 2);
+        memcpy(data.data() + size, values, bytes);
+        size += bytes;
+    }
+
+    template <typename T>
+    inline void write(const T &value) { write(&value, 1); }
+
+    // False if the state ends before the values
+    template <typename T>
+    inline bool read(T *values, int amount)
+    {
+        size_t bytes = sizeof(T) * amount;
+        if (cursor + bytes > size)
+            return false;
+        memcpy(values, data.data() + cursor, bytes);
+        cursor += bytes;
+        return true;
+    }
+
+    template <typename T>
+    inline bool read(T &value) { return read(&value, 1); }
+
+    // False if the state ends before the position
+    inline bool seek(size_t position)
+    {
+        if (position > size)
+            return false;
+        cursor = position;
+        return true;
+    }
+
+    inline size_t getCursor() const { return cursor; }
+    inline size_t getSize() const { return size; }
+    inline size_t getCapacity() const { return data.size(); }
+    inline const uint8_t *getData() const { return data.data(); }
+
+protected:
+    std::vector<uint8_t> data;
+    size_t size = 0;
+    size_t cursor = 0;
+};
@@ -1,10 +1,12 @@
 #include "physicsUtils.h"
 #include "physicsBody.h"
+#include "physicsBodyStorage.h"
 #include "collisionSolver.h"
+#include "contactCache.h"
 #include "collisionCollector.h"
 #include "collisionDispatcher.h"
-
-std::mutex lock;
+#include "broadphase/dynamicTree.h"
+#include <algorithm>
 
 void _prepareBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd)
 {
@@ -12,64 +14,223 @@ void _prepareBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<Ph
         (*body)->prepareForSimulation();
 }
 
-void _finishBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd)
+void _finishBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float alpha)
 {
     for (auto body = bodyStart; body < bodyEnd; body++)
-        (*body)->finishSimulation();
+        (*body)->finishSimulation(alpha);
 }
 
-void _processBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float subStep, Vector3 localGravity)
+void _integrateVelocities(PhysicsBodyStorage *storage, int start, int end, float subStep, const Vector3 &localGravity)
 {
-    for (auto body = bodyStart; body < bodyEnd; body++)
-        (*body)->processStep(subStep, localGravity);
+    uint8_t *flags = storage->flags.data();
+    Vector3 *linearVelocities = storage->linearVelocities.data();
+    Vector3 *angularVelocities = storage->angularVelocities.data();
+    Vector3 *translations = storage->translations.data();
+    const Vector3 *torques = storage->torques.data();
+    const Quat *rotations = storage->rotations.data();
+    const Matrix3 *invertedInertias = storage->invertedInertias.data();
+    float sleepCheck = storage->sleepCheck;
+
+    // Branchy part goes first, it leaves flags telling the kernel which bodies to integrate
+    for (int i = start; i < end; i++)
+    {
+        if ((flags[i] & (BODY_ENABLED | BODY_SIMULATED)) != (BODY_ENABLED | BODY_SIMULATED))
+            continue;
+
+        if ((flags[i] & (BODY_SLEEPING | BODY_DYNAMIC)) == (BODY_SLEEPING | BODY_DYNAMIC))
+        {
+            if (glm::length(translations[i]) > sleepCheck ||
+                glm::length(linearVelocities[i]) > sleepCheck ||
+                glm::length(angularVelocities[i]) > sleepCheck)
+            {
+                flags[i] &= ~BODY_SLEEPING;
+                storage->sleepAccumulators[i] = 0.0f;
+            }
+            else
+                continue;
+        }
+
+        if (!(flags[i] & BODY_DYNAMIC))
+        {
+            flags[i] |= BODY_SLEEPING;
+            linearVelocities[i] = Vector3(0.0f);
+            angularVelocities[i] = Vector3(0.0f);
+            translations[i] = Vector3(0.0f);
+            continue;
+        }
+
+        // Inertia has to be rotated into world space, most bodies have no torque and skip it
+        if (torques[i].x != 0.0f || torques[i].y != 0.0f || torques[i].z != 0.0f)
+        {
+            Matrix3 r = glm::toMat3(rotations[i]);
+            angularVelocities[i] += (r * (invertedInertias[i] * glm::transpose(r) * torques[i])) * subStep;
+        }
+    }
+
+    _integrateVelocitiesKernel(storage->simdLevel, storage, start, end,
+                               BODY_ENABLED | BODY_SIMULATED | BODY_DYNAMIC | BODY_SLEEPING, BODY_ENABLED | BODY_SIMULATED | BODY_DYNAMIC,
+                               subStep, localGravity);
 }
 
-void _applyStepBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float subStep)
+void _integratePositions(PhysicsBodyStorage *storage, int start, int end, float subStep)
 {
-    for (auto body = bodyStart; body < bodyEnd; body++)
-        (*body)->applyStep(subStep);
+    uint8_t *flags = storage->flags.data();
+    Vector3 *positions = storage->positions.data();
+    Quat *rotations = storage->rotations.data();
+    Vector3 *linearVelocities = storage->linearVelocities.data();
+    Vector3 *angularVelocities = storage->angularVelocities.data();
+    Vector3 *translations = storage->translations.data();
+    float *sleepAccumulators = storage->sleepAccumulators.data();
+    float sleepCheck = storage->sleepCheck;
+    float velocityLimit = storage->velocityLimit;
+
+    const uint8_t movingMask = BODY_DYNAMIC | BODY_SIMULATED | BODY_ENABLED | BODY_SLEEPING;
+    const uint8_t moving = BODY_DYNAMIC | BODY_SIMULATED | BODY_ENABLED;
+
+    for (int i = start; i < end; i++)
+    {
+        if ((flags[i] & (BODY_DYNAMIC | BODY_SIMULATED)) != (BODY_DYNAMIC | BODY_SIMULATED))
+            continue;
+
+        // Constraints are rare, only they need the body object
+        bool bConstrained = flags[i] & BODY_CONSTRAINED;
+
+        if (glm::length2(translations[i]) > 0.0000000001f)
+        {
+            if (bConstrained)
+            {
+                for (auto &constraint : *storage->bodies[i]->getConstraints())
+                    constraint->processTranslation(&translations[i]);
+            }
+
+            positions[i] += translations[i];
+            translations[i] = Vector3(0.0f);
+            flags[i] &= ~BODY_SLEEPING;
+        }
+
+        if ((flags[i] & movingMask) != moving)
+            continue;
+
+        if (glm::length(linearVelocities[i]) > velocityLimit)
+            linearVelocities[i] = glm::normalize(linearVelocities[i]) * velocityLimit;
+
+        if (bConstrained)
+        {
+            for (auto &constraint : *storage->bodies[i]->getConstraints())
+                constraint->processMotion(&linearVelocities[i], &angularVelocities[i]);
+        }
+
+        Vector3 angularVelocityDelta = angularVelocities[i] * subStep;
+        float len = glm::length(angularVelocityDelta);
+        if (len > 1.0e-6f)
+        {
+            // Body turns around its center of mass, origin of the form goes around it
+            Quat rotation = glm::normalize(glm::angleAxis(len, angularVelocityDelta / len) * rotations[i]);
+            const Vector3 &centerOfMass = storage->centersOfMass[i];
+            if (centerOfMass.x != 0.0f || centerOfMass.y != 0.0f || centerOfMass.z != 0.0f)
+                positions[i] += rotations[i] * centerOfMass - rotation * centerOfMass;
+            rotations[i] = rotation;
+        }
+
+        // World puts the whole island to sleep when all of its bodies are ready
+        if (glm::length2(linearVelocities[i]) < sleepCheck && glm::length2(angularVelocities[i]) < sleepCheck)
+            sleepAccumulators[i] += subStep;
+        else
+            sleepAccumulators[i] = 0.0f;
+    }
+
+    _advancePositionsKernel(storage->simdLevel, storage, start, end, movingMask, moving, subStep);
+    _refitBoundsKernel(storage->simdLevel, storage, start, end, movingMask | BODY_FORM_BOUNDS, moving);
+
+    for (int i = start; i < end; i++)
+    {
+        if ((flags[i] & movingMask) != moving)
+            continue;
+
+        if (flags[i] & BODY_FORM_BOUNDS)
+        {
+            Matrix4 model = glm::translate(Matrix4(1.0f), positions[i]) * glm::toMat4(rotations[i]);
+            storage->aabbs[i] = storage->bodies[i]->getForm()->getAABB(model);
+        }
+        storage->bodies[i]->updateCache();
+    }
+}
+
+void _updateBounds(PhysicsBodyStorage *storage, int start, int end)
+{
+    _refitBoundsKernel(storage->simdLevel, storage, start, end, BODY_FORM_BOUNDS, 0);
+
+    for (int i = start; i < end; i++)
+    {
+        if (storage->flags[i] & BODY_FORM_BOUNDS)
+        {
+            Matrix4 model = glm::translate(Matrix4(1.0f), storage->positions[i]) * glm::toMat4(storage->rotations[i]);
+            storage->aabbs[i] = storage->bodies[i]->getForm()->getAABB(model);
+        }
+    }
+}
+
+bool _canCollide(PhysicsBody *a, PhysicsBody *b)
+{
+    if (a->getMotionType() == PhysicsMotionType::Static && b->getMotionType() == PhysicsMotionType::Static)
+        return false;
+
+    if (a->isSleeping() && b->isSleeping())
+        return false;
+
+    return a->getAABB().test(b->getAABB());
 }
 
 void _collectPairs(
     std::vector<PhysicsBody *>::iterator bodyStart,
     std::vector<PhysicsBody *>::iterator bodyEnd,
-    std::vector<PhysicsBody *> *bodyList,
+    DynamicTree *dynamicTree,
+    DynamicTree *staticTree,
+    std::vector<PhysicsBody *> *unboundedBodies,
     std::vector<BodyPair> *list)
 {
     for (auto a = bodyStart; a < bodyEnd; a++)
     {
-        if (!(*a)->isEnabled())
-            continue;
-        for (auto b = bodyList->begin(); b != bodyList->end(); b++)
-        {
-            if (a == b)
-                break;
-
-            if (!(*b)->isEnabled())
-                continue;
-
-            if (!((*a)->getChannel() & CHANNEL_SIMULATION))
-                continue;
-
-            if (!((*b)->getChannel() & CHANNEL_SIMULATION))
-                continue;
+        PhysicsBody *body = *a;
+        int proxy = body->getBroadphaseProxy();
 
-            if ((*a)->getMotionType() == PhysicsMotionType::Static && (*b)->getMotionType() == PhysicsMotionType::Static)
-                continue;
+        // Each pair of awake bodies is reported once, by the body with lower proxy
+        dynamicTree->query(body->getAABB(), [body, proxy, list](int otherProxy, void *userData)
+                           {
+                               PhysicsBody *other = (PhysicsBody *)userData;
+                               if (otherProxy > proxy && _canCollide(body, other))
+                                   list->push_back({other, body});
+                               return true; });
 
-            if ((*a)->isSleeping() && (*b)->isSleeping())
-                continue;
+        staticTree->query(body->getAABB(), [body, list](int otherProxy, void *userData)
+                          {
+                              PhysicsBody *other = (PhysicsBody *)userData;
+                              if (_canCollide(body, other))
+                                  list->push_back({other, body});
+                              return true; });
 
-            if ((*a)->getAABB().test((*b)->getAABB()))
-            {
-                lock.lock();
-                list->push_back({*a, *b});
-                lock.unlock();
-            }
+        for (auto &other : *unboundedBodies)
+        {
+            if (_canCollide(body, other))
+                list->push_back({other, body});
         }
     }
 }
 
+void _sortPairs(std::vector<BodyPair> *pairs)
+{
+    for (auto &pair : *pairs)
+    {
+        if (pair.a->getStorageId() > pair.b->getStorageId())
+            std::swap(pair.a, pair.b);
+    }
+    std::sort(pairs->begin(), pairs->end(), [](const BodyPair &left, const BodyPair &right)
+              {
+                  if (left.a->getStorageId() != right.a->getStorageId())
+                      return left.a->getStorageId() < right.a->getStorageId();
+                  return left.b->getStorageId() < right.b->getStorageId(); });
+}
+
 void _collide(
     std::vector<BodyPair>::iterator pairStart,
     std::vector<BodyPair>::iterator pairEnd,
@@ -78,47 +239,223 @@ void _collide(
 {
     for (auto pair = pairStart; pair < pairEnd; pair++)
     {
+        if (collisionCollector->refreshManifold(pair->a, pair->b))
+            continue;
         collisionDispatcher->collide(pair->a, pair->b, collisionCollector);
     }
 }
 
+// Solver moves dynamic bodies only, static ones can be shared between pairs of the same batch
+inline uint64_t _solverBatches(PhysicsBody *body)
+{
+    return body->getMotionType() == PhysicsMotionType::Static ? 0 : body->getSolverBatches();
+}
+
+inline void _addSolverBatch(PhysicsBody *body, uint64_t batch)
+{
+    if (body->getMotionType() != PhysicsMotionType::Static)
+        body->setSolverBatches(body->getSolverBatches() | batch);
+}
+
+void _batchPairs(
+    std::vector<CollisionPair> *pairs,
+    std::vector<CollisionPair> *batched,
+    std::vector<int> *pairBatches,
+    std::vector<int> *batchStarts)
+{
+    int pairsAmount = pairs->size();
+    for (auto &pair : *pairs)
+    {
+        pair.a->setSolverBatches(0);
+        pair.b->setSolverBatches(0);
+    }
+
+    // Greedy coloring, every pair takes the first batch none of its bodies is in
+    batchStarts->assign(SOLVER_MAX_BATCHES + 2, 0);
+    pairBatches->resize(pairsAmount);
+    for (int i = 0; i < pairsAmount; i++)
+    {
+        CollisionPair &pair = (*pairs)[i];
+        uint64_t used = _solverBatches(pair.a) | _solverBatches(pair.b);
+        int batch = SOLVER_MAX_BATCHES;
+        for (int b = 0; b < SOLVER_MAX_BATCHES; b++)
+        {
+            if (!(used & (1ull << b)))
+            {
+                batch = b;
+                break;
+            }
+        }
+        if (batch < SOLVER_MAX_BATCHES)
+        {
+            _addSolverBatch(pair.a, 1ull << batch);
+            _addSolverBatch(pair.b, 1ull << batch);
+        }
+        (*pairBatches)[i] = batch;
+        (*batchStarts)[batch + 1]++;
+    }
+
+    for (int b = 0; b <= SOLVER_MAX_BATCHES; b++)
+        (*batchStarts)[b + 1] += (*batchStarts)[b];
+
+    // Pairs keep their relative order inside of a batch
+    int cursor[SOLVER_MAX_BATCHES + 1];
+    for (int b = 0; b <= SOLVER_MAX_BATCHES; b++)
+        cursor[b] = (*batchStarts)[b];
+
+    batched->resize(pairsAmount);
+    for (int i = 0; i < pairsAmount; i++)
+        (*batched)[cursor[(*pairBatches)[i]]++] = (*pairs)[i];
+}
+
 void _solve(
     std::vector<CollisionPair>::iterator pairStart,
     std::vector<CollisionPair>::iterator pairEnd,
+    const ContactPoint *points,
     float simScale,
     float subStep)
 {
     CollisionSolver collisionSolver(simScale);
     for (auto pair = pairStart; pair < pairEnd; pair++)
     {
-        collisionSolver.solve(pair->a, pair->b, pair->manifold, subStep);
+        collisionSolver.solve(pair->a, pair->b, points + pair->firstPoint, pair->pointsAmount, subStep);
     }
 }
 
-void _ray(
-    std::vector<PhysicsBody *>::iterator bodyStart,
-    std::vector<PhysicsBody *>::iterator bodyEnd,
-    const Segment &rayLocal,
+void _prepareContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactPoint *points,
+    ContactConstraint *constraints,
+    const ContactCache *contactCache,
+    float simScale,
+    float subStep)
+{
+    CollisionSolver collisionSolver(simScale);
+    for (auto pair = pairStart; pair < pairEnd; pair++)
+    {
+        collisionSolver.prepare(pair->a, pair->b, points + pair->firstPoint, pair->pointsAmount, constraints + pair->firstPoint, contactCache, subStep);
+    }
+}
+
+void _warmStartContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactConstraint *constraints,
+    float simScale)
+{
+    CollisionSolver collisionSolver(simScale);
+    for (auto pair = pairStart; pair < pairEnd; pair++)
+    {
+        collisionSolver.warmStart(pair->a, pair->b, constraints + pair->firstPoint, pair->pointsAmount);
+    }
+}
+
+void _solveContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    ContactConstraint *constraints,
+    float simScale)
+{
+    CollisionSolver collisionSolver(simScale);
+    for (auto pair = pairStart; pair < pairEnd; pair++)
+    {
+        collisionSolver.solveIterative(pair->a, pair->b, constraints + pair->firstPoint, pair->pointsAmount);
+    }
+}
+
+void _storeContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactConstraint *constraints,
+    ContactCache *contactCache)
+{
+    for (auto pair = pairStart; pair < pairEnd; pair++)
+    {
+        if (pair->a->isSimulatingPhysics() && pair->b->isSimulatingPhysics())
+            contactCache->store(pair->a, pair->b, constraints + pair->firstPoint, pair->pointsAmount);
+    }
+}
+
+void _castRays(
+    const Segment *rays,
+    int start,
+    int end,
+    Channel channel,
+    bool bFirstHit,
+    const DynamicTree *dynamicTree,
+    const DynamicTree *staticTree,
+    const DynamicTree *queryTree,
+    const std::vector<PhysicsBody *> *looseBodies,
     std::vector<PhysicsBodyPoint> *points,
-    Channel channel)
+    int *hitsAmounts)
 {
-    PhysicsBodyPoint newPoints[8];
+    PhysicsBodyPoint newPoints[FORM_MAX_RAY_POINTS];
+    std::vector<PhysicsBodyPoint> rayPoints[RAY_PACKET_SIZE];
+    float rayLengths[RAY_PACKET_SIZE];
+    RayPacket packet;
 
-    for (auto body = bodyStart; body < bodyEnd; body++)
+    for (int first = start; first < end; first += RAY_PACKET_SIZE)
     {
-        if (!((*body)->getChannel() & channel))
-            continue;
+        int amount = std::min(RAY_PACKET_SIZE, end - first);
+        const Segment *packetRays = rays + first;
+        packet.set(packetRays, amount);
+        for (int i = 0; i < amount; i++)
+        {
+            rayPoints[i].clear();
+            rayLengths[i] = glm::length(packetRays[i].b - packetRays[i].a);
+        }
 
-        if (!(*body)->getAABB().test(rayLocal))
-            continue;
+        auto castBody = [&](PhysicsBody *body, int rayMask)
+        {
+            if (!(body->getChannel() & channel))
+                return;
+
+            for (int i = 0; i < amount; i++)
+            {
+                if (!(rayMask & (1 << i)) || !body->getAABB().test(packetRays[i]))
+                    continue;
+
+                int pointsCollected = body->castRay(packetRays[i], newPoints);
+                for (int p = 0; p < pointsCollected; p++)
+                {
+                    if (!bFirstHit)
+                        rayPoints[i].push_back(newPoints[p]);
+                    else if (rayPoints[i].empty() || newPoints[p].distance < rayPoints[i][0].distance)
+                    {
+                        // Nothing further than the closest hit matters anymore
+                        rayPoints[i].assign(1, newPoints[p]);
+                        if (rayLengths[i] > 0.0f)
+                            packet.maxFraction[i] = std::min(packet.maxFraction[i], newPoints[p].distance / rayLengths[i]);
+                    }
+                }
+            }
+        };
+
+        // Bodies that left fat bounds of their proxy are among the loose ones
+        const DynamicTree *trees[3] = {dynamicTree, staticTree, queryTree};
+        for (auto tree : trees)
+        {
+            tree->queryRays(packet, [tree, &castBody](int proxy, void *userData, int rayMask)
+                            {
+                                PhysicsBody *body = (PhysicsBody *)userData;
+                                if (tree->getFatAABB(proxy).contains(body->getAABB()))
+                                    castBody(body, rayMask); });
+        }
+
+        for (auto &body : *looseBodies)
+        {
+            int rayMask = packet.test(body->getAABB(), packet.mask);
+            if (rayMask)
+                castBody(body, rayMask);
+        }
 
-        int pointsCollected = (*body)->castRay(rayLocal, newPoints);
-        if (pointsCollected)
+        for (int i = 0; i < amount; i++)
         {
-            lock.lock();
-            for (int i = 0; i < pointsCollected; i++)
-                points->push_back(newPoints[i]);
-            lock.unlock();
+            if (rayPoints[i].size() > 1)
+                std::sort(rayPoints[i].begin(), rayPoints[i].end(), _compareBodyPoints);
+            points->insert(points->end(), rayPoints[i].begin(), rayPoints[i].end());
+            hitsAmounts[first + i] = (int)rayPoints[i].size();
         }
     }
 }
@@ -10,12 +10,24 @@
 class PhysicsBody;
 class CollisionDispatcher;
 class CollisionCollector;
+class DynamicTree;
+class ContactCache;
+class PhysicsBodyStorage;
+struct ContactConstraint;
 
+// Contacts are split into this many batches that can be solved in parallel, the rest go into one more sequential batch
+#define SOLVER_MAX_BATCHES 64
+
+// Limit of conservative advancement steps a shape sweep takes per body
+#define SHAPE_CAST_ITERATIONS 64
+
+// Manifold is stored compactly, its points are a range in collector's point list
 struct CollisionPair
 {
     PhysicsBody *a;
     PhysicsBody *b;
-    CollisionManifold manifold;
+    int firstPoint;
+    int pointsAmount;
 };
 
 struct BodyPair
@@ -24,6 +36,14 @@ struct BodyPair
     PhysicsBody *b;
 };
 
+// Direction GJK ended with for a pair
+struct PairAxis
+{
+    PhysicsBody *a;
+    PhysicsBody *b;
+    Vector3 axis;
+};
+
 struct BodyCollisionData
 {
     PhysicsBody *bodyA, *bodyB;
@@ -90,35 +110,123 @@ inline bool _compareBodyPoints(PhysicsBodyPoint a, PhysicsBodyPoint b)
     return (a.distance < b.distance);
 }
 
+// Conservative advancement of a shape moving along translation against a convex body
+// gap(offset, closest) returns distance from the shape moved by offset to the body and fills the closest point
+// Distance changes along the movement as a convex function, so stepping by its tangent never goes through the body
+// Returns the part of translation done when they touch, FLT_MAX if they don't before maxTime
+// With bApproachingOnly a touch at the start counts only if the movement goes into the body, moving along or away never hits a convex body
+template <typename T>
+inline float _sweepConvex(T gap, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, bool bApproachingOnly = false)
+{
+    float time = 0.0f;
+    for (int i = 0; i < SHAPE_CAST_ITERATIONS; i++)
+    {
+        float distance = gap(translation * time, closest);
+        if (distance <= tolerance)
+        {
+            if (bApproachingOnly && time == 0.0f && glm::dot(translation, closest->normal) >= 0.0f)
+                return FLT_MAX;
+            return time;
+        }
+
+        float speed = -glm::dot(translation, closest->normal);
+        if (speed <= 0.0f)
+            return FLT_MAX;
+
+        time += distance / speed;
+        if (time > maxTime)
+            return FLT_MAX;
+    }
+    return FLT_MAX;
+}
+
 void _prepareBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd);
 
-void _finishBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd);
+void _finishBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float alpha);
+
+// Integration runs over [start, end) of body storage arrays
+// Adds gravity and forces to velocities, wakes sleeping bodies that got pushed
+void _integrateVelocities(PhysicsBodyStorage *storage, int start, int end, float subStep, const Vector3 &localGravity);
+
+// Moves bodies by their velocities and collision translation, counts how long they rest
+void _integratePositions(PhysicsBodyStorage *storage, int start, int end, float subStep);
 
-void _processBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float subStep, Vector3 localGravity);
+void _updateBounds(PhysicsBodyStorage *storage, int start, int end);
 
-void _applyStepBody(std::vector<PhysicsBody *>::iterator bodyStart, std::vector<PhysicsBody *>::iterator bodyEnd, float subStep);
+// False if broadphase should skip the pair, bounds overlap is tested too
+bool _canCollide(PhysicsBody *a, PhysicsBody *b);
 
 void _collectPairs(
     std::vector<PhysicsBody *>::iterator bodyStart,
     std::vector<PhysicsBody *>::iterator bodyEnd,
-    std::vector<PhysicsBody *> *bodyList,
+    DynamicTree *dynamicTree,
+    DynamicTree *staticTree,
+    std::vector<PhysicsBody *> *unboundedBodies,
     std::vector<BodyPair> *list);
 
+// Bodies of every pair go in order of their storage ids and pairs are sorted by them, so the order doesn't depend on broadphase history
+void _sortPairs(std::vector<BodyPair> *pairs);
+
 void _collide(
     std::vector<BodyPair>::iterator pairStart,
     std::vector<BodyPair>::iterator pairEnd,
     CollisionDispatcher *collisionDispatcher,
     CollisionCollector *collisionCollector);
 
+// Reorders pairs into batches where no body that solver moves appears twice, batch order doesn't depend on threads
+// batchStarts gets SOLVER_MAX_BATCHES + 2 offsets, last batch is the one that has to be solved sequentially
+void _batchPairs(
+    std::vector<CollisionPair> *pairs,
+    std::vector<CollisionPair> *batched,
+    std::vector<int> *pairBatches,
+    std::vector<int> *batchStarts);
+
 void _solve(
     std::vector<CollisionPair>::iterator pairStart,
     std::vector<CollisionPair>::iterator pairEnd,
+    const ContactPoint *points,
     float simScale,
     float subStep);
 
-void _ray(
-    std::vector<PhysicsBody *>::iterator bodyStart,
-    std::vector<PhysicsBody *>::iterator bodyEnd,
-    const Segment &rayLocal,
+// Iterative solver stages, constraints are indexed the same way as collector's points
+void _prepareContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactPoint *points,
+    ContactConstraint *constraints,
+    const ContactCache *contactCache,
+    float simScale,
+    float subStep);
+
+void _warmStartContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactConstraint *constraints,
+    float simScale);
+
+void _solveContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    ContactConstraint *constraints,
+    float simScale);
+
+void _storeContacts(
+    std::vector<CollisionPair>::iterator pairStart,
+    std::vector<CollisionPair>::iterator pairEnd,
+    const ContactConstraint *constraints,
+    ContactCache *contactCache);
+
+// Rays from [start, end) go through the trees in packets, loose bodies are tested by every packet
+// Hits of a ray are written sorted by distance and their amount goes to hitsAmounts[ray], first hit mode keeps only the closest one
+void _castRays(
+    const Segment *rays,
+    int start,
+    int end,
+    Channel channel,
+    bool bFirstHit,
+    const DynamicTree *dynamicTree,
+    const DynamicTree *staticTree,
+    const DynamicTree *queryTree,
+    const std::vector<PhysicsBody *> *looseBodies,
     std::vector<PhysicsBodyPoint> *points,
-    Channel channel);
\ No newline at end of file
+    int *hitsAmounts);
\ No newline at end of file
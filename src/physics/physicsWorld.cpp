@@ -6,10 +6,41 @@
 #include <mutex>
 #include <chrono>
 
+// Returns milliseconds passed since the given point and moves the point to now
+inline float _measure(std::chrono::high_resolution_clock::time_point &since)
+{
+    auto now = std::chrono::high_resolution_clock::now();
+    float ms = std::chrono::duration<float, std::milli>(now - since).count();
+    since = now;
+    return ms;
+}
+
+// Size of chunks work is split into, smaller ones are not worth scheduling
+inline int _grain(size_t size, int maxJobs)
+{
+    return max((int)size / maxJobs, PHYSICS_MIN_GRAIN);
+}
+
+// Part of [0, size) that belongs to the chunk when it's split into equal chunks
+inline void _chunkRange(size_t size, int chunksAmount, int chunk, int *start, int *end)
+{
+    *start = (int)(size * chunk / chunksAmount);
+    *end = (int)(size * (chunk + 1) / chunksAmount);
+}
+
 PhysicsWorld::PhysicsWorld()
 {
     jobQueue = Red11::getJobQueue();
-    maxJobs = min(jobQueue->getMaxJobs() * 4, 32);
+    maxJobs = max(min(jobQueue->getMaxJobs() * 4, 32), 1);
+    bodyStorage.simdLevel = _detectSimdLevel();
+
+    dynamicTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    staticTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    queryTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    contactCache.setMatchDistance(DEFAULT_CONTACT_MATCH_DISTANCE * simScale);
+    manifoldCache.setThresholds(DEFAULT_MANIFOLD_REUSE_DISTANCE * simScale, DEFAULT_MANIFOLD_REUSE_ANGLE);
+    bodyStorage.sleepCheck = DEFAULT_SLEEP_CHECK * simScale;
+    bodyStorage.velocityLimit = DEFAULT_VELOCITY_LIMIT * simScale;
 }
 
 PhysicsWorld::~PhysicsWorld()
@@ -23,6 +54,186 @@ void PhysicsWorld::setup(Vector3 gravity, float simScale, float subStep)
     this->gravity = gravity;
     this->simScale = simScale;
     this->subStep = subStep;
+
+    dynamicTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    staticTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    queryTree.setMargin(DEFAULT_BROADPHASE_MARGIN * simScale);
+    contactCache.setMatchDistance(DEFAULT_CONTACT_MATCH_DISTANCE * simScale);
+    manifoldCache.setThresholds(DEFAULT_MANIFOLD_REUSE_DISTANCE * simScale, DEFAULT_MANIFOLD_REUSE_ANGLE);
+    bodyStorage.sleepCheck = DEFAULT_SLEEP_CHECK * simScale;
+    bodyStorage.velocityLimit = DEFAULT_VELOCITY_LIMIT * simScale;
+}
+
+void PhysicsWorld::setBroadphase(BroadphaseType broadphaseType)
+{
+    if (this->broadphaseType == broadphaseType)
+        return;
+
+    for (auto &body : bodies)
+        removeFromBroadphase(body);
+    this->broadphaseType = broadphaseType;
+    bLooseBodiesOutdated = true;
+}
+
+void PhysicsWorld::setSimdLevel(SimdLevel simdLevel)
+{
+    SimdLevel supported = _detectSimdLevel();
+    bodyStorage.simdLevel = (int)simdLevel > (int)supported ? supported : simdLevel;
+}
+
+void PhysicsWorld::setSolver(SolverType solverType, int iterations)
+{
+    this->solverType = solverType;
+    this->solverIterations = max(iterations, 1);
+    contactCache.clear();
+}
+
+void PhysicsWorld::setNarrowphase(NarrowphaseType narrowphaseType)
+{
+    collisionDispatcher.setNarrowphase(narrowphaseType);
+    axisCache.clear();
+    manifoldCache.clear();
+}
+
+void PhysicsWorld::setManifoldReuse(bool bState)
+{
+    bReuseManifolds = bState;
+    manifoldCache.clear();
+}
+
+void PhysicsWorld::saveState(PhysicsStateBuffer *buffer)
+{
+    int size = bodyStorage.size();
+    buffer->clear();
+    buffer->write(PHYSICS_STATE_VERSION);
+    buffer->write(size);
+    buffer->write(deltaAccumulator);
+
+    buffer->write(bodyStorage.positions.data(), size);
+    buffer->write(bodyStorage.rotations.data(), size);
+    buffer->write(bodyStorage.linearVelocities.data(), size);
+    buffer->write(bodyStorage.angularVelocities.data(), size);
+    buffer->write(bodyStorage.forces.data(), size);
+    buffer->write(bodyStorage.torques.data(), size);
+    buffer->write(bodyStorage.translations.data(), size);
+    buffer->write(bodyStorage.sleepAccumulators.data(), size);
+    buffer->write(bodyStorage.flags.data(), size);
+
+    // Sleeping islands, free ones included so islands get the same numbers after loading
+    buffer->write((int)islands.size());
+    for (auto &island : islands)
+    {
+        buffer->write((int)island.size());
+        for (auto body : island)
+            buffer->write(body->getStorageId());
+    }
+    buffer->write((int)freeIslands.size());
+    buffer->write(freeIslands.data(), (int)freeIslands.size());
+    buffer->write(sleepingIslandsAmount);
+
+    contactCache.save(buffer);
+    axisCache.save(buffer);
+    manifoldCache.save(buffer);
+}
+
+bool PhysicsWorld::loadState(PhysicsStateBuffer *buffer)
+{
+    int size = bodyStorage.size();
+    int version, savedSize;
+    float savedAccumulator;
+    buffer->rewind();
+    if (!buffer->read(version) || version != PHYSICS_STATE_VERSION || !buffer->read(savedSize) || savedSize != size || !buffer->read(savedAccumulator))
+        return false;
+
+    // Islands and caches come after bodies, all of them are checked before any body is overwritten
+    size_t bodiesStart = buffer->getCursor();
+    size_t bodiesBytes = (sizeof(Vector3) * 6 + sizeof(Quat) + sizeof(float) + sizeof(uint8_t)) * size;
+    if (!buffer->seek(bodiesStart + bodiesBytes))
+        return false;
+
+    // Counts come from the state, so temporaries grow by values actually read instead of trusting them
+    int islandsAmount, freeAmount, savedSleepingIslands;
+    std::vector<int> islandSizes, islandBodies, savedFreeIslands;
+    if (!buffer->read(islandsAmount) || islandsAmount < 0)
+        return false;
+    for (int i = 0; i < islandsAmount; i++)
+    {
+        int amount;
+        if (!buffer->read(amount) || amount < 0)
+            return false;
+        islandSizes.push_back(amount);
+        for (int j = 0; j < amount; j++)
+        {
+            int id;
+            if (!buffer->read(id) || id < 0 || id >= size)
+                return false;
+            islandBodies.push_back(id);
+        }
+    }
+    if (!buffer->read(freeAmount) || freeAmount < 0)
+        return false;
+    for (int i = 0; i < freeAmount; i++)
+    {
+        int island;
+        if (!buffer->read(island) || island < 0 || island >= islandsAmount)
+            return false;
+        savedFreeIslands.push_back(island);
+    }
+    if (!buffer->read(savedSleepingIslands))
+        return false;
+
+    if (!contactCache.load(buffer, &bodyStorage) || !axisCache.load(buffer, &bodyStorage) || !manifoldCache.load(buffer, &bodyStorage))
+    {
+        // Caches only warm up the solver, a partly loaded one is dropped
+        contactCache.clear();
+        axisCache.clear();
+        manifoldCache.clear();
+        return false;
+    }
+
+    // Everything is valid, sections are read again in place
+    buffer->seek(bodiesStart);
+    deltaAccumulator = savedAccumulator;
+    buffer->read(bodyStorage.positions.data(), size);
+    buffer->read(bodyStorage.rotations.data(), size);
+    buffer->read(bodyStorage.linearVelocities.data(), size);
+    buffer->read(bodyStorage.angularVelocities.data(), size);
+    buffer->read(bodyStorage.forces.data(), size);
+    buffer->read(bodyStorage.torques.data(), size);
+    buffer->read(bodyStorage.translations.data(), size);
+    buffer->read(bodyStorage.sleepAccumulators.data(), size);
+
+    // Only sleeping comes from the state, the rest of flags is set by the game
+    uint8_t *flags = bodyStorage.flags.data();
+    for (int i = 0; i < size; i++)
+    {
+        uint8_t savedFlags;
+        buffer->read(savedFlags);
+        flags[i] = (flags[i] & ~BODY_SLEEPING) | (savedFlags & BODY_SLEEPING);
+        bodyStorage.bodies[i]->setIsland(-1);
+        bodyStorage.bodies[i]->resetRenderTransformation();
+    }
+
+    islands.resize(islandsAmount);
+    const int *id = islandBodies.data();
+    for (int i = 0; i < islandsAmount; i++)
+    {
+        islands[i].clear();
+        for (int j = 0; j < islandSizes[i]; j++, id++)
+        {
+            islands[i].push_back(bodyStorage.bodies[*id]);
+            bodyStorage.bodies[*id]->setIsland(i);
+        }
+    }
+    freeIslands = savedFreeIslands;
+    sleepingIslandsAmount = savedSleepingIslands;
+
+    // Entities get loaded transformations, bounds and caches of shapes follow them
+    storePreviousTransformations();
+    finishBodies();
+    prepareBodies();
+    bLooseBodiesOutdated = true;
+    return true;
 }
 
 void PhysicsWorld::process(float delta)
@@ -32,23 +243,59 @@ void PhysicsWorld::process(float delta)
 
     deltaAccumulator += delta;
     if (deltaAccumulator < subStep)
+    {
+        // Interpolated entities move on frames without substeps too
+        if (bInterpolate)
+            finishBodies();
         return;
+    }
+
+    profile = PhysicsWorldProfile();
+    auto frameStart = std::chrono::high_resolution_clock::now();
+    auto stageStart = frameStart;
 
     prepareBodies();
+    bLooseBodiesOutdated = true;
     while (deltaAccumulator > subStep)
     {
         deltaAccumulator -= subStep;
+        if (bInterpolate && deltaAccumulator <= subStep)
+            storePreviousTransformations();
+
+        auto subStepStart = std::chrono::high_resolution_clock::now();
+        if (bUseTaskGraph && !bDeterministic)
+        {
+            runSubStepGraph();
+        }
+        else
+        {
+            stageStart = subStepStart;
+            applyForces();
+            profile.integration += _measure(stageStart);
+            findCollisionPairs();
+            profile.broadphase += _measure(stageStart);
+            findCollisions();
+            profile.narrowphase += _measure(stageStart);
+            solveCollisions();
+            profile.solver += _measure(stageStart);
+            sweepFastBodies();
+            profile.narrowphase += _measure(stageStart);
+            applyStep();
+            profile.integration += _measure(stageStart);
+        }
+        updateIslands();
+        profile.simulation += _measure(subStepStart);
+
+        profile.subSteps++;
+        profile.pairs += pairs.size();
+        profile.contacts += collisionCollector.pairs.size();
 
-        applyForces();
-        findCollisionPairs();
-        findCollisions();
-        solveCollisions();
-        applyStep();
         triggerCollisionEvents(&collisionCollector);
         updateCollisionTimers(subStep);
-        removeNotPersistedCollisions();
     }
+    dispatchCollisionEvents();
     finishBodies();
+    profile.total = _measure(frameStart);
 
     // removing destroyed bodies
     cleanDestroyedBodies();
@@ -64,274 +311,764 @@ PhysicsBody *PhysicsWorld::createPhysicsBody(PhysicsMotionType motionType, Physi
 {
     PhysicsBody *newBody = new PhysicsBody(motionType, form, this, entity, initialPosition * simScale, initialRotation, simulatePhysics);
     bodies.push_back(newBody);
+    bLooseBodiesOutdated = true;
     return newBody;
 }
 
 std::vector<PhysicsBodyPoint> PhysicsWorld::castRayCollision(const Segment &ray, Channel channel)
 {
-    points.clear();
-    Segment rayLocal = Segment(ray.a * simScale, ray.b * simScale);
+    castRays(&ray, 1, channel, &rayResults, RayCastMode::AllHits);
+    return rayResults.points;
+}
 
-    if (maxJobs > bodies.size() || maxJobs <= 4)
-    {
-        _ray(bodies.begin(), bodies.end(), rayLocal, &points, channel);
-    }
-    else
-    {
-        int bodiesPerThread = bodies.size() / maxJobs;
-        std::vector<PhysicsBodyPoint> *points = &this->points;
-        std::vector<PhysicsBody *>::iterator currentBody = bodies.begin();
+void PhysicsWorld::castRays(const Segment *rays, int amount, Channel channel, RayCastResults *results, RayCastMode mode)
+{
+    results->points.clear();
+    results->starts.assign(amount + 1, 0);
+    if (amount <= 0)
+        return;
 
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? bodies.end() : currentBody + bodiesPerThread;
+    raysLocal.resize(amount);
+    for (int i = 0; i < amount; i++)
+        raysLocal[i] = Segment(rays[i].a * simScale, rays[i].b * simScale);
 
-            jobQueue->queueJob([currentBody, end, &rayLocal, points, channel]
-                               { _ray(currentBody, end, rayLocal, points, channel); });
+    // Trees are updated at the start of a substep, bodies created or moved far since then are tested by every packet
+    updateLooseBodies();
 
-            currentBody += bodiesPerThread;
-        }
-        while (jobQueue->isBusy())
-        {
-        };
-    }
+    // Jobs take whole packets
+    int grain = _grain(amount, maxJobs);
+    grain = (grain + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE * RAY_PACKET_SIZE;
+    int chunksAmount = (amount + grain - 1) / grain;
+    if ((int)jobRayPoints.size() < chunksAmount)
+        jobRayPoints.resize(chunksAmount);
+    for (int i = 0; i < chunksAmount; i++)
+        jobRayPoints[i].clear();
 
-    if (points.size() > 1)
-        std::sort(points.begin(), points.end(), _compareBodyPoints);
-    for (auto &point : points)
+    int *hitsAmounts = results->starts.data() + 1;
+    bool bFirstHit = mode == RayCastMode::FirstHit;
+    jobQueue->parallelFor(0, amount, grain, [this, grain, channel, bFirstHit, hitsAmounts](int start, int end)
+                          { _castRays(raysLocal.data(), start, end, channel, bFirstHit, &dynamicTree, &staticTree, &queryTree, &looseBodies, &jobRayPoints[start / grain], hitsAmounts); });
+
+    // joined in job order, so hits go in the order of rays
+    for (int i = 0; i < chunksAmount; i++)
+        results->points.insert(results->points.end(), jobRayPoints[i].begin(), jobRayPoints[i].end());
+    for (int i = 0; i < amount; i++)
+        results->starts[i + 1] += results->starts[i];
+    for (auto &point : results->points)
         point.point /= simScale;
-    return points;
 }
 
 std::vector<PhysicsBodyPoint> PhysicsWorld::castSphereCollision(const Vector3 &p, float radius, Channel channel)
+{
+    return castCapsuleCollision(p, p, radius, channel);
+}
+
+std::vector<PhysicsBodyPoint> PhysicsWorld::castCapsuleCollision(const Vector3 &a, const Vector3 &b, float radius, Channel channel)
 {
     points.clear();
+    Segment segment(a * simScale, b * simScale);
+    float localRadius = radius * simScale;
+
+    collectBodies(AABB(glm::min(segment.a, segment.b) - localRadius, glm::max(segment.a, segment.b) + localRadius), channel);
+
+    PhysicsBodyPoint closest;
+    for (auto &body : queryBodies)
+    {
+        if (body->getSegmentDistance(segment, &closest) <= localRadius)
+        {
+            closest.point /= simScale;
+            closest.distance /= simScale;
+            points.push_back(closest);
+        }
+    }
+
+    if (points.size() > 1)
+        std::sort(points.begin(), points.end(), _compareBodyPoints);
     return points;
 }
 
 std::vector<PhysicsBodyPoint> PhysicsWorld::castPointCollision(const Vector3 &p, Channel channel)
 {
-    points.clear();
-    return points;
+    return castCapsuleCollision(p, p, 0.0f, channel);
+}
+
+bool PhysicsWorld::castSphereSweep(const Vector3 &from, const Vector3 &to, float radius, Channel channel, ShapeCastHit *hit)
+{
+    return castCapsuleSweep(from, from, radius, to - from, channel, hit);
+}
+
+bool PhysicsWorld::castCapsuleSweep(const Vector3 &a, const Vector3 &b, float radius, const Vector3 &translation, Channel channel, ShapeCastHit *hit)
+{
+    Segment start(a * simScale, b * simScale);
+    Vector3 localTranslation = translation * simScale;
+    float localRadius = radius * simScale;
+    float tolerance = SHAPE_CAST_TOLERANCE * simScale;
+
+    AABB startBounds(glm::min(start.a, start.b) - localRadius, glm::max(start.a, start.b) + localRadius);
+    AABB endBounds(startBounds.start + localTranslation, startBounds.end + localTranslation);
+    collectBodies(AABB::combine(startBounds, endBounds), channel);
+
+    // Bodies behind the closest touch are not swept any further
+    bool bHit = false;
+    float bestTime = 1.0f;
+    PhysicsBodyPoint closest;
+    for (auto &body : queryBodies)
+    {
+        float time = body->sweepSegment(start, localRadius, localTranslation, bestTime, tolerance, &closest);
+        if (time <= bestTime)
+        {
+            bHit = true;
+            bestTime = time;
+            *hit = ShapeCastHit({closest.userData, closest.point / simScale, closest.normal, time});
+        }
+    }
+    return bHit;
+}
+
+void PhysicsWorld::updateLooseBodies()
+{
+    if (!bLooseBodiesOutdated)
+        return;
+
+    looseBodies.clear();
+    for (auto &body : bodies)
+    {
+        DynamicTree *tree = body->getBroadphaseTree();
+        if (!tree || !tree->getFatAABB(body->getBroadphaseProxy()).contains(body->getAABB()))
+            looseBodies.push_back(body);
+    }
+    bLooseBodiesOutdated = false;
+}
+
+void PhysicsWorld::collectBodies(const AABB &aabb, Channel channel)
+{
+    updateLooseBodies();
+    queryBodies.clear();
+
+    // Bodies that left fat bounds of their proxy are among the loose ones
+    const DynamicTree *trees[3] = {&dynamicTree, &staticTree, &queryTree};
+    for (auto tree : trees)
+    {
+        tree->query(aabb, [this, tree, &aabb, channel](int proxy, void *userData)
+                    {
+                        PhysicsBody *body = (PhysicsBody *)userData;
+                        if ((body->getChannel() & channel) && tree->getFatAABB(proxy).contains(body->getAABB()) && body->getAABB().test(aabb))
+                            queryBodies.push_back(body);
+                        return true; });
+    }
+
+    for (auto &body : looseBodies)
+    {
+        if ((body->getChannel() & channel) && body->getAABB().test(aabb))
+            queryBodies.push_back(body);
+    }
 }
 
 void PhysicsWorld::cleanDestroyedBodies()
 {
+    bool bRemoved = false;
     auto body = bodies.begin();
     while (body != bodies.end())
         if ((*body)->isDestroyed())
         {
+            removeFromBroadphase(*body);
+            if ((*body)->getIsland() != -1)
+                wakeIsland((*body)->getIsland());
             for (auto &handler : collisionHanlers)
                 handler->notifyBodyRemoved(*body);
             delete (*body);
             body = bodies.erase(body);
+            bRemoved = true;
+            bLooseBodiesOutdated = true;
         }
         else
             ++body;
+
+    // New bodies may take addresses of removed ones, their pairs must not inherit old impulses
+    if (bRemoved)
+    {
+        contactCache.clear();
+        axisCache.clear();
+        manifoldCache.clear();
+    }
 }
 
 void PhysicsWorld::prepareBodies()
 {
-    if (maxJobs > bodies.size() || maxJobs <= 4)
-    {
-        _prepareBody(bodies.begin(), bodies.end());
-    }
-    else
-    {
-        int bodiesPerThread = bodies.size() / maxJobs;
+    jobQueue->parallelFor(0, bodies.size(), _grain(bodies.size(), maxJobs), [this](int start, int end)
+                          { _prepareBody(bodies.begin() + start, bodies.begin() + end); });
+}
 
-        std::vector<PhysicsBody *>::iterator currentBody = bodies.begin();
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? bodies.end() : currentBody + bodiesPerThread;
+void PhysicsWorld::finishBodies()
+{
+    float alpha = bInterpolate ? min(deltaAccumulator / subStep, 1.0f) : 1.0f;
+    jobQueue->parallelFor(0, bodies.size(), _grain(bodies.size(), maxJobs), [this, alpha](int start, int end)
+                          { _finishBody(bodies.begin() + start, bodies.begin() + end, alpha); });
+}
 
-            jobQueue->queueJob([currentBody, end]
-                               { _prepareBody(currentBody, end); });
+void PhysicsWorld::storePreviousTransformations()
+{
+    std::copy(bodyStorage.positions.begin(), bodyStorage.positions.end(), bodyStorage.previousPositions.begin());
+    std::copy(bodyStorage.rotations.begin(), bodyStorage.rotations.end(), bodyStorage.previousRotations.begin());
+}
 
-            currentBody += bodiesPerThread;
+void PhysicsWorld::applyForces()
+{
+    float subStep = this->subStep;
+    Vector3 localGravity = gravity * simScale;
+    int size = bodyStorage.size();
+    jobQueue->parallelFor(0, size, _grain(size, maxJobs), [this, subStep, localGravity](int start, int end)
+                          { _integrateVelocities(&bodyStorage, start, end, subStep, localGravity); });
+}
+
+void PhysicsWorld::updateBroadphase()
+{
+    wakeIslands();
+
+    broadphaseBodies.clear();
+    unboundedBodies.clear();
+
+    for (auto &body : bodies)
+    {
+        bool bIsFinite = body->getAABB().isFinite();
+        bool bIsPlain = body->getType() == ShapeCollisionType::Plain;
+        bool bCanCollide = body->isEnabled() && (body->getChannel() & CHANNEL_SIMULATION) && bIsFinite;
+        if (!bCanCollide || bIsPlain)
+        {
+            // Bodies that don't collide can still be found by queries
+            if (!bCanCollide && !bIsPlain && bIsFinite)
+                updateProxy(body, &queryTree);
+            else
+                removeFromBroadphase(body);
+            if (bCanCollide)
+                unboundedBodies.push_back(body);
+            continue;
         }
-        while (jobQueue->isBusy())
+
+        // Bodies that can't be moved by simulation go into static tree
+        bool bIsResting = body->isSleeping() || (body->getMotionType() == PhysicsMotionType::Static && body->isSimulatingPhysics());
+        if (broadphaseType == BroadphaseType::SweepAndPrune)
         {
-        };
+            if (body->getBroadphaseTree())
+                removeFromBroadphase(body);
+            sweepAndPrune.updateBody(body, bIsResting);
+            continue;
+        }
+
+        updateProxy(body, bIsResting ? &staticTree : &dynamicTree);
+
+        if (!bIsResting)
+            broadphaseBodies.push_back(body);
     }
+    bLooseBodiesOutdated = true;
 }
 
-void PhysicsWorld::finishBodies()
+void PhysicsWorld::sweepFastBodies()
 {
-    if (maxJobs > bodies.size() || maxJobs <= 4)
-    {
-        _finishBody(bodies.begin(), bodies.end());
-    }
-    else
+    uint8_t *flags = bodyStorage.flags.data();
+    float velocityLimit = bodyStorage.velocityLimit;
+    float tolerance = SHAPE_CAST_TOLERANCE * simScale;
+
+    // Constrained bodies change their velocity right before the step, so the sweep wouldn't match their motion
+    const uint8_t mask = BODY_CCD | BODY_DYNAMIC | BODY_SIMULATED | BODY_ENABLED | BODY_SLEEPING | BODY_CONSTRAINED;
+    const uint8_t value = BODY_CCD | BODY_DYNAMIC | BODY_SIMULATED | BODY_ENABLED;
+
+    int size = bodyStorage.size();
+    for (int i = 0; i < size; i++)
     {
-        int bodiesPerThread = bodies.size() / maxJobs;
-        std::vector<PhysicsBody *>::iterator currentBody = bodies.begin();
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? bodies.end() : currentBody + bodiesPerThread;
+        if ((flags[i] & mask) != value)
+            continue;
 
-            jobQueue->queueJob([currentBody, end]
-                               { _finishBody(currentBody, end); });
+        // Same limit the step applies, so the swept motion is the one the body will make
+        Vector3 &velocity = bodyStorage.linearVelocities[i];
+        if (glm::length(velocity) > velocityLimit)
+            velocity = glm::normalize(velocity) * velocityLimit;
 
-            currentBody += bodiesPerThread;
-        }
-        while (jobQueue->isBusy())
+        PhysicsBody *body = bodyStorage.bodies[i];
+        float radius = body->getCCDRadius();
+        Vector3 motion = velocity * subStep;
+        float length = glm::length(motion);
+        if (length < radius * CCD_MOTION_THRESHOLD)
+            continue;
+
+        const AABB &aabb = body->getAABB();
+        Vector3 center = (aabb.start + aabb.end) * 0.5f;
+        AABB startBounds(center - radius, center + radius);
+        AABB endBounds(startBounds.start + motion, startBounds.end + motion);
+        collectBodies(AABB::combine(startBounds, endBounds), CHANNEL_SIMULATION);
+
+        // Other bodies are taken as still during the substep
+        // Bodies it already touches only stop it when it moves into them, so it can rest and slide on them
+        float bestTime = FLT_MAX;
+        PhysicsBodyPoint closest;
+        for (auto &other : queryBodies)
         {
-        };
+            if (other == body || !other->isEnabled())
+                continue;
+            float time = other->sweepSegment(Segment(center, center), radius, motion, fminf(bestTime, 1.0f), tolerance, &closest, true);
+            bestTime = fminf(bestTime, time);
+        }
+        if (bestTime > 1.0f)
+            continue;
+
+        // Velocity stays, the step moves the body by the whole motion, so the position is set back by the part it can't make
+        float allowed = fminf(bestTime + radius * CCD_PENETRATION / length, 1.0f);
+        bodyStorage.positions[i] -= motion * (1.0f - allowed);
     }
 }
 
-void PhysicsWorld::applyForces()
+void PhysicsWorld::updateProxy(PhysicsBody *body, DynamicTree *tree)
 {
-    float subStep = this->subStep;
-    Vector3 localGravity = gravity * simScale;
-    if (maxJobs > bodies.size() || maxJobs <= 4)
+    if (body->getBroadphaseTree() != tree)
     {
-        _processBody(bodies.begin(), bodies.end(), subStep, localGravity);
+        removeFromBroadphase(body);
+        body->setBroadphaseProxy(tree, tree->createProxy(body->getAABB(), body));
     }
     else
-    {
-        int bodiesPerThread = bodies.size() / maxJobs;
-        std::vector<PhysicsBody *>::iterator currentBody = bodies.begin();
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? bodies.end() : currentBody + bodiesPerThread;
-            jobQueue->queueJob([currentBody, end, subStep, localGravity]
-                               { _processBody(currentBody, end, subStep, localGravity); });
+        tree->moveProxy(body->getBroadphaseProxy(), body->getAABB());
+}
 
-            currentBody += bodiesPerThread;
-        }
-        while (jobQueue->isBusy())
-        {
-        };
+void PhysicsWorld::removeFromBroadphase(PhysicsBody *body)
+{
+    if (body->getBroadphaseTree())
+    {
+        body->getBroadphaseTree()->destroyProxy(body->getBroadphaseProxy());
+        body->setBroadphaseProxy(nullptr, -1);
     }
+    if (body->getSweepProxy() != -1)
+        sweepAndPrune.removeBody(body);
 }
 
 void PhysicsWorld::findCollisionPairs()
 {
     pairs.clear();
-    if (maxJobs > bodies.size() || maxJobs <= 4)
+    updateBroadphase();
+
+    // Sweep is sequential by nature
+    if (broadphaseType == BroadphaseType::SweepAndPrune)
     {
-        _collectPairs(bodies.begin(), bodies.end(), &bodies, &pairs);
+        sweepAndPrune.findPairs(&unboundedBodies, &pairs);
+        if (bDeterministic)
+            _sortPairs(&pairs);
+        return;
     }
-    else
+
+    // find possible collision pairs, every job writes into its own list
+    int grain = _grain(broadphaseBodies.size(), maxJobs);
+    int chunksAmount = (broadphaseBodies.size() + grain - 1) / grain;
+    if ((int)jobPairs.size() < chunksAmount)
+        jobPairs.resize(chunksAmount);
+    for (int i = 0; i < chunksAmount; i++)
+        jobPairs[i].clear();
+
+    jobQueue->parallelFor(0, broadphaseBodies.size(), grain, [this, grain](int start, int end)
+                          { _collectPairs(broadphaseBodies.begin() + start, broadphaseBodies.begin() + end, &dynamicTree, &staticTree, &unboundedBodies, &jobPairs[start / grain]); });
+
+    // joined in job order, so the result doesn't depend on thread timing
+    for (int i = 0; i < chunksAmount; i++)
+        pairs.insert(pairs.end(), jobPairs[i].begin(), jobPairs[i].end());
+    if (bDeterministic)
+        _sortPairs(&pairs);
+}
+
+void PhysicsWorld::findCollisions()
+{
+    // find exact collisions, every job fills its own collector
+    int grain = _grain(pairs.size(), maxJobs);
+    int chunksAmount = (pairs.size() + grain - 1) / grain;
+    if ((int)jobCollectors.size() < chunksAmount)
+        jobCollectors.resize(chunksAmount);
+    for (int i = 0; i < chunksAmount; i++)
     {
-        // find possible collision pairs
-        int bodiesPerThread = bodies.size() / maxJobs;
-        std::vector<PhysicsBody *> *pBodies = &bodies;
-        std::vector<BodyPair> *pPairs = &pairs;
-        std::vector<PhysicsBody *>::iterator currentBody = pBodies->begin();
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? pBodies->end() : currentBody + bodiesPerThread;
+        jobCollectors[i].clear();
+        jobCollectors[i].axisCache = &axisCache;
+        jobCollectors[i].manifoldCache = bReuseManifolds ? &manifoldCache : nullptr;
+    }
 
-            jobQueue->queueJob([currentBody, end, pBodies, pPairs]
-                               { _collectPairs(currentBody, end, pBodies, pPairs); });
+    jobQueue->parallelFor(0, pairs.size(), grain, [this, grain](int start, int end)
+                          { _collide(pairs.begin() + start, pairs.begin() + end, &collisionDispatcher, &jobCollectors[start / grain]); });
 
-            currentBody += bodiesPerThread;
-        }
-        while (jobQueue->isBusy())
+    // joined in job order, so the result doesn't depend on thread timing
+    collisionCollector.clear();
+    for (int i = 0; i < chunksAmount; i++)
+        collisionCollector.merge(jobCollectors[i]);
+    storeAxes();
+    storeManifolds();
+}
+
+void PhysicsWorld::storeAxes()
+{
+    for (auto &pairAxis : collisionCollector.axes)
+        axisCache.store(pairAxis.a, pairAxis.b, pairAxis.axis);
+    axisCache.swap();
+}
+
+void PhysicsWorld::storeManifolds()
+{
+    if (!bReuseManifolds)
+        return;
+
+    auto refreshed = collisionCollector.refreshedPairs.begin();
+    for (int i = 0; i < (int)collisionCollector.pairs.size(); i++)
+    {
+        const CollisionPair &pair = collisionCollector.pairs[i];
+        if (refreshed != collisionCollector.refreshedPairs.end() && *refreshed == i)
         {
-        };
+            manifoldCache.keep(manifoldCache.find(pair.a, pair.b));
+            refreshed++;
+        }
+        else
+            manifoldCache.store(pair.a, pair.b, &collisionCollector.points[pair.firstPoint], pair.pointsAmount);
     }
+    manifoldCache.swap();
 }
 
-void PhysicsWorld::findCollisions()
+template <typename T>
+void PhysicsWorld::processSolverBatches(const T &function)
 {
-    // find exact collisions
-    collisionCollector.clear();
-    if (maxJobs > pairs.size() || maxJobs <= 4)
+    // Pairs of a batch don't share bodies, so they can go in any order and on any thread with the same result
+    for (int batch = 0; batch < SOLVER_MAX_BATCHES; batch++)
     {
-        _collide(pairs.begin(), pairs.end(), &collisionDispatcher, &collisionCollector);
+        int begin = solverBatchStarts[batch];
+        int end = solverBatchStarts[batch + 1];
+        jobQueue->parallelFor(begin, end, _grain(end - begin, maxJobs), function);
     }
-    else
+
+    // Pairs that didn't fit into any batch
+    int overflowStart = solverBatchStarts[SOLVER_MAX_BATCHES];
+    if (overflowStart < (int)solverPairs.size())
+        function(overflowStart, (int)solverPairs.size());
+}
+
+void PhysicsWorld::solveCollisions()
+{
+    _batchPairs(&collisionCollector.pairs, &solverPairs, &solverPairBatches, &solverBatchStarts);
+
+    if (solverType == SolverType::SequentialImpulse)
+        return solveContacts();
+
+    std::vector<CollisionPair> &pairs = solverPairs;
+    const ContactPoint *points = collisionCollector.points.data();
+    float simScale = this->simScale;
+    float subStep = this->subStep;
+    processSolverBatches([&pairs, points, simScale, subStep](int start, int end)
+                         { _solve(pairs.begin() + start, pairs.begin() + end, points, simScale, subStep); });
+}
+
+void PhysicsWorld::solveContacts()
+{
+    std::vector<CollisionPair> &pairs = solverPairs;
+    const ContactPoint *points = collisionCollector.points.data();
+    float simScale = this->simScale;
+    float subStep = this->subStep;
+    const ContactCache *cache = &contactCache;
+
+    contactConstraints.resize(collisionCollector.points.size());
+    ContactConstraint *constraints = contactConstraints.data();
+
+    // Preparing only reads bodies, so it doesn't need batches
+    jobQueue->parallelFor(0, pairs.size(), _grain(pairs.size(), maxJobs), [&pairs, points, constraints, cache, simScale, subStep](int start, int end)
+                          { _prepareContacts(pairs.begin() + start, pairs.begin() + end, points, constraints, cache, simScale, subStep); });
+
+    processSolverBatches([&pairs, constraints, simScale](int start, int end)
+                         { _warmStartContacts(pairs.begin() + start, pairs.begin() + end, constraints, simScale); });
+
+    for (int i = 0; i < solverIterations; i++)
     {
-        int pairsPerThread = pairs.size() / maxJobs;
-        std::vector<BodyPair>::iterator currentPair = pairs.begin();
-        auto pCollisionDispatcher = &collisionDispatcher;
-        auto pCollisionCollector = &collisionCollector;
+        processSolverBatches([&pairs, constraints, simScale](int start, int end)
+                             { _solveContacts(pairs.begin() + start, pairs.begin() + end, constraints, simScale); });
+    }
 
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? pairs.end() : currentPair + pairsPerThread;
+    _storeContacts(pairs.begin(), pairs.end(), constraints, &contactCache);
+    contactCache.swap();
+}
 
-            jobQueue->queueJob([currentPair, end, pCollisionDispatcher, pCollisionCollector]
-                               { _collide(currentPair, end, pCollisionDispatcher, pCollisionCollector); });
+void PhysicsWorld::applyStep()
+{
+    float subStep = this->subStep;
+    int size = bodyStorage.size();
+    jobQueue->parallelFor(0, size, _grain(size, maxJobs), [this, subStep](int start, int end)
+                          { _integratePositions(&bodyStorage, start, end, subStep); });
+}
 
-            currentPair += pairsPerThread;
-        }
-        while (jobQueue->isBusy())
-        {
-        };
+// Root of the union find set, paths are halved on the way
+inline int _findIslandRoot(std::vector<int> &parents, int node)
+{
+    while (parents[node] != node)
+    {
+        parents[node] = parents[parents[node]];
+        node = parents[node];
     }
+    return node;
 }
 
-void PhysicsWorld::solveCollisions()
+#define ISLAND_HAS_AWAKE 1
+#define ISLAND_HAS_SLEEPING 2
+#define ISLAND_NOT_READY 4
+
+void PhysicsWorld::updateIslands()
 {
-    if (maxJobs > collisionCollector.pairs.size() || maxJobs <= 4)
+    int bodiesAmount = bodies.size();
+    islandParents.resize(bodiesAmount);
+    islandFlags.assign(bodiesAmount, 0);
+    islandRoots.assign(bodiesAmount, -1);
+    for (int i = 0; i < bodiesAmount; i++)
     {
-        _solve(collisionCollector.pairs.begin(), collisionCollector.pairs.end(), simScale, subStep);
+        islandParents[i] = i;
+        bodies[i]->setIslandNode(i);
     }
-    else
+
+    // Static bodies don't join islands, otherwise everything on the floor would be one island
+    for (auto &pair : collisionCollector.pairs)
     {
-        if (!collisionCollector.pairs.empty())
+        if (pair.pointsAmount == 0 ||
+            pair.a->getMotionType() != PhysicsMotionType::Dynamic ||
+            pair.b->getMotionType() != PhysicsMotionType::Dynamic)
+            continue;
+
+        int rootA = _findIslandRoot(islandParents, pair.a->getIslandNode());
+        int rootB = _findIslandRoot(islandParents, pair.b->getIslandNode());
+        if (rootA != rootB)
+            islandParents[rootA] = rootB;
+    }
+
+    // Linked bodies are one island even apart, so one of them waking wakes the other through its island
+    for (int i = 0; i < bodiesAmount; i++)
+    {
+        PhysicsBody *body = bodies[i];
+        if (!body->isConstrained() || body->getMotionType() != PhysicsMotionType::Dynamic)
+            continue;
+
+        for (auto &constraint : *body->getConstraints())
         {
-            int pairsPerThread = collisionCollector.pairs.size() / maxJobs;
-            std::vector<CollisionPair>::iterator currentCollisionPair = collisionCollector.pairs.begin();
+            PhysicsBody *linked = constraint->getLinkedBody();
+            int node = linked ? linked->getIslandNode() : -1;
+            if (node < 0 || node >= bodiesAmount || bodies[node] != linked || node == i || linked->getMotionType() != PhysicsMotionType::Dynamic)
+                continue;
 
-            float simScale = this->simScale;
-            float subStep = this->subStep;
-            for (int i = 0; i < maxJobs; i++)
-            {
-                auto end = (i == maxJobs - 1) ? collisionCollector.pairs.end() : currentCollisionPair + pairsPerThread;
+            int rootA = _findIslandRoot(islandParents, i);
+            int rootB = _findIslandRoot(islandParents, node);
+            if (rootA != rootB)
+                islandParents[rootA] = rootB;
+        }
+    }
+
+    for (int i = 0; i < bodiesAmount; i++)
+    {
+        PhysicsBody *body = bodies[i];
+        if (body->getMotionType() != PhysicsMotionType::Dynamic || !body->isSimulatingPhysics() || !body->isEnabled())
+            continue;
+
+        char &flags = islandFlags[_findIslandRoot(islandParents, i)];
+        if (body->isSleeping())
+            flags |= ISLAND_HAS_SLEEPING;
+        else
+        {
+            flags |= ISLAND_HAS_AWAKE;
+            if (!body->isReadyToSleep())
+                flags |= ISLAND_NOT_READY;
+        }
+    }
+
+    int activeIslands = 0;
+    for (int i = 0; i < bodiesAmount; i++)
+    {
+        PhysicsBody *body = bodies[i];
+        if (body->getMotionType() != PhysicsMotionType::Dynamic || !body->isSimulatingPhysics() || !body->isEnabled())
+            continue;
+
+        int root = _findIslandRoot(islandParents, i);
+        char flags = islandFlags[root];
+        if (!(flags & ISLAND_HAS_AWAKE))
+            continue;
+
+        // Awake body touched a sleeping one, its island wakes with the next substep
+        if (flags & ISLAND_HAS_SLEEPING)
+        {
+            if (body->isSleeping())
+                body->forceWake();
+            if (i == root)
+                activeIslands++;
+            continue;
+        }
 
-                jobQueue->queueJob([currentCollisionPair, end, simScale, subStep]
-                                   { _solve(currentCollisionPair, end, simScale, subStep); });
+        if (flags & ISLAND_NOT_READY)
+        {
+            if (i == root)
+                activeIslands++;
+            continue;
+        }
 
-                currentCollisionPair += pairsPerThread;
+        // Every body of the island rests, all of them fall asleep together
+        int &island = islandRoots[root];
+        if (island == -1)
+        {
+            if (!freeIslands.empty())
+            {
+                island = freeIslands.back();
+                freeIslands.pop_back();
             }
-            while (jobQueue->isBusy())
+            else
             {
-            };
+                island = islands.size();
+                islands.emplace_back();
+            }
+            sleepingIslandsAmount++;
         }
+        islands[island].push_back(body);
+        body->setIsland(island);
+        body->setAsleep();
     }
+
+    profile.activeIslands = activeIslands;
+    profile.sleepingIslands = sleepingIslandsAmount;
 }
 
-void PhysicsWorld::applyStep()
+void PhysicsWorld::wakeIslands()
 {
-    float subStep = this->subStep;
-    if (maxJobs > bodies.size() || maxJobs <= 4)
+    for (int i = 0; i < (int)islands.size(); i++)
     {
-        _applyStepBody(bodies.begin(), bodies.end(), subStep);
+        for (auto &body : islands[i])
+        {
+            if (!body->isSleeping())
+            {
+                wakeIsland(i);
+                break;
+            }
+        }
     }
-    else
+}
+
+void PhysicsWorld::wakeIsland(int island)
+{
+    for (auto &body : islands[island])
     {
-        int bodiesPerThread = bodies.size() / maxJobs;
-        std::vector<PhysicsBody *>::iterator currentBody = bodies.begin();
+        body->setAwake();
+        body->setIsland(-1);
+    }
+    islands[island].clear();
+    freeIslands.push_back(island);
+    sleepingIslandsAmount--;
+}
 
-        for (int i = 0; i < maxJobs; i++)
-        {
-            auto end = (i == maxJobs - 1) ? bodies.end() : currentBody + bodiesPerThread;
+void PhysicsWorld::buildSubStepGraph()
+{
+    int jobs = maxJobs;
+    if ((int)jobPairs.size() < jobs)
+        jobPairs.resize(jobs);
+    if ((int)jobCollectors.size() < jobs)
+        jobCollectors.resize(jobs);
 
-            jobQueue->queueJob([currentBody, end, subStep]
-                               { _applyStepBody(currentBody, end, subStep); });
+    subStepGraph.clear();
+    graphNodeProfile.clear();
 
-            currentBody += bodiesPerThread;
-        }
-        while (jobQueue->isBusy())
-        {
-        };
+    int forces = subStepGraph.addNode(jobs, [this, jobs](int chunk)
+                                      {
+                                          int start, end;
+                                          _chunkRange(bodyStorage.size(), jobs, chunk, &start, &end);
+                                          _integrateVelocities(&bodyStorage, start, end, subStep, gravity * simScale); });
+    graphNodeProfile.push_back(&profile.integration);
+
+    int broadphase = subStepGraph.addNode(1, [this](int chunk)
+                                          {
+                                              pairs.clear();
+                                              updateBroadphase();
+                                              if (broadphaseType == BroadphaseType::SweepAndPrune)
+                                                  sweepAndPrune.findPairs(&unboundedBodies, &pairs); });
+    graphNodeProfile.push_back(&profile.broadphase);
+    subStepGraph.addDependency(broadphase, forces);
+
+    int merge = subStepGraph.addNode(1, [this, jobs](int chunk)
+                                     {
+                                         if (broadphaseType != BroadphaseType::SweepAndPrune)
+                                         {
+                                             for (int i = 0; i < jobs; i++)
+                                                 pairs.insert(pairs.end(), jobPairs[i].begin(), jobPairs[i].end());
+                                         }
+
+                                         // joined in job order, so the result doesn't depend on thread timing
+                                         collisionCollector.clear();
+                                         for (int i = 0; i < jobs; i++)
+                                             collisionCollector.merge(jobCollectors[i]);
+                                         storeAxes();
+                                         storeManifolds(); });
+    graphNodeProfile.push_back(&profile.narrowphase);
+
+    // Every job looks for pairs of its bodies and checks them right away
+    for (int i = 0; i < jobs; i++)
+    {
+        int collect = subStepGraph.addNode(1, [this, jobs, i](int chunk)
+                                           {
+                                               int start, end;
+                                               std::vector<BodyPair> &list = jobPairs[i];
+                                               list.clear();
+                                               if (broadphaseType == BroadphaseType::SweepAndPrune)
+                                               {
+                                                   _chunkRange(pairs.size(), jobs, i, &start, &end);
+                                                   list.assign(pairs.begin() + start, pairs.begin() + end);
+                                               }
+                                               else
+                                               {
+                                                   _chunkRange(broadphaseBodies.size(), jobs, i, &start, &end);
+                                                   _collectPairs(broadphaseBodies.begin() + start, broadphaseBodies.begin() + end, &dynamicTree, &staticTree, &unboundedBodies, &list);
+                                               } });
+        graphNodeProfile.push_back(&profile.broadphase);
+        subStepGraph.addDependency(collect, broadphase);
+
+        int collide = subStepGraph.addNode(1, [this, i](int chunk)
+                                           {
+                                               jobCollectors[i].clear();
+                                               jobCollectors[i].axisCache = &axisCache;
+                                               jobCollectors[i].manifoldCache = bReuseManifolds ? &manifoldCache : nullptr;
+                                               _collide(jobPairs[i].begin(), jobPairs[i].end(), &collisionDispatcher, &jobCollectors[i]); });
+        graphNodeProfile.push_back(&profile.narrowphase);
+        subStepGraph.addDependency(collide, collect);
+        subStepGraph.addDependency(merge, collide);
     }
+
+    // Batches have to go one after another, solving splits every one of them between threads itself
+    int solve = subStepGraph.addNode(1, [this](int chunk)
+                                     { solveCollisions(); });
+    graphNodeProfile.push_back(&profile.solver);
+    subStepGraph.addDependency(solve, merge);
+
+    int sweep = subStepGraph.addNode(1, [this](int chunk)
+                                     { sweepFastBodies(); });
+    graphNodeProfile.push_back(&profile.narrowphase);
+    subStepGraph.addDependency(sweep, solve);
+
+    int step = subStepGraph.addNode(jobs, [this, jobs](int chunk)
+                                    {
+                                        int start, end;
+                                        _chunkRange(bodyStorage.size(), jobs, chunk, &start, &end);
+                                        _integratePositions(&bodyStorage, start, end, subStep); });
+    graphNodeProfile.push_back(&profile.integration);
+    subStepGraph.addDependency(step, sweep);
+}
+
+void PhysicsWorld::runSubStepGraph()
+{
+    if (subStepGraph.getNodesAmount() == 0)
+        buildSubStepGraph();
+
+    subStepGraph.run(jobQueue);
+    for (int i = 0; i < (int)graphNodeProfile.size(); i++)
+        *graphNodeProfile[i] += subStepGraph.getNodeTime(i);
 }
 
 void PhysicsWorld::triggerCollisionEvents(CollisionCollector *collisionCollector)
 {
     for (auto &pair : collisionCollector->pairs)
     {
+        if (pair.pointsAmount == 0)
+            continue;
+
+        const Vector3 &pointA = collisionCollector->getPoint(pair, 0).pointOnA;
+        const Vector3 &pointB = collisionCollector->getPoint(pair, 0).pointOnB;
         if (pair.a->getCollisionHandler())
-            pair.a->getCollisionHandler()->triggerCollision(pair.a, pair.b, pair.manifold.pointsOnA[0], pair.manifold.pointsOnB[0]);
+            pair.a->getCollisionHandler()->triggerCollision(pair.a, pair.b, pointA, pointB);
         if (pair.b->getCollisionHandler() && pair.a->getCollisionHandler() != pair.b->getCollisionHandler())
-            pair.b->getCollisionHandler()->triggerCollision(pair.a, pair.b, pair.manifold.pointsOnA[0], pair.manifold.pointsOnB[0]);
+            pair.b->getCollisionHandler()->triggerCollision(pair.a, pair.b, pointA, pointB);
     }
 }
 
@@ -343,11 +1080,11 @@ void PhysicsWorld::updateCollisionTimers(float delta)
     }
 }
 
-void PhysicsWorld::removeNotPersistedCollisions()
+void PhysicsWorld::dispatchCollisionEvents()
 {
     for (auto &handler : collisionHanlers)
     {
-        handler->removeNotPersistedCollisions();
+        handler->dispatchCollisionEvents();
     }
 }
 
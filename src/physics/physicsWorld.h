@@ -7,15 +7,21 @@
 #include "utils/segment.h"
 #include "data/entity.h"
 #include "utils/jobQueue.h"
+#include "utils/jobGraph.h"
 #include "collisionCollector.h"
 #include "collisionDispatcher.h"
 #include "collisionSolver.h"
+#include "contactCache.h"
 #include "physicsBody.h"
+#include "physicsBodyStorage.h"
 #include "physicsForm.h"
+#include "physicsState.h"
 #include "physicsUtils.h"
 #include "collisionHandler.h"
 #include "constraints/constraint.h"
 #include "constraints/constraintAxis.h"
+#include "broadphase/dynamicTree.h"
+#include "broadphase/sweepAndPrune.h"
 #include "channels.h"
 #include <string>
 #include <list>
@@ -23,6 +29,77 @@
 #define DEFAULT_GRAVITY Vector3(0.0f, -96.0f, 0.0f)
 #define DEFAULT_SIM_SCALE 1.0f
 #define DEFAULT_SUB_STEP 0.006f
+#define DEFAULT_BROADPHASE_MARGIN 0.05f
+#define PHYSICS_MIN_GRAIN 16
+#define DEFAULT_SOLVER_ITERATIONS 8
+#define DEFAULT_CONTACT_MATCH_DISTANCE 0.01f
+#define DEFAULT_MANIFOLD_REUSE_DISTANCE 0.002f
+#define DEFAULT_MANIFOLD_REUSE_ANGLE 0.01f
+#define DEFAULT_SLEEP_CHECK 0.006f
+#define DEFAULT_VELOCITY_LIMIT 120.0f
+#define SHAPE_CAST_TOLERANCE 0.001f
+
+// Bodies with continuous collision detection are swept when they move further than this part of their radius in a substep
+#define CCD_MOTION_THRESHOLD 0.5f
+// Part of the radius a swept body is let into the surface it hits, so regular contacts catch it on the next substep
+#define CCD_PENETRATION 0.1f
+
+enum class BroadphaseType
+{
+    DynamicTree,   // Bounding volume trees, works well for any scene
+    SweepAndPrune, // Sorted endpoint lists, best for flat scenes with lots of bodies
+};
+
+enum class SolverType
+{
+    SingleContact,     // Deepest point of every pair solved once per substep, compound pairs solve all of theirs
+                       // Needs small substeps to keep stacks stable
+    SequentialImpulse, // All points solved over several iterations starting from impulses of the previous substep
+};
+
+enum class RayCastMode
+{
+    FirstHit, // Closest hit of every ray, rays get shorter as hits are found so less bodies are tested
+    AllHits,  // Every hit of every ray sorted by distance
+};
+
+// Hits of a batch of rays, hits of ray i are points from starts[i] to starts[i + 1]
+struct RayCastResults
+{
+    std::vector<PhysicsBodyPoint> points;
+    std::vector<int> starts;
+
+    inline int getHitsAmount(int ray) const { return starts[ray + 1] - starts[ray]; }
+    inline const PhysicsBodyPoint *getHits(int ray) const { return points.data() + starts[ray]; }
+};
+
+// First touch of a shape moved through the world
+struct ShapeCastHit
+{
+    void *userData;
+    Vector3 point;
+    Vector3 normal;
+
+    // Part of the movement done before the touch, from 0 to 1
+    float time;
+};
+
+// Time spent in simulation stages during the last processed frame, in milliseconds
+// With task graph stages overlap, so their time is the work done summed over all threads
+struct PhysicsWorldProfile
+{
+    int subSteps = 0;
+    int pairs = 0;
+    int contacts = 0;
+    int activeIslands = 0;
+    int sleepingIslands = 0;
+    float integration = 0.0f;
+    float broadphase = 0.0f;
+    float narrowphase = 0.0f;
+    float solver = 0.0f;
+    float simulation = 0.0f;
+    float total = 0.0f;
+};
 
 class PhysicsWorld
 {
@@ -36,9 +113,17 @@ public:
     EXPORT PhysicsBody *createPhysicsBody(PhysicsMotionType motionType, PhysicsForm *form, Entity *entity, Vector3 initialPosition, Quat initialRotation, bool simulatePhysics);
 
     EXPORT std::vector<PhysicsBodyPoint> castRayCollision(const Segment &ray, Channel channel);
+    EXPORT void castRays(const Segment *rays, int amount, Channel channel, RayCastResults *results, RayCastMode mode = RayCastMode::FirstHit);
+
+    // Bodies closer than radius to the point or the segment sorted by distance, point is the closest one on the body
     EXPORT std::vector<PhysicsBodyPoint> castSphereCollision(const Vector3 &p, float radius, Channel channel);
+    EXPORT std::vector<PhysicsBodyPoint> castCapsuleCollision(const Vector3 &a, const Vector3 &b, float radius, Channel channel);
     EXPORT std::vector<PhysicsBodyPoint> castPointCollision(const Vector3 &p, Channel channel);
 
+    // Moves the shape along translation, returns true and fills hit with the first body it touches
+    EXPORT bool castSphereSweep(const Vector3 &from, const Vector3 &to, float radius, Channel channel, ShapeCastHit *hit);
+    EXPORT bool castCapsuleSweep(const Vector3 &a, const Vector3 &b, float radius, const Vector3 &translation, Channel channel, ShapeCastHit *hit);
+
     template <class T, typename std::enable_if<std::is_base_of<CollisionHandler, T>::value>::type * = nullptr>
     inline T *createCollisionHandler()
     {
@@ -48,6 +133,7 @@ public:
     }
 
     inline CollisionCollector *getCollisionCollector() { return &collisionCollector; }
+    inline PhysicsBodyStorage *getBodyStorage() { return &bodyStorage; }
     inline CollisionDispatcher *getCollisionDispatcher() { return &collisionDispatcher; }
 
     inline float getSimScale() { return simScale; }
@@ -56,6 +142,50 @@ public:
     inline Vector3 getGravity() { return gravity; }
     inline void setGravity(Vector3 gravity) { this->gravity = gravity; }
 
+    inline const PhysicsWorldProfile &getProfile() { return profile; }
+
+    // Runs substep stages as dependent tasks instead of separating every stage with a barrier
+    inline void setTaskGraph(bool bState) { bUseTaskGraph = bState; }
+    inline bool isUsingTaskGraph() { return bUseTaskGraph; }
+
+    // Pairs that barely moved against each other since narrowphase found their points move the points along instead of finding them again
+    EXPORT void setManifoldReuse(bool bState);
+    inline bool isReusingManifolds() { return bReuseManifolds; }
+
+    EXPORT void setBroadphase(BroadphaseType broadphaseType);
+    inline BroadphaseType getBroadphase() { return broadphaseType; }
+
+    // Sequential impulse solver stays stable with much larger substeps, so it can be cheaper overall
+    EXPORT void setSolver(SolverType solverType, int iterations = DEFAULT_SOLVER_ITERATIONS);
+    inline SolverType getSolver() { return solverType; }
+    inline int getSolverIterations() { return solverIterations; }
+
+    // GJK is cheaper for hulls with many verticies, separating axis is kept to compare with
+    EXPORT void setNarrowphase(NarrowphaseType narrowphaseType);
+    inline NarrowphaseType getNarrowphase() { return collisionDispatcher.getNarrowphase(); }
+
+    // Body integration kernels, the best supported level is picked by default, higher than supported ones fall back to it
+    EXPORT void setSimdLevel(SimdLevel simdLevel);
+    inline SimdLevel getSimdLevel() { return bodyStorage.simdLevel; }
+
+    // Mutable state of the simulation: transformations and velocities of bodies, sleeping islands, time left from the last frame and caches of contacts
+    // State can only be loaded into the world it came from while it has the same bodies, collision handlers are not part of it
+    EXPORT void saveState(PhysicsStateBuffer *buffer);
+
+    // False if the state doesn't fit bodies of the world or is broken, bodies and islands are left as they were then
+    // Caches can be cleared by a broken state
+    EXPORT bool loadState(PhysicsStateBuffer *buffer);
+
+    // Pairs are put in the order of body ids and substeps go stage by stage, so loaded state simulates the same bits again
+    // Order of pairs found by broadphase depends on the history of its trees, which is not part of the state
+    inline void setDeterministic(bool bState) { bDeterministic = bState; }
+    inline bool isDeterministic() { return bDeterministic; }
+
+    // Entities are placed between the last two substeps by the time left in the accumulator, so larger substeps don't judder
+    // Entities are a substep behind the simulation then, moving one moves its body with the next substep
+    inline void setInterpolation(bool bState) { bInterpolate = bState; }
+    inline bool isInterpolating() { return bInterpolate; }
+
     EXPORT void cleanDestroyedBodies();
 protected:
     // prepare bodies like copy new transformations that came from components
@@ -64,37 +194,102 @@ protected:
     // apply resulting transformation onto associated entites
     void finishBodies();
 
+    // remember transformations before the last substep of the frame for interpolation
+    void storePreviousTransformations();
+
     // add gravity, constraint forces, etc.
     void applyForces();
 
+    // sync broadphase structures with bodies that moved, fell asleep or woke up
+    void updateBroadphase();
+
+    // stop bodies with continuous collision detection at the first surface they would pass this substep
+    void sweepFastBodies();
+    void updateProxy(PhysicsBody *body, DynamicTree *tree);
+
+    // rebuild the list of bodies that queries can't find through the trees
+    void updateLooseBodies();
+
+    // fill queryBodies with bodies of the channel which bounds overlap aabb, aabb is in simulation scale
+    void collectBodies(const AABB &aabb, Channel channel);
+    void removeFromBroadphase(PhysicsBody *body);
+
     // find collided pairs
     void findCollisionPairs();
 
     // check precise collisions and make collision data
     void findCollisions();
 
+    // keep axes narrowphase ended with for the next substep
+    void storeAxes();
+
+    // keep manifolds for the next substep, refreshed ones stay as they were found
+    void storeManifolds();
+
     // apply forces to remove objects from being collided
     void solveCollisions();
+    void solveContacts();
+
+    // calls function(start, end) for solver pairs batch by batch, pairs of a batch are split between jobs
+    template <typename T>
+    void processSolverBatches(const T &function);
 
     // apply accumulated velocities
     void applyStep();
 
-    // collision events
+    // join bodies that touch into islands, islands where every body rests fall asleep together
+    void updateIslands();
+
+    // wake every island that has a woken body, so it doesn't lie on a sleeping neighbour
+    void wakeIslands();
+    void wakeIsland(int island);
+
+    // same stages as above but without barriers between them, narrowphase of a job starts when its pairs are ready
+    void buildSubStepGraph();
+    void runSubStepGraph();
+
+    // remember collisions of the substep in their handlers
     void triggerCollisionEvents(CollisionCollector *collisionCollector);
 
-    // remove collisions that ended this cycle
+    // move handlers to the next substep
     void updateCollisionTimers(float delta);
 
-    // remove collisions that ended this cycle
-    void removeNotPersistedCollisions();
+    // deliver events of all the substeps of the frame at once
+    void dispatchCollisionEvents();
 
     EXPORT void prepareNewCollisionHandler(CollisionHandler *collisionHandler);
 
     // Bodies
     std::vector<PhysicsBody *> bodies;
 
+    // Hot state of the bodies, their order differs from the list above
+    PhysicsBodyStorage bodyStorage;
+
     // Collision information
     CollisionCollector collisionCollector;
+
+    // Per job results, joined after jobs are done so they can be filled without locking
+    std::vector<CollisionCollector> jobCollectors;
+    std::vector<std::vector<BodyPair>> jobPairs;
+
+    // Collision pairs split into batches without shared bodies, so solver can run them in parallel deterministically
+    std::vector<CollisionPair> solverPairs;
+    std::vector<int> solverPairBatches;
+    std::vector<int> solverBatchStarts;
+
+    // Iterative solver state, constraints go in the same order as collector's points
+    SolverType solverType = SolverType::SingleContact;
+    int solverIterations = DEFAULT_SOLVER_ITERATIONS;
+    std::vector<ContactConstraint> contactConstraints;
+    ContactCache contactCache;
+
+    // Directions GJK ended with, jobs start from them in the next substep
+    AxisCache axisCache;
+
+    // Points of pairs in spaces of their bodies, pairs that barely moved reuse them
+    ManifoldCache manifoldCache;
+    bool bReuseManifolds = true;
+
     CollisionDispatcher collisionDispatcher;
 
     // Retrieved from R11
@@ -109,18 +304,78 @@ protected:
     // Fixed step that simulation is using
     float subStep = DEFAULT_SUB_STEP;
 
-    // Maximum jobs to add to queue
+    // Maximum jobs work is split into
     int maxJobs = 1;
 
+    // Substep pipeline, built on first use
+    JobGraph subStepGraph;
+    bool bUseTaskGraph = true;
+
+    // Profile value every graph node adds its time to
+    std::vector<float *> graphNodeProfile;
+
+    // Simulation doesn't depend on anything that loaded state doesn't restore
+    bool bDeterministic = false;
+
+    // Entities get transformations interpolated between substeps
+    bool bInterpolate = false;
+
     // holds delta left from previous frame that is less than subStep
     float deltaAccumulator = 0.0f;
 
+    // Structure used to find collision pairs
+    BroadphaseType broadphaseType = BroadphaseType::DynamicTree;
+
+    // Awake bodies that move, they are refitted when leaving their fattened bounds
+    DynamicTree dynamicTree;
+
+    // Static and sleeping bodies, only queried by the bodies from dynamic tree
+    DynamicTree staticTree;
+
+    // Bodies that don't collide, like disabled ones or ones out of simulation channel, only queries look into it
+    DynamicTree queryTree;
+
+    // All bounded bodies when sweep and prune is used instead of the trees
+    SweepAndPrune sweepAndPrune;
+
+    // Bodies from dynamic tree, rebuilt with every broadphase update
+    std::vector<PhysicsBody *> broadphaseBodies;
+
+    // Bodies with infinite bounds (plains) that would ruin the tree, tested against every awake body
+    std::vector<PhysicsBody *> unboundedBodies;
+
     // Collided pairs
     std::vector<BodyPair> pairs;
 
     // For ray picking
     std::vector<PhysicsBodyPoint> points;
+    RayCastResults rayResults;
+    std::vector<Segment> raysLocal;
+
+    // Bodies rays can't find through the trees, they have no proxy or moved out of its fat bounds after the last update
+    // With sweep and prune colliding bodies are among them too
+    std::vector<PhysicsBody *> looseBodies;
+    bool bLooseBodiesOutdated = true;
+
+    // Candidates of shape queries
+    std::vector<PhysicsBody *> queryBodies;
+
+    // Hits of every ray job, joined in job order
+    std::vector<std::vector<PhysicsBodyPoint>> jobRayPoints;
 
     // All the collision handlers
     std::vector<CollisionHandler *> collisionHanlers;
+
+    // Bodies of sleeping islands, free ones are empty
+    std::vector<std::vector<PhysicsBody *>> islands;
+    std::vector<int> freeIslands;
+    int sleepingIslandsAmount = 0;
+
+    // Union find over the body list, rebuilt with every substep
+    std::vector<int> islandParents;
+    std::vector<char> islandFlags;
+    std::vector<int> islandRoots;
+
+    // Stage timings of the last frame
+    PhysicsWorldProfile profile;
 };
\ No newline at end of file
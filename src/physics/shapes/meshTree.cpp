@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "meshTree.h"
+#include <algorithm>
+#include <cfloat>
+
+void MeshTree::build(const Vector3 *verticies, PolygonTriPoints *polygons, int polygonsAmount)
+{
+    nodes.clear();
+    if (polygonsAmount <= 0)
+        return;
+
+    polygonBounds.resize(polygonsAmount);
+    centroids.resize(polygonsAmount);
+    order.resize(polygonsAmount);
+    for (int i = 0; i < polygonsAmount; i++)
+    {
+        const Vector3 &a = verticies[polygons[i].a];
+        const Vector3 &b = verticies[polygons[i].b];
+        const Vector3 &c = verticies[polygons[i].c];
+        polygonBounds[i] = AABB(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+        centroids[i] = (a + b + c) / 3.0f;
+        order[i] = i;
+    }
+
+    nodes.reserve(polygonsAmount * 2 / MESH_TREE_LEAF_SIZE + 1);
+    buildNode(0, polygonsAmount, 0);
+
+    // Leaves point to ranges of the order, polygons are moved there so leaves read them one after another
+    std::vector<PolygonTriPoints> reordered(polygonsAmount);
+    for (int i = 0; i < polygonsAmount; i++)
+        reordered[i] = polygons[order[i]];
+    memcpy(polygons, reordered.data(), sizeof(PolygonTriPoints) * polygonsAmount);
+
+    polygonBounds = std::vector<AABB>();
+    centroids = std::vector<Vector3>();
+    order = std::vector<int>();
+}
+
+int MeshTree::buildNode(int start, int end, int depth)
+{
+    int nodeId = (int)nodes.size();
+    nodes.push_back(MeshTreeNode());
+
+    AABB bounds = polygonBounds[order[start]];
+    AABB centroidBounds(centroids[order[start]], centroids[order[start]]);
+    for (int i = start + 1; i < end; i++)
+    {
+        bounds.extend(polygonBounds[order[i]]);
+        const Vector3 &centroid = centroids[order[i]];
+        centroidBounds.extend(AABB(centroid, centroid));
+    }
+    nodes[nodeId].aabb = bounds;
+
+    int count = end - start;
+    if (count <= MESH_TREE_LEAF_SIZE || depth >= MESH_TREE_MAX_DEPTH)
+    {
+        nodes[nodeId].offset = start;
+        nodes[nodeId].count = count;
+        return nodeId;
+    }
+
+    // Centroids are put into bins along every axis, the cheapest border between bins is the split
+    int bestAxis = -1;
+    int bestBin = 0;
+    float bestCost = FLT_MAX;
+    Vector3 extent = centroidBounds.end - centroidBounds.start;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        AABB binBounds[MESH_TREE_BINS];
+        int binCounts[MESH_TREE_BINS] = {0};
+        float scale = (float)MESH_TREE_BINS / extent[axis];
+        for (int i = start; i < end; i++)
+        {
+            int bin = std::min((int)((centroids[order[i]][axis] - centroidBounds.start[axis]) * scale), MESH_TREE_BINS - 1);
+            if (binCounts[bin] == 0)
+                binBounds[bin] = polygonBounds[order[i]];
+            else
+                binBounds[bin].extend(polygonBounds[order[i]]);
+            binCounts[bin]++;
+        }
+
+        // Areas of everything right from every border, then left side is swept the other way
+        float rightAreas[MESH_TREE_BINS];
+        int rightCounts[MESH_TREE_BINS];
+        AABB right;
+        int rightCount = 0;
+        for (int bin = MESH_TREE_BINS - 1; bin > 0; bin--)
+        {
+            if (binCounts[bin] > 0)
+            {
+                right = rightCount == 0 ? binBounds[bin] : AABB::combine(right, binBounds[bin]);
+                rightCount += binCounts[bin];
+            }
+            rightAreas[bin] = rightCount > 0 ? right.getSurfaceArea() : 0.0f;
+            rightCounts[bin] = rightCount;
+        }
+
+        AABB left;
+        int leftCount = 0;
+        for (int bin = 0; bin < MESH_TREE_BINS - 1; bin++)
+        {
+            if (binCounts[bin] > 0)
+            {
+                left = leftCount == 0 ? binBounds[bin] : AABB::combine(left, binBounds[bin]);
+                leftCount += binCounts[bin];
+            }
+            if (leftCount == 0 || rightCounts[bin + 1] == 0)
+                continue;
+
+            float cost = left.getSurfaceArea() * (float)leftCount + rightAreas[bin + 1] * (float)rightCounts[bin + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    int middle;
+    if (bestAxis != -1)
+    {
+        float scale = (float)MESH_TREE_BINS / extent[bestAxis];
+        float axisStart = centroidBounds.start[bestAxis];
+        int *split = std::partition(order.data() + start, order.data() + end, [this, bestAxis, bestBin, scale, axisStart](int polygon)
+                                    { return std::min((int)((centroids[polygon][bestAxis] - axisStart) * scale), MESH_TREE_BINS - 1) <= bestBin; });
+        middle = (int)(split - order.data());
+    }
+    else
+    {
+        // Every centroid is at the same point, polygons are just split in halves
+        middle = (start + end) / 2;
+    }
+
+    buildNode(start, middle, depth + 1);
+    int right = buildNode(middle, end, depth + 1);
+    nodes[nodeId].offset = right;
+    nodes[nodeId].count = 0;
+    return nodeId;
+}
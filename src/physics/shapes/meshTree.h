@@ -0,0 +1,204 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+#include "utils/traversalStack.h"
+#include "data/mesh.h"
+#include <vector>
+
+#define MESH_TREE_LEAF_SIZE 4
+#define MESH_TREE_BINS 12
+#define MESH_TREE_MAX_DEPTH 60
+// Traversal stack entries kept in place, deeper traversals move it to the heap
+#define MESH_TREE_STACK_SIZE 64
+#define MESH_TREE_PAIR_STACK_SIZE 256
+
+// Nodes are stored in depth first order, first child of a branch goes right after it
+struct MeshTreeNode
+{
+    AABB aabb;
+
+    // Second child for branches, first polygon for leaves
+    int offset;
+
+    // Polygons in the leaf, 0 for branches
+    int count;
+
+    inline bool isLeaf() const { return count > 0; }
+};
+
+// Static bounding volume tree over triangles of a mesh, built once with surface area heuristic
+// Ingo Wald - On fast Construction of SAH-based Bounding Volume Hierarchies
+class MeshTree
+{
+public:
+    // Reorders polygons so every leaf references a continuous range of them
+    EXPORT void build(const Vector3 *verticies, PolygonTriPoints *polygons, int polygonsAmount);
+
+    // Calls callback(int polygon) for every polygon from leaves which pass test(const AABB &nodeBounds)
+    // Test is checked when node is taken from the stack, so it may tighten while traversal goes on
+    // Traversal stops when callback returns false
+    template <typename Test, typename T>
+    inline void traverse(Test test, T callback) const
+    {
+        if (nodes.empty())
+            return;
+
+        TraversalStack<int, MESH_TREE_STACK_SIZE> stack;
+        stack.push(0);
+
+        while (!stack.isEmpty())
+        {
+            int nodeId = stack.pop();
+            const MeshTreeNode &node = nodes[nodeId];
+            if (!test(node.aabb))
+                continue;
+
+            if (node.isLeaf())
+            {
+                for (int i = node.offset; i < node.offset + node.count; i++)
+                {
+                    if (!callback(i))
+                        return;
+                }
+            }
+            else
+            {
+                stack.push(node.offset);
+                stack.push(nodeId + 1);
+            }
+        }
+    }
+
+    template <typename T>
+    inline void query(const AABB &aabb, T callback) const
+    {
+        traverse([&aabb](const AABB &bounds)
+                 { return bounds.test(aabb); },
+                 callback);
+    }
+
+    // Walks both trees at once and calls callback(int polygon, int otherPolygon) for polygons of leaves which bounds overlap
+    // Nodes of the other tree are brought into space of this one by otherToThis, the bigger node of a pair is split first
+    // Traversal stops when callback returns false
+    template <typename T>
+    inline void queryTree(const MeshTree &other, const Matrix4 &otherToThis, T callback) const
+    {
+        if (nodes.empty() || other.nodes.empty())
+            return;
+
+        struct NodePair
+        {
+            int nodeId;
+            int otherNodeId;
+        };
+        TraversalStack<NodePair, MESH_TREE_PAIR_STACK_SIZE> stack;
+        stack.push({0, 0});
+
+        while (!stack.isEmpty())
+        {
+            NodePair nodePair = stack.pop();
+            int nodeId = nodePair.nodeId;
+            int otherNodeId = nodePair.otherNodeId;
+            const MeshTreeNode &node = nodes[nodeId];
+            const MeshTreeNode &otherNode = other.nodes[otherNodeId];
+
+            AABB otherBounds = otherNode.aabb.getTransformed(otherToThis);
+            if (!node.aabb.test(otherBounds))
+                continue;
+
+            if (node.isLeaf() && otherNode.isLeaf())
+            {
+                for (int i = node.offset; i < node.offset + node.count; i++)
+                {
+                    for (int j = otherNode.offset; j < otherNode.offset + otherNode.count; j++)
+                    {
+                        if (!callback(i, j))
+                            return;
+                    }
+                }
+                continue;
+            }
+
+            bool bSplitThis = otherNode.isLeaf() || (!node.isLeaf() && node.aabb.getSurfaceArea() >= otherBounds.getSurfaceArea());
+            if (bSplitThis)
+            {
+                stack.push({node.offset, otherNodeId});
+                stack.push({nodeId + 1, otherNodeId});
+            }
+            else
+            {
+                stack.push({nodeId, otherNode.offset});
+                stack.push({nodeId, otherNodeId + 1});
+            }
+        }
+    }
+
+    // Calls callback(int polygon) going from leaves nearest to aabb, nodes further than maxDistance are skipped
+    // Callback is expected to lower maxDistance when it finds something closer
+    template <typename T>
+    inline void queryClosest(const AABB &aabb, const float *maxDistance, T callback) const
+    {
+        if (nodes.empty())
+            return;
+
+        struct Entry
+        {
+            int nodeId;
+            float distance;
+        };
+        TraversalStack<Entry, MESH_TREE_STACK_SIZE> stack;
+        stack.push({0, getDistance(nodes[0].aabb, aabb)});
+
+        while (!stack.isEmpty())
+        {
+            Entry entry = stack.pop();
+            if (entry.distance > *maxDistance)
+                continue;
+
+            int nodeId = entry.nodeId;
+            const MeshTreeNode &node = nodes[nodeId];
+            if (node.isLeaf())
+            {
+                for (int i = node.offset; i < node.offset + node.count; i++)
+                    callback(i);
+            }
+            else
+            {
+                // Nearer child goes on top of the stack, so the distance drops quickly
+                int closer = nodeId + 1, further = node.offset;
+                float closerDistance = getDistance(nodes[closer].aabb, aabb);
+                float furtherDistance = getDistance(nodes[further].aabb, aabb);
+                if (furtherDistance < closerDistance)
+                {
+                    std::swap(closer, further);
+                    std::swap(closerDistance, furtherDistance);
+                }
+                stack.push({further, furtherDistance});
+                stack.push({closer, closerDistance});
+            }
+        }
+    }
+
+    // Distance between closest points of two boxes, 0 if they overlap
+    inline static float getDistance(const AABB &a, const AABB &b)
+    {
+        Vector3 gap = glm::max(Vector3(0.0f), glm::max(a.start - b.end, b.start - a.end));
+        return glm::length(gap);
+    }
+
+    inline int getNodesAmount() const { return (int)nodes.size(); }
+    inline const AABB &getAABB() const { return nodes[0].aabb; }
+
+protected:
+    int buildNode(int start, int end, int depth);
+
+    std::vector<MeshTreeNode> nodes;
+
+    // Used only while building
+    std::vector<AABB> polygonBounds;
+    std::vector<Vector3> centroids;
+    std::vector<int> order;
+};
@@ -12,6 +12,13 @@ Shape::~Shape()
 {
 }
 
+float Shape::sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly)
+{
+    return _sweepConvex([this, &segment, radius, cache](const Vector3 &offset, PhysicsBodyPoint *closest)
+                        { return getSegmentDistance(Segment(segment.a + offset, segment.b + offset), closest, cache) - radius; },
+                        translation, maxTime, tolerance, closest, bApproachingOnly);
+}
+
 std::string Shape::getTypeName(ShapeCollisionType type)
 {
     switch (type)
@@ -31,6 +31,13 @@ public:
     EXPORT virtual ShapeCollisionType getType() = 0;
     EXPORT virtual AABB getAABB(const Matrix4 &model) = 0;
     EXPORT virtual int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) = 0;
+    // Closest point of the shape's surface to the segment, segment with equal ends is a point
+    // Returns the distance, 0 if the segment touches or goes through the shape
+    // Normal of the closest point points out of the shape
+    EXPORT virtual float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) = 0;
+    // Moves the capsule around the segment along translation, returns the part of the translation done
+    // when it touches the shape or FLT_MAX if it doesn't before maxTime, closest is the touch point
+    EXPORT virtual float sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly = false);
     inline void setMass(float mass) { this->mass = mass; }
     inline float getMass() { return mass; }
     inline Matrix3 &getInertiaTensor() { return inertia; }
@@ -140,4 +140,20 @@ int ShapeCapsule::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, Physi
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+float ShapeCapsule::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    float s, t;
+    Vector3 onSegment, onAxis;
+    getClosestPointSegmentSegment(segment.a, segment.b, cache->capsule.a, cache->capsule.b, s, t, onSegment, onAxis);
+    float radius = cache->capsule.radius;
+
+    Vector3 difference = onSegment - onAxis;
+    float length = glm::length(difference);
+    Vector3 normal = length > 0.0f ? difference / length : getNormalizedPerpendicular(cache->capsule.b - cache->capsule.a);
+    float distance = fmaxf(length - radius, 0.0f);
+
+    *closest = PhysicsBodyPoint({nullptr, onAxis + normal * radius, normal, distance});
+    return distance;
+}
@@ -17,6 +17,7 @@ public:
     EXPORT AABB getAABB(const Matrix4 &model) override final;
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) override final;
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) override final;
 
     inline Vector3 &getA() { return a; }
     inline Vector3 &getB() { return b; }
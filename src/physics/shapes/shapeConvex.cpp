@@ -181,6 +181,18 @@ int ShapeConvex::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, Physic
     }
 }
 
+float ShapeConvex::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    Vector3 onHull, onSegment, normal;
+    float distance = getClosestPointsSegmentHull(segment.a, segment.b,
+                                                 cache->convex.verticies, cache->convex.normals,
+                                                 polygons, polygonsAmount,
+                                                 hullEdges, hullEdgesAmount,
+                                                 onHull, onSegment, normal);
+    *closest = PhysicsBodyPoint({nullptr, onHull, normal, distance});
+    return distance;
+}
+
 void ShapeConvex::buildHull(Mesh *mesh, int limitToNumber, float simScale)
 {
     VertexDataUV *meshVertices = mesh->getVerticies()->vertexPositionUV;
@@ -23,8 +23,10 @@ public:
     EXPORT AABB getAABB(const Matrix4 &model) override final;
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) override final;
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) override final;
 
     inline Vector3 *getVerticies() { return verticies; }
+    inline const Vector3 &getCenter() { return center; }
     inline int getVerticiesAmount() { return verticiesAmount; }
 
     inline HullPolygon *getPolygons() { return polygons; }
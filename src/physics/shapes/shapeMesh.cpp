@@ -19,6 +19,7 @@ ShapeMesh::ShapeMesh(float simScale, VertexDataUV *verticies, int verticiesAmoun
     this->polygons = new PolygonTriPoints[polygonsAmount];
     this->polygonsAmount = polygonsAmount;
     memcpy(this->polygons, polygons, sizeof(PolygonTriPoints) * polygonsAmount);
+    tree.build(this->verticies, this->polygons, polygonsAmount);
 
     // Normals
     this->normals = new Vector3[polygonsAmount];
@@ -69,47 +70,168 @@ int ShapeMesh::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsB
     Vector3 v[3];
     int pCount = 0;
 
-    for (int i = 0; i < polygonsAmount; i++)
+    tree.traverse([&locRay](const AABB &bounds)
+                  { return bounds.test(locRay); },
+                  [&](int i)
+                  {
+                      auto &poly = polygons[i];
+                      v[0] = verticies[poly.a];
+                      v[1] = verticies[poly.b];
+                      v[2] = verticies[poly.c];
+
+                      if (testRayAgainstTriangle(v, locRay, distance, point))
+                      {
+                          Vector3 normalOut = glm::normalize(-rotationScaleMatrix * normals[i]);
+                          Vector3 pountOut = Vector3(cache->mesh.transformation * Vector4(point, 1.0f));
+
+                          newPoints[pCount] = PhysicsBodyPoint({nullptr, pountOut, normalOut, glm::length(ray.a - pountOut)});
+                          pCount++;
+
+                          // Only mesh can have unlimited collision points
+                          if (pCount == 8)
+                              return false;
+                      }
+                      return true;
+                  });
+
+    return pCount;
+}
+
+float ShapeMesh::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    Segment locSegment(Vector3(cache->mesh.invTransformation * Vector4(segment.a, 1.0f)),
+                       Vector3(cache->mesh.invTransformation * Vector4(segment.b, 1.0f)));
+
+    float minDistance = FLT_MAX;
+    int closestPolygon = -1;
+    Vector3 onGeometry, onSegment, newOnGeometry, newOnSegment;
+    AABB segmentBounds(glm::min(locSegment.a, locSegment.b), glm::max(locSegment.a, locSegment.b));
+    tree.queryClosest(segmentBounds, &minDistance, [&](int i)
+                      {
+                          if (minDistance == 0.0f)
+                              return;
+                          PolygonTriPoints &p = this->polygons[i];
+                          Vector3 v[3] = {verticies[p.a], verticies[p.b], verticies[p.c]};
+
+                          float distance = getTriangleDistance(locSegment, v, newOnGeometry, newOnSegment);
+                          if (distance < minDistance)
+                          {
+                              minDistance = distance;
+                              onGeometry = newOnGeometry;
+                              onSegment = newOnSegment;
+                              closestPolygon = i;
+                          } });
+
+    if (closestPolygon == -1)
+        return FLT_MAX;
+
+    // Distances are measured again in world space as the mesh can be scaled
+    Vector3 worldOnGeometry = Vector3(cache->mesh.transformation * Vector4(onGeometry, 1.0f));
+    Vector3 worldOnSegment = Vector3(cache->mesh.transformation * Vector4(onSegment, 1.0f));
+    Vector3 difference = worldOnSegment - worldOnGeometry;
+    float distance = minDistance > 0.0f ? glm::length(difference) : 0.0f;
+
+    Vector3 normal;
+    if (distance > 0.0f)
+        normal = difference / distance;
+    else
     {
-        auto &poly = polygons[i];
-        v[0] = verticies[poly.a];
-        v[1] = verticies[poly.b];
-        v[2] = verticies[poly.c];
+        // Mesh has no inside, normal of the polygon is turned to the start of the segment
+        normal = glm::normalize(Matrix3(cache->mesh.transformation) * normals[closestPolygon]);
+        if (glm::dot(normal, segment.a - worldOnGeometry) < 0.0f)
+            normal = -normal;
+    }
 
-        if (testRayAgainstTriangle(v, locRay, distance, point))
-        {
-            Vector3 normalOut = glm::normalize(-rotationScaleMatrix * normals[i]);
-            Vector3 pountOut = Vector3(cache->mesh.transformation * Vector4(point, 1.0f));
+    *closest = PhysicsBodyPoint({nullptr, worldOnGeometry, normal, distance});
+    return distance;
+}
 
-            newPoints[pCount] = PhysicsBodyPoint({nullptr, pountOut, normalOut, glm::length(ray.a - pountOut)});
-            pCount++;
+float ShapeMesh::sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly)
+{
+    Matrix4 &transformation = cache->mesh.transformation;
 
-            // Only mesh can have unlimited collision points
-            if (pCount == 8)
-                break;
-        }
+    // Bounds of the whole movement are taken into mesh space by their corners
+    Vector3 moved = translation * maxTime;
+    AABB bounds(glm::min(glm::min(segment.a, segment.b), glm::min(segment.a, segment.b) + moved) - radius,
+                glm::max(glm::max(segment.a, segment.b), glm::max(segment.a, segment.b) + moved) + radius);
+    AABB locBounds;
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3 corner(i & 1 ? bounds.end.x : bounds.start.x, i & 2 ? bounds.end.y : bounds.start.y, i & 4 ? bounds.end.z : bounds.start.z);
+        Vector3 locCorner = Vector3(cache->mesh.invTransformation * Vector4(corner, 1.0f));
+        if (i == 0)
+            locBounds = AABB(locCorner, locCorner);
+        else
+            locBounds.extend(AABB(locCorner, locCorner));
     }
 
-    return pCount;
+    // Mesh is not convex but every triangle is, so they are swept one by one
+    float bestTime = FLT_MAX;
+    PhysicsBodyPoint triangleClosest;
+    tree.query(locBounds, [&](int i)
+               {
+                   PolygonTriPoints &p = polygons[i];
+                   Vector3 v[3] = {Vector3(transformation * Vector4(verticies[p.a], 1.0f)),
+                                   Vector3(transformation * Vector4(verticies[p.b], 1.0f)),
+                                   Vector3(transformation * Vector4(verticies[p.c], 1.0f))};
+
+                   float time = _sweepConvex([&segment, radius, &v](const Vector3 &offset, PhysicsBodyPoint *point)
+                                             {
+                                                 Segment movedSegment(segment.a + offset, segment.b + offset);
+                                                 Vector3 onSegment;
+                                                 float distance = getTriangleDistance(movedSegment, v, point->point, onSegment);
+                                                 if (distance > 0.0f)
+                                                     point->normal = (onSegment - point->point) / distance;
+                                                 else
+                                                 {
+                                                     point->normal = glm::normalize(glm::cross(v[1] - v[0], v[2] - v[0]));
+                                                     if (glm::dot(point->normal, movedSegment.a - point->point) < 0.0f)
+                                                         point->normal = -point->normal;
+                                                 }
+                                                 return distance - radius; },
+                                             translation, fminf(bestTime, maxTime), tolerance, &triangleClosest, bApproachingOnly);
+                   if (time < bestTime)
+                   {
+                       bestTime = time;
+                       *closest = triangleClosest;
+                   }
+                   return true; });
+
+    return bestTime;
+}
+
+float ShapeMesh::getTriangleDistance(const Segment &segment, const Vector3 *triangle, Vector3 &onTriangle, Vector3 &onSegment)
+{
+    float distance = segment.getClosestPointToTriangle(triangle, onTriangle, onSegment);
+
+    // Ends and edges miss the segment going through the middle of the triangle
+    float fraction;
+    Vector3 crossing;
+    if (distance > 0.0f && segment.a != segment.b && testRayAgainstTriangle(triangle, segment, fraction, crossing))
+    {
+        onTriangle = onSegment = crossing;
+        return 0.0f;
+    }
+    return distance;
 }
 
 Vector3 ShapeMesh::getClosestPoint(const Vector3 &point)
 {
+    // Only nodes closer than the closest point found so far are visited
     float minDistance = FLT_MAX;
     Vector3 out(0.0f);
-    for (int i = 0; i < this->polygonsAmount; i++)
-    {
-        PolygonTriPoints &p = this->polygons[i];
-        Vector3 v[3] = {verticies[p.a], verticies[p.b], verticies[p.c]};
+    tree.queryClosest(AABB(point, point), &minDistance, [&](int i)
+                      {
+                          PolygonTriPoints &p = this->polygons[i];
+                          Vector3 v[3] = {verticies[p.a], verticies[p.b], verticies[p.c]};
 
-        Vector3 closest = getClosestPointOnTriangle(v, point);
-        float distance = glm::length(closest - point);
-        if (distance < minDistance)
-        {
-            minDistance = distance;
-            out = closest;
-        }
-    }
+                          Vector3 closest = getClosestPointOnTriangle(v, point);
+                          float distance = glm::length(closest - point);
+                          if (distance < minDistance)
+                          {
+                              minDistance = distance;
+                              out = closest;
+                          } });
     return out;
 }
 
@@ -118,19 +240,20 @@ void ShapeMesh::getClosestPoint(Segment &segment, Vector3 *onSegment, Vector3 *o
     float minDistance = FLT_MAX;
     Vector3 newOnSegment, newOnGeometry;
 
-    for (int i = 0; i < this->polygonsAmount; i++)
-    {
-        PolygonTriPoints &p = this->polygons[i];
-        Vector3 v[3] = {verticies[p.a], verticies[p.b], verticies[p.c]};
+    // Distance to segment's bounds is never more than distance to the segment itself
+    AABB segmentBounds(glm::min(segment.a, segment.b), glm::max(segment.a, segment.b));
+    tree.queryClosest(segmentBounds, &minDistance, [&](int i)
+                      {
+                          PolygonTriPoints &p = this->polygons[i];
+                          Vector3 v[3] = {verticies[p.a], verticies[p.b], verticies[p.c]};
 
-        float distance = segment.getClosestPointToTriangle(v, newOnGeometry, newOnSegment);
-        if (distance < minDistance)
-        {
-            minDistance = distance;
-            *onSegment = newOnSegment;
-            *onGeometry = newOnGeometry;
-        }
-    }
+                          float distance = segment.getClosestPointToTriangle(v, newOnGeometry, newOnSegment);
+                          if (distance < minDistance)
+                          {
+                              minDistance = distance;
+                              *onSegment = newOnSegment;
+                              *onGeometry = newOnGeometry;
+                          } });
 
     /*
     for (int i = 0; i < triCount; i++)
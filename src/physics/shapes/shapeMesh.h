@@ -6,6 +6,7 @@
 #include "utils/utils.h"
 #include "utils/math.h"
 #include "data/mesh.h"
+#include "meshTree.h"
 
 class PhysicsWorld;
 
@@ -18,6 +19,8 @@ public:
     EXPORT AABB getAABB(const Matrix4 &model) override final;
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) override final;
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) override final;
+    EXPORT float sweepSegment(const Segment &segment, float radius, const Vector3 &translation, float maxTime, float tolerance, PhysicsBodyPoint *closest, PhysicsBodyCache *cache, bool bApproachingOnly = false) override final;
 
     inline Vector3 *getVerticies() { return verticies; }
     inline int getVerticiesAmount() { return verticiesAmount; }
@@ -27,9 +30,18 @@ public:
 
     inline Vector3 *getNormals() { return normals; }
 
+    // Distance between a segment and a triangle, 0 if the segment goes through it
+    static float getTriangleDistance(const Segment &segment, const Vector3 *triangle, Vector3 &onTriangle, Vector3 &onSegment);
+
     Vector3 getClosestPoint(const Vector3 &point);
     void getClosestPoint(Segment &segment, Vector3 *onSegment, Vector3 *onGeometry);
 
+    // Calls callback(int polygon) for polygons which bounds overlap aabb in mesh space, stops when callback returns false
+    template <typename T>
+    inline void queryPolygons(const AABB &aabb, T callback) { tree.query(aabb, callback); }
+
+    inline MeshTree *getTree() { return &tree; }
+
     // inline HullEdge *getEdges() { return hullEdges; };
     // inline int getEdgesAmount() { return hullEdgesAmount; };
 
@@ -42,6 +54,9 @@ protected:
     PolygonTriPoints *polygons;
     int polygonsAmount;
 
+    // Polygons are ordered by its leaves
+    MeshTree tree;
+
     // HullEdge *hullEdges;
     // int hullEdgesAmount;
 
@@ -105,6 +105,18 @@ int ShapeOBB::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBo
     return 0;
 }
 
+float ShapeOBB::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    Vector3 onHull, onSegment, normal;
+    float distance = getClosestPointsSegmentHull(segment.a, segment.b,
+                                                 cache->OBB.points, cache->OBB.normals,
+                                                 hullPolygons, 6,
+                                                 hullEdges, hullEdgesAmount,
+                                                 onHull, onSegment, normal);
+    *closest = PhysicsBodyPoint({nullptr, onHull, normal, distance});
+    return distance;
+}
+
 Vector3 ShapeOBB::getClosestPoint(const Matrix4 &OBBTransformation, Vector3 point)
 {
     Matrix4 invTransformation = glm::inverse(OBBTransformation);
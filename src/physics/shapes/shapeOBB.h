@@ -18,6 +18,7 @@ public:
     EXPORT AABB getAABB(const Matrix4 &model) override final;
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) override final;
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) override final;
 
     EXPORT Vector3 getClosestPoint(const Matrix4 &OBBTransformation, Vector3 point);
 
@@ -31,6 +32,7 @@ public:
     inline float getHalfWidth() { return halfWidth; }
     inline float getHalfHeight() { return halfHeight; }
     inline float getHalfDepth() { return halfDepth; }
+    inline const Vector3 &getCenter() { return center; }
 
 protected:
     void rebuildPolygons();
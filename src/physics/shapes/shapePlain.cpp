@@ -46,3 +46,32 @@ int ShapePlain::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, Physics
     }
     return 0;
 }
+
+float ShapePlain::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    float &distance = cache->plain.distance;
+    Vector3 &normal = cache->plain.normal;
+
+    // Everything behind the plain is inside of it
+    float distanceA = glm::dot(normal, segment.a) - distance;
+    float distanceB = glm::dot(normal, segment.b) - distance;
+    if (distanceA > 0.0f && distanceB > 0.0f)
+    {
+        const Vector3 &end = distanceA < distanceB ? segment.a : segment.b;
+        float endDistance = fminf(distanceA, distanceB);
+        *closest = PhysicsBodyPoint({nullptr, end - normal * endDistance, normal, endDistance});
+        return endDistance;
+    }
+
+    Vector3 point;
+    if (distanceA <= 0.0f && distanceB <= 0.0f)
+    {
+        const Vector3 &end = distanceA > distanceB ? segment.a : segment.b;
+        point = end - normal * fmaxf(distanceA, distanceB);
+    }
+    else
+        point = segment.a + (segment.b - segment.a) * (distanceA / (distanceA - distanceB));
+
+    *closest = PhysicsBodyPoint({nullptr, point, normal, 0.0f});
+    return 0.0f;
+}
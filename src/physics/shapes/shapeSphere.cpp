@@ -84,6 +84,21 @@ int ShapeSphere::castRay(const Segment &ray, PhysicsBodyPoint *newPoints, Physic
     return 0;
 }
 
+float ShapeSphere::getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache)
+{
+    float radius = cache->sphere.radius;
+    Vector3 &center = cache->sphere.center;
+
+    Vector3 onSegment = segment.getClosestPoint(center);
+    Vector3 difference = onSegment - center;
+    float length = glm::length(difference);
+    Vector3 normal = length > 0.0f ? difference / length : Vector3(0.0f, 1.0f, 0.0f);
+    float distance = fmaxf(length - radius, 0.0f);
+
+    *closest = PhysicsBodyPoint({nullptr, center + normal * radius, normal, distance});
+    return distance;
+}
+
 /*
 void ShapeSphere::renderDebug(Matrix4 *projectionView, Matrix4 *model, float scale, float thickness)
 {
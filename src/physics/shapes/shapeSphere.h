@@ -13,11 +13,13 @@ class ShapeSphere : public Shape
 public:
     EXPORT ShapeSphere(const Vector3 &center, float radius, float density = 22.0f);
     inline float getRadius() { return radius; }
+    inline const Vector3 &getCenter() { return center; }
 
     EXPORT ShapeCollisionType getType() override final;
     EXPORT AABB getAABB(const Matrix4 &model) override final;
 
     EXPORT int castRay(const Segment &ray, PhysicsBodyPoint *newPoints, PhysicsBodyCache *cache) override final;
+    EXPORT float getSegmentDistance(const Segment &segment, PhysicsBodyPoint *closest, PhysicsBodyCache *cache) override final;
 
 protected:
     float radius;
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "scene.h"
+#include "red11.h"
 
 Scene::Scene(DebugEntities *debugEntities)
 {
@@ -34,13 +35,63 @@ void Scene::process(float delta)
 {
     physicsWorld.process(delta);
     for (auto actor = actors.begin(); actor != actors.end(); ++actor)
-        (*actor)->onProcess(delta);
+        (*actor)->process(delta);
+    processAnimations();
     cleanDestroyedActors();
 }
 
+void Scene::processAnimations()
+{
+    // Groups that are far or were out of view last frame don't evaluate their pose every frame
+    evaluatedGroups.clear();
+    for (auto &group : animatedGroups)
+    {
+        if (group->isEvaluatingPose())
+            evaluatedGroups.push_back(group);
+    }
+
+    int amount = (int)evaluatedGroups.size();
+    ComponentMeshGroup **groups = evaluatedGroups.data();
+    if (bParallelAnimation)
+    {
+        JobQueue *jobQueue = Red11::getJobQueue();
+        int chunks = jobQueue->getMaxJobs() * 4;
+        int grain = chunks > 0 ? amount / chunks + 1 : amount;
+        jobQueue->parallelFor(0, amount, grain, [groups](int start, int end)
+                              {
+                                  for (int i = start; i < end; i++)
+                                      groups[i]->evaluatePose(); });
+    }
+    else
+    {
+        for (int i = 0; i < amount; i++)
+            groups[i]->evaluatePose();
+    }
+
+    animationProfile = AnimationProfile();
+    animationProfile.groups = (int)animatedGroups.size();
+    animationProfile.evaluatedGroups = amount;
+    for (int i = 0; i < amount; i++)
+        animationProfile.evaluatedBones += groups[i]->getEvaluatedBones();
+
+    for (auto &group : animatedGroups)
+        group->commitPose();
+    animatedGroups.clear();
+}
+
+void Scene::updateAnimationCamera(Camera *camera)
+{
+    bHasAnimationCamera = true;
+    animationCameraPosition = Vector3((*camera->getWorldMatrix())[3]);
+    animationCameraView = *camera->getViewMatrix();
+    for (int i = 0; i < 6; i++)
+        animationCameraPlanes[i] = camera->getCullingPlanes()[i];
+}
+
 void Scene::render(Renderer *renderer, Camera *camera)
 {
     renderer->setAmbientLight(ambientLight);
+    updateAnimationCamera(camera);
 
     for (auto &actor : actors)
         actor->renderQueue(renderer);
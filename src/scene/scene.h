@@ -10,6 +10,13 @@
 #include "data/debugEntities.h"
 #include <string>
 
+struct AnimationProfile
+{
+    int groups = 0;
+    int evaluatedGroups = 0;
+    int evaluatedBones = 0;
+};
+
 class Scene
 {
 public:
@@ -39,6 +46,24 @@ public:
     EXPORT void process(float delta);
     EXPORT void render(Renderer *renderer, Camera *camera);
 
+    // Mesh groups that moved their tracks this frame, their poses are blended after all the actors were processed
+    inline void queueAnimation(ComponentMeshGroup *group) { animatedGroups.push_back(group); }
+
+    // Poses of animated groups are blended on all the threads of the job queue
+    inline void setParallelAnimation(bool bState) { bParallelAnimation = bState; }
+    inline bool isAnimatingInParallel() { return bParallelAnimation; }
+
+    // Camera of the last rendered frame, mesh groups pick their animation level of detail by distance to it
+    // Render updates it, scenes that are processed without rendering can set it themselves
+    EXPORT void updateAnimationCamera(Camera *camera);
+    inline bool hasAnimationCamera() { return bHasAnimationCamera; }
+    inline const Vector3 &getAnimationCameraPosition() { return animationCameraPosition; }
+    inline Matrix4 *getAnimationCameraView() { return &animationCameraView; }
+    inline const Vector4 *getAnimationCameraPlanes() { return animationCameraPlanes; }
+
+    // Mesh groups animated during the last process and how many of them and their bones had to be evaluated
+    inline const AnimationProfile &getAnimationProfile() { return animationProfile; }
+
     inline ActorTemporary *createTemporaryActor(float timeToExist)
     {
         ActorTemporary *actor = createActor<ActorTemporary>("DebugActor");
@@ -102,6 +127,12 @@ public:
         return castRayCollision(ray, channel, debug, debugTimeSeconds);
     }
 
+    // Many rays at once are cheaper than one by one, results are reused between calls
+    inline void castRays(const Segment *rays, int amount, RayCastResults *results, Channel channel = CHANNEL_RAY_PICK, RayCastMode mode = RayCastMode::FirstHit)
+    {
+        physicsWorld.castRays(rays, amount, channel, results, mode);
+    }
+
     inline std::vector<PhysicsBodyPoint> castSphereCollision(const Vector3 &p, float radius, Channel channel = CHANNEL_RAY_PICK, bool debug = false, float debugTimeSeconds = 3.0f)
     {
         return physicsWorld.castSphereCollision(p, radius, channel);
@@ -112,6 +143,22 @@ public:
         return physicsWorld.castPointCollision(p, channel);
     }
 
+    inline std::vector<PhysicsBodyPoint> castCapsuleCollision(const Vector3 &a, const Vector3 &b, float radius, Channel channel = CHANNEL_RAY_PICK)
+    {
+        return physicsWorld.castCapsuleCollision(a, b, radius, channel);
+    }
+
+    // Time of impact of a moving sphere or capsule, hit is filled only when true is returned
+    inline bool castSphereSweep(const Vector3 &from, const Vector3 &to, float radius, ShapeCastHit *hit, Channel channel = CHANNEL_RAY_PICK)
+    {
+        return physicsWorld.castSphereSweep(from, to, radius, channel, hit);
+    }
+
+    inline bool castCapsuleSweep(const Vector3 &a, const Vector3 &b, float radius, const Vector3 &translation, ShapeCastHit *hit, Channel channel = CHANNEL_RAY_PICK)
+    {
+        return physicsWorld.castCapsuleSweep(a, b, radius, translation, channel, hit);
+    }
+
     inline void setAmbientLight(const Color &color) { this->ambientLight = color; }
     inline Color getAmbientLight() { return ambientLight; };
 
@@ -123,8 +170,20 @@ public:
     EXPORT void cleanDestroyedActors();
 
 protected:
+    void processAnimations();
+
     std::list<Actor *> actors;
     Color ambientLight = Color(0.4f, 0.4f, 0.44f);
     PhysicsWorld physicsWorld;
     DebugEntities *debugEntities;
+
+    std::vector<ComponentMeshGroup *> animatedGroups;
+    std::vector<ComponentMeshGroup *> evaluatedGroups;
+    bool bParallelAnimation = true;
+    AnimationProfile animationProfile;
+
+    bool bHasAnimationCamera = false;
+    Vector3 animationCameraPosition = Vector3(0.0f);
+    Matrix4 animationCameraView = Matrix4(1.0f);
+    Vector4 animationCameraPlanes[6];
 };
\ No newline at end of file
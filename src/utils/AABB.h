@@ -4,6 +4,7 @@
 #pragma once
 #include "primitives.h"
 #include "segment.h"
+#include <cmath>
 
 class AABB
 {
@@ -36,6 +37,25 @@ public:
         return aabb.start.x < end.x && aabb.end.x > start.x && aabb.start.y < end.y && aabb.end.y > start.y && aabb.start.z < end.z && aabb.end.z > start.z;
     }
 
+    inline bool contains(const AABB &aabb) const
+    {
+        return start.x <= aabb.start.x && start.y <= aabb.start.y && start.z <= aabb.start.z && end.x >= aabb.end.x && end.y >= aabb.end.y && end.z >= aabb.end.z;
+    }
+
+    // Half of the surface area, good enough as a cost for tree building
+    inline float getSurfaceArea() const
+    {
+        Vector3 size = end - start;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    inline static AABB combine(const AABB &a, const AABB &b)
+    {
+        AABB out = a;
+        out.extend(b);
+        return out;
+    }
+
     inline bool test(const Segment &line) const
     {
         // Point p0, Point p1, AABB b
@@ -75,11 +95,29 @@ public:
         return true;
     }
 
+    // False if bounds were built from broken transformation
+    inline bool isFinite() const
+    {
+        return std::isfinite(start.x) && std::isfinite(start.y) && std::isfinite(start.z) &&
+               std::isfinite(end.x) && std::isfinite(end.y) && std::isfinite(end.z);
+    }
+
     inline Vector3 getCenter() const
     {
         return (start + end) / 2.0f;
     }
 
+    // Bounds of the box moved into another space, they hold the rotated box but may be bigger than it
+    inline AABB getTransformed(const Matrix4 &transformation) const
+    {
+        Vector3 center = Vector3(transformation * Vector4(getCenter(), 1.0f));
+        Vector3 extent = (end - start) * 0.5f;
+        Vector3 rotated = glm::abs(Vector3(transformation[0])) * extent.x +
+                          glm::abs(Vector3(transformation[1])) * extent.y +
+                          glm::abs(Vector3(transformation[2])) * extent.z;
+        return AABB(center - rotated, center + rotated);
+    }
+
     Vector3 start = Vector3(0.0f);
     Vector3 end = Vector3(0.0f);
 };
@@ -160,7 +160,7 @@ inline float getClosestPointSegmentSegment(const Vector3 &p1, const Vector3 &q1,
         c1 = p1;
         c2 = p2;
     }
-    if (a <= EPSILON)
+    else if (a <= EPSILON)
     {
         // First segment degenerates into a point
         s = 0.0f;
@@ -283,6 +283,161 @@ inline Vector3 getClosestPointOnPolygon(const Vector3 *verticies, const int amou
     return out;
 }
 
+// Point lying in the plane of a convex polygon is inside when it's on the same side of every edge
+// Works with both windings of the polygon
+inline bool isPointInsidePolygon(const Vector3 &point, const Vector3 *verticies, const HullPolygon &polygon, const Vector3 &normal)
+{
+    bool positive = false, negative = false;
+    for (int i = 0; i < polygon.pointsAmount; i++)
+    {
+        const Vector3 &v0 = verticies[polygon.points[i]];
+        const Vector3 &v1 = verticies[polygon.points[(i + 1) % polygon.pointsAmount]];
+        float side = glm::dot(glm::cross(v1 - v0, point - v0), normal);
+        positive |= side > 0.0f;
+        negative |= side < 0.0f;
+    }
+    return !(positive && negative);
+}
+
+// Separating axis test of two triangles, their faces and cross products of their edges are the axes
+// Normal goes from A to B and moving B by normal * depth separates them, false if they don't cross
+inline bool getTrianglesPenetration(const Vector3 *triA, const Vector3 *triB, Vector3 &normal, float &depth)
+{
+    Vector3 edgesA[3] = {triA[1] - triA[0], triA[2] - triA[1], triA[0] - triA[2]};
+    Vector3 edgesB[3] = {triB[1] - triB[0], triB[2] - triB[1], triB[0] - triB[2]};
+    Vector3 axes[11];
+    axes[0] = glm::cross(edgesA[0], edgesA[1]);
+    axes[1] = glm::cross(edgesB[0], edgesB[1]);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            axes[2 + i * 3 + j] = glm::cross(edgesA[i], edgesB[j]);
+
+    Vector3 direction = (triB[0] + triB[1] + triB[2]) - (triA[0] + triA[1] + triA[2]);
+    depth = FLT_MAX;
+    for (int i = 0; i < 11; i++)
+    {
+        // Parallel edges give no axis
+        float length = glm::length(axes[i]);
+        if (length < 0.000001f)
+            continue;
+        Vector3 axis = axes[i] / length;
+        if (glm::dot(axis, direction) < 0.0f)
+            axis = -axis;
+
+        float maxA = glm::dot(triA[0], axis), minB = glm::dot(triB[0], axis);
+        float minA = maxA, maxB = minB;
+        for (int v = 1; v < 3; v++)
+        {
+            float projectionA = glm::dot(triA[v], axis);
+            float projectionB = glm::dot(triB[v], axis);
+            minA = fminf(minA, projectionA);
+            maxA = fmaxf(maxA, projectionA);
+            minB = fminf(minB, projectionB);
+            maxB = fmaxf(maxB, projectionB);
+        }
+        if (maxA < minB || maxB < minA)
+            return false;
+
+        // Triangles are surfaces without inside, they get out through the shorter side
+        float overlap = maxA - minB;
+        if (maxB - minA < overlap)
+        {
+            overlap = maxB - minA;
+            axis = -axis;
+        }
+        if (overlap < depth)
+        {
+            depth = overlap;
+            normal = axis;
+        }
+    }
+    return depth < FLT_MAX;
+}
+
+// Closest points of segment a-b and a convex hull, segment can be a point when a equals b
+// Returns distance between them, 0 if the segment touches or crosses the hull
+// Normal points out of the hull, if the segment is inside it's the normal of the nearest face
+inline float getClosestPointsSegmentHull(const Vector3 &a, const Vector3 &b,
+                                         const Vector3 *verticies, const Vector3 *normals,
+                                         const HullPolygon *polygons, int polygonsAmount,
+                                         const HullEdge *edges, int edgesAmount,
+                                         Vector3 &onHull, Vector3 &onSegment, Vector3 &normal)
+{
+    // Part of the segment behind every face plane is inside the hull
+    Vector3 direction = b - a;
+    float tEnter = 0.0f, tExit = 1.0f;
+    for (int i = 0; i < polygonsAmount && tEnter <= tExit; i++)
+    {
+        float separation = glm::dot(normals[i], a - verticies[polygons[i].points[0]]);
+        float speed = glm::dot(normals[i], direction);
+        if (fabsf(speed) < 1e-12f)
+        {
+            if (separation > 0.0f)
+                tEnter = 2.0f;
+            continue;
+        }
+        float t = -separation / speed;
+        if (speed < 0.0f)
+            tEnter = fmaxf(tEnter, t);
+        else
+            tExit = fminf(tExit, t);
+    }
+
+    if (tEnter <= tExit)
+    {
+        onSegment = a + direction * ((tEnter + tExit) * 0.5f);
+        float maxSeparation = -FLT_MAX;
+        for (int i = 0; i < polygonsAmount; i++)
+        {
+            float separation = glm::dot(normals[i], onSegment - verticies[polygons[i].points[0]]);
+            if (separation > maxSeparation)
+            {
+                maxSeparation = separation;
+                normal = normals[i];
+            }
+        }
+        onHull = onSegment - normal * maxSeparation;
+        return 0.0f;
+    }
+
+    // Outside the closest feature is either a face in front of an end or an edge
+    float minDistance = FLT_MAX;
+    const Vector3 *ends[2] = {&a, &b};
+    for (int e = 0; e < 2; e++)
+    {
+        for (int i = 0; i < polygonsAmount; i++)
+        {
+            float separation = glm::dot(normals[i], *ends[e] - verticies[polygons[i].points[0]]);
+            if (separation <= 0.0f || separation >= minDistance)
+                continue;
+            Vector3 projected = *ends[e] - normals[i] * separation;
+            if (isPointInsidePolygon(projected, verticies, polygons[i], normals[i]))
+            {
+                minDistance = separation;
+                onHull = projected;
+                onSegment = *ends[e];
+                normal = normals[i];
+            }
+        }
+    }
+
+    // Edges go in pairs with their twins, so every second one is enough
+    float s, t;
+    Vector3 onEdge, onLine;
+    for (int i = 0; i < edgesAmount; i += 2)
+    {
+        float distance = sqrtf(getClosestPointSegmentSegment(verticies[edges[i].a], verticies[edges[i].b], a, b, s, t, onEdge, onLine));
+        if (distance < minDistance)
+        {
+            minDistance = distance;
+            onHull = onEdge;
+            onSegment = onLine;
+            normal = distance > 0.0f ? (onLine - onEdge) / distance : normals[edges[i].polygon];
+        }
+    }
+    return minDistance;
+}
+
 inline Vector3 lerp(const Vector3 &a, const Vector3 &b, float t)
 {
     return Vector3(a.x + (b.x - a.x) * t,
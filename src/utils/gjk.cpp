@@ -0,0 +1,494 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "gjk.h"
+#include <cfloat>
+#include <algorithm>
+
+// Search stops when the closest point moves less than this part of its distance
+#define GJK_RELATIVE_TOLERANCE 1.0e-6f
+// Closest point this close to the origin relative to the size of the difference counts as an overlap
+#define GJK_OVERLAP_TOLERANCE 1.0e-10f
+// Polytope stops growing when support point is not further than this part of the size from the closest face
+#define EPA_RELATIVE_TOLERANCE 1.0e-4f
+
+GJKStatus GJK::collide(const GJKShape &a, const GJKShape &b, Vector3 &axis, float margin, GJKResult *result)
+{
+    float radius = a.radius + b.radius;
+    float reach = radius + margin;
+
+    Vertex simplex[4];
+    float weights[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+    int size = 0;
+
+    // Closest point of the difference goes from B to A, so it starts opposite to the axis
+    Vector3 closest = glm::length2(axis) > 0.0f ? -axis : Vector3(-1.0f, 0.0f, 0.0f);
+    bool bOverlap = false;
+    int iteration = 0;
+    for (; iteration < GJK_MAX_ITERATIONS; iteration++)
+    {
+        float lengthSquared = glm::length2(closest);
+        Vertex vertex = getSupport(a, b, -closest);
+
+        // The whole difference lies beyond this plane, so shapes are at least that far apart
+        float projection = glm::dot(closest, vertex.w);
+        if (projection > 0.0f && projection * projection > lengthSquared * reach * reach)
+        {
+            axis = -closest / sqrtf(lengthSquared);
+            result->iterations = iteration + 1;
+            return GJKStatus::Separated;
+        }
+
+        if (size > 0)
+        {
+            if (lengthSquared - projection <= GJK_RELATIVE_TOLERANCE * lengthSquared)
+                break;
+
+            bool bRepeated = false;
+            for (int i = 0; i < size; i++)
+                bRepeated |= simplex[i].w == vertex.w;
+            if (bRepeated)
+                break;
+        }
+
+        simplex[size++] = vertex;
+        if (!solveSimplex(simplex, size, weights, closest))
+        {
+            bOverlap = true;
+            break;
+        }
+
+        float maxLengthSquared = 0.0f;
+        for (int i = 0; i < size; i++)
+            maxLengthSquared = fmaxf(maxLengthSquared, glm::length2(simplex[i].w));
+        if (glm::length2(closest) <= GJK_OVERLAP_TOLERANCE * maxLengthSquared)
+        {
+            bOverlap = true;
+            break;
+        }
+    }
+    result->iterations = iteration + 1;
+
+    if (!bOverlap)
+    {
+        float distance = glm::length(closest);
+        Vector3 normal = -closest / distance;
+        axis = normal;
+        if (distance > reach)
+            return GJKStatus::Separated;
+
+        Vector3 coreA(0.0f), coreB(0.0f);
+        for (int i = 0; i < size; i++)
+        {
+            coreA += simplex[i].a * weights[i];
+            coreB += simplex[i].b * weights[i];
+        }
+        result->normal = normal;
+        result->depth = radius - distance;
+        result->pointOnA = coreA + normal * a.radius;
+        result->pointOnB = coreB - normal * b.radius;
+        return GJKStatus::Touching;
+    }
+
+    // Cores overlap, only the polytope can tell how deep
+    if (!expandPolytope(a, b, simplex, size, result))
+        return GJKStatus::Failed;
+
+    result->depth += radius;
+    result->pointOnA += result->normal * a.radius;
+    result->pointOnB -= result->normal * b.radius;
+    axis = result->normal;
+    return GJKStatus::Touching;
+}
+
+bool GJK::solveSimplex(Vertex *simplex, int &size, float *weights, Vector3 &closest)
+{
+    switch (size)
+    {
+    case 1:
+        weights[0] = 1.0f;
+        closest = simplex[0].w;
+        return true;
+    case 2:
+        solveSegment(simplex, size, weights, closest);
+        return true;
+    case 3:
+        solveTriangle(simplex, size, weights, closest);
+        return true;
+    default:
+        return solveTetrahedron(simplex, size, weights, closest);
+    }
+}
+
+void GJK::solveSegment(Vertex *simplex, int &size, float *weights, Vector3 &closest)
+{
+    Vector3 ab = simplex[1].w - simplex[0].w;
+    float lengthSquared = glm::length2(ab);
+    float t = lengthSquared > 0.0f ? -glm::dot(simplex[0].w, ab) / lengthSquared : 0.0f;
+    if (t <= 0.0f)
+    {
+        size = 1;
+        weights[0] = 1.0f;
+        closest = simplex[0].w;
+    }
+    else if (t >= 1.0f)
+    {
+        simplex[0] = simplex[1];
+        size = 1;
+        weights[0] = 1.0f;
+        closest = simplex[0].w;
+    }
+    else
+    {
+        weights[0] = 1.0f - t;
+        weights[1] = t;
+        closest = simplex[0].w + ab * t;
+    }
+}
+
+// Voronoi regions of the triangle for the origin
+// Christer Ericson - Real-Time Collision Detection, 5.1.5
+void GJK::solveTriangle(Vertex *simplex, int &size, float *weights, Vector3 &closest)
+{
+    const Vector3 &a = simplex[0].w;
+    const Vector3 &b = simplex[1].w;
+    const Vector3 &c = simplex[2].w;
+    Vector3 ab = b - a;
+    Vector3 ac = c - a;
+
+    float d1 = -glm::dot(ab, a);
+    float d2 = -glm::dot(ac, a);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        size = 1;
+        weights[0] = 1.0f;
+        closest = a;
+        return;
+    }
+
+    float d3 = -glm::dot(ab, b);
+    float d4 = -glm::dot(ac, b);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        simplex[0] = simplex[1];
+        size = 1;
+        weights[0] = 1.0f;
+        closest = simplex[0].w;
+        return;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        float t = d1 / (d1 - d3);
+        closest = a + ab * t;
+        size = 2;
+        weights[0] = 1.0f - t;
+        weights[1] = t;
+        return;
+    }
+
+    float d5 = -glm::dot(ab, c);
+    float d6 = -glm::dot(ac, c);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        simplex[0] = simplex[2];
+        size = 1;
+        weights[0] = 1.0f;
+        closest = simplex[0].w;
+        return;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        float t = d2 / (d2 - d6);
+        closest = a + ac * t;
+        simplex[1] = simplex[2];
+        size = 2;
+        weights[0] = 1.0f - t;
+        weights[1] = t;
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        closest = b + (c - b) * t;
+        simplex[0] = simplex[1];
+        simplex[1] = simplex[2];
+        size = 2;
+        weights[0] = 1.0f - t;
+        weights[1] = t;
+        return;
+    }
+
+    float denominator = 1.0f / (va + vb + vc);
+    float v = vb * denominator;
+    float w = vc * denominator;
+    closest = a + ab * v + ac * w;
+    weights[0] = 1.0f - v - w;
+    weights[1] = v;
+    weights[2] = w;
+}
+
+// Closest point is on one of the faces that have the origin on their outer side
+bool GJK::solveTetrahedron(Vertex *simplex, int &size, float *weights, Vector3 &closest)
+{
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+
+    float bestDistance = FLT_MAX;
+    Vertex best[3];
+    float bestWeights[3];
+    int bestSize = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        const Vector3 &a = simplex[faces[i][0]].w;
+        Vector3 normal = glm::cross(simplex[faces[i][1]].w - a, simplex[faces[i][2]].w - a);
+        float originSide = -glm::dot(normal, a);
+        float vertexSide = glm::dot(normal, simplex[faces[i][3]].w - a);
+
+        // Flat tetrahedron has no inner side, every face is tested then
+        if (originSide * vertexSide < 0.0f || fabsf(vertexSide) <= GJK_RELATIVE_TOLERANCE * glm::length(normal) * glm::length(simplex[faces[i][3]].w - a))
+        {
+            Vertex triangle[3] = {simplex[faces[i][0]], simplex[faces[i][1]], simplex[faces[i][2]]};
+            float triangleWeights[3];
+            int triangleSize = 3;
+            Vector3 point;
+            solveTriangle(triangle, triangleSize, triangleWeights, point);
+            float distance = glm::length2(point);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestSize = triangleSize;
+                closest = point;
+                for (int j = 0; j < triangleSize; j++)
+                {
+                    best[j] = triangle[j];
+                    bestWeights[j] = triangleWeights[j];
+                }
+            }
+        }
+    }
+
+    if (bestSize == 0)
+        return false;
+
+    size = bestSize;
+    for (int i = 0; i < bestSize; i++)
+    {
+        simplex[i] = best[i];
+        weights[i] = bestWeights[i];
+    }
+    return true;
+}
+
+struct EPAFace
+{
+    int a, b, c;
+    Vector3 normal;
+    float distance;
+    bool bRemoved;
+};
+
+inline EPAFace _makeEPAFace(const Vector3 *points, int a, int b, int c)
+{
+    EPAFace face = {a, b, c, Vector3(0.0f), FLT_MAX, false};
+    Vector3 normal = glm::cross(points[b] - points[a], points[c] - points[a]);
+    float length = glm::length(normal);
+
+    // Degenerate face is never the closest and never seen from new points
+    if (length > 0.0f)
+    {
+        face.normal = normal / length;
+        face.distance = glm::dot(face.normal, points[a]);
+    }
+    return face;
+}
+
+bool GJK::expandPolytope(const GJKShape &a, const GJKShape &b, Vertex *simplex, int size, GJKResult *result)
+{
+    Vertex verticies[EPA_MAX_VERTICIES];
+    Vector3 points[EPA_MAX_VERTICIES];
+    int verticiesAmount = size;
+    for (int i = 0; i < size; i++)
+        verticies[i] = simplex[i];
+
+    float scale = 0.0f;
+    for (int i = 0; i < size; i++)
+        scale = fmaxf(scale, glm::length(simplex[i].w));
+    float tolerance = EPA_RELATIVE_TOLERANCE * fmaxf(scale, 1.0e-6f);
+
+    // GJK may stop on a point, segment or triangle touching the origin, it's grown into a tetrahedron
+    static const Vector3 axes[6] = {Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)};
+    if (verticiesAmount == 1)
+    {
+        for (int i = 0; i < 6 && verticiesAmount == 1; i++)
+        {
+            Vertex vertex = getSupport(a, b, axes[i]);
+            if (glm::length(vertex.w - verticies[0].w) > tolerance)
+                verticies[verticiesAmount++] = vertex;
+        }
+    }
+    if (verticiesAmount == 2)
+    {
+        Vector3 line = glm::normalize(verticies[1].w - verticies[0].w);
+        Vector3 side = fabsf(line.x) < 0.57f ? Vector3(1, 0, 0) : (fabsf(line.y) < 0.57f ? Vector3(0, 1, 0) : Vector3(0, 0, 1));
+        Vector3 first = glm::normalize(glm::cross(line, side));
+        Vector3 second = glm::cross(line, first);
+        Vector3 directions[4] = {first, -first, second, -second};
+        for (int i = 0; i < 4 && verticiesAmount == 2; i++)
+        {
+            Vertex vertex = getSupport(a, b, directions[i]);
+            Vector3 offset = vertex.w - verticies[0].w;
+            if (glm::length(offset - line * glm::dot(offset, line)) > tolerance)
+                verticies[verticiesAmount++] = vertex;
+        }
+    }
+    if (verticiesAmount == 3)
+    {
+        Vector3 normal = glm::normalize(glm::cross(verticies[1].w - verticies[0].w, verticies[2].w - verticies[0].w));
+        Vertex vertex = getSupport(a, b, normal);
+        if (fabsf(glm::dot(normal, vertex.w - verticies[0].w)) <= tolerance)
+            vertex = getSupport(a, b, -normal);
+        if (fabsf(glm::dot(normal, vertex.w - verticies[0].w)) > tolerance)
+            verticies[verticiesAmount++] = vertex;
+    }
+    if (verticiesAmount < 4)
+        return false;
+
+    // Faces are wound so their normals look outside
+    float volume = glm::dot(glm::cross(verticies[1].w - verticies[0].w, verticies[2].w - verticies[0].w), verticies[3].w - verticies[0].w);
+    if (fabsf(volume) <= tolerance * tolerance * tolerance)
+        return false;
+    if (volume > 0.0f)
+        std::swap(verticies[1], verticies[2]);
+    for (int i = 0; i < 4; i++)
+        points[i] = verticies[i].w;
+
+    EPAFace faces[EPA_MAX_FACES];
+    int facesAmount = 0;
+    faces[facesAmount++] = _makeEPAFace(points, 0, 1, 2);
+    faces[facesAmount++] = _makeEPAFace(points, 0, 3, 1);
+    faces[facesAmount++] = _makeEPAFace(points, 0, 2, 3);
+    faces[facesAmount++] = _makeEPAFace(points, 1, 3, 2);
+
+    int horizon[EPA_MAX_FACES][2];
+    int closestFace = -1;
+    for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++)
+    {
+        closestFace = -1;
+        float closestDistance = FLT_MAX;
+        for (int i = 0; i < facesAmount; i++)
+        {
+            if (faces[i].distance < closestDistance)
+            {
+                closestDistance = faces[i].distance;
+                closestFace = i;
+            }
+        }
+        if (closestFace == -1)
+            return false;
+
+        Vector3 normal = faces[closestFace].normal;
+        Vertex vertex = getSupport(a, b, normal);
+        if (glm::dot(normal, vertex.w) - closestDistance <= tolerance || verticiesAmount == EPA_MAX_VERTICIES)
+            break;
+
+        int newVertex = verticiesAmount++;
+        verticies[newVertex] = vertex;
+        points[newVertex] = vertex.w;
+
+        // Faces the new point sees are removed, edges they share only with kept faces make the horizon
+        int horizonAmount = 0;
+        for (int i = 0; i < facesAmount; i++)
+        {
+            EPAFace &face = faces[i];
+            if (glm::dot(face.normal, vertex.w - points[face.a]) <= 0.0f)
+                continue;
+            face.bRemoved = true;
+
+            int edges[3][2] = {{face.a, face.b}, {face.b, face.c}, {face.c, face.a}};
+            for (auto &edge : edges)
+            {
+                bool bShared = false;
+                for (int j = 0; j < horizonAmount; j++)
+                {
+                    if (horizon[j][0] == edge[1] && horizon[j][1] == edge[0])
+                    {
+                        horizonAmount--;
+                        horizon[j][0] = horizon[horizonAmount][0];
+                        horizon[j][1] = horizon[horizonAmount][1];
+                        bShared = true;
+                        break;
+                    }
+                }
+                if (!bShared)
+                {
+                    if (horizonAmount == EPA_MAX_FACES)
+                        return false;
+                    horizon[horizonAmount][0] = edge[0];
+                    horizon[horizonAmount][1] = edge[1];
+                    horizonAmount++;
+                }
+            }
+        }
+
+        int kept = 0;
+        for (int i = 0; i < facesAmount; i++)
+        {
+            if (!faces[i].bRemoved)
+                faces[kept++] = faces[i];
+        }
+        facesAmount = kept;
+
+        if (facesAmount + horizonAmount > EPA_MAX_FACES)
+            return false;
+        for (int i = 0; i < horizonAmount; i++)
+            faces[facesAmount++] = _makeEPAFace(points, horizon[i][0], horizon[i][1], newVertex);
+        closestFace = -1;
+    }
+
+    // Out of iterations, the closest face so far is the answer
+    if (closestFace == -1)
+    {
+        float closestDistance = FLT_MAX;
+        for (int i = 0; i < facesAmount; i++)
+        {
+            if (faces[i].distance < closestDistance)
+            {
+                closestDistance = faces[i].distance;
+                closestFace = i;
+            }
+        }
+        if (closestFace == -1)
+            return false;
+    }
+
+    // Projection of the origin onto the closest face gives weights for points of the shapes
+    const EPAFace &face = faces[closestFace];
+    Vector3 projection = face.normal * face.distance;
+    Vector3 v0 = points[face.b] - points[face.a];
+    Vector3 v1 = points[face.c] - points[face.a];
+    Vector3 v2 = projection - points[face.a];
+    float d00 = glm::dot(v0, v0);
+    float d01 = glm::dot(v0, v1);
+    float d11 = glm::dot(v1, v1);
+    float d20 = glm::dot(v2, v0);
+    float d21 = glm::dot(v2, v1);
+    float denominator = d00 * d11 - d01 * d01;
+    float v = 0.0f, w = 0.0f;
+    if (denominator > 0.0f)
+    {
+        v = (d11 * d20 - d01 * d21) / denominator;
+        w = (d00 * d21 - d01 * d20) / denominator;
+    }
+    float u = 1.0f - v - w;
+
+    result->normal = face.normal;
+    result->depth = face.distance;
+    result->pointOnA = verticies[face.a].a * u + verticies[face.b].a * v + verticies[face.c].a * w;
+    result->pointOnB = verticies[face.a].b * u + verticies[face.b].b * v + verticies[face.c].b * w;
+    return true;
+}
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "utils/math.h"
+
+#define GJK_MAX_ITERATIONS 32
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_VERTICIES 128
+#define EPA_MAX_FACES 256
+
+// Convex shape given as points swept by a sphere: one point for spheres, two for capsules, all verticies for hulls
+struct GJKShape
+{
+    const Vector3 *points;
+    int pointsAmount;
+    float radius;
+
+    // Furthest point in the direction, radius is not included
+    inline const Vector3 &getSupport(const Vector3 &direction) const
+    {
+        int best = 0;
+        float bestDistance = glm::dot(points[0], direction);
+        for (int i = 1; i < pointsAmount; i++)
+        {
+            float distance = glm::dot(points[i], direction);
+            if (distance > bestDistance)
+            {
+                best = i;
+                bestDistance = distance;
+            }
+        }
+        return points[best];
+    }
+};
+
+enum class GJKStatus
+{
+    Separated, // Shapes are further apart than the margin
+    Touching,  // Result is filled
+    Failed,    // Polytope expansion broke on a degenerate case, caller should use another test
+};
+
+struct GJKResult
+{
+    // Direction from A to B, moving B by normal * depth separates shapes
+    Vector3 normal;
+
+    // Negative when shapes don't overlap, then it's the distance between them
+    float depth;
+
+    // Deepest or closest points on surfaces of the shapes
+    Vector3 pointOnA;
+    Vector3 pointOnB;
+
+    int iterations;
+};
+
+// Distance and penetration of convex shapes through support points of their Minkowski difference
+// Gino van den Bergen - A Fast and Robust GJK Implementation for Collision Detection of Convex Objects
+// Expanding polytope for penetration - Gino van den Bergen, Proximity Queries and Penetration Depth Computation on 3D Game Objects
+class GJK
+{
+public:
+    // Axis is the direction from A to B the search starts from, it gets the one the search ended with
+    // Passing the axis of the previous step makes resting and separated pairs finish in one or two iterations
+    static GJKStatus collide(const GJKShape &a, const GJKShape &b, Vector3 &axis, float margin, GJKResult *result);
+
+protected:
+    struct Vertex
+    {
+        // Point of the difference and the points of shapes it was made of
+        Vector3 w;
+        Vector3 a;
+        Vector3 b;
+    };
+
+    static inline Vertex getSupport(const GJKShape &a, const GJKShape &b, const Vector3 &direction)
+    {
+        Vertex vertex;
+        vertex.a = a.getSupport(direction);
+        vertex.b = b.getSupport(-direction);
+        vertex.w = vertex.a - vertex.b;
+        return vertex;
+    }
+
+    // Reduces simplex to the smallest part that holds the point closest to the origin and returns that point
+    // Barycentric weights of the kept verticies go into weights, false when the origin is inside the tetrahedron
+    static bool solveSimplex(Vertex *simplex, int &size, float *weights, Vector3 &closest);
+    static void solveSegment(Vertex *simplex, int &size, float *weights, Vector3 &closest);
+    static void solveTriangle(Vertex *simplex, int &size, float *weights, Vector3 &closest);
+    static bool solveTetrahedron(Vertex *simplex, int &size, float *weights, Vector3 &closest);
+
+    // Penetration of cores whose difference contains the origin, simplex is the last one GJK had
+    static bool expandPolytope(const GJKShape &a, const GJKShape &b, Vertex *simplex, int size, GJKResult *result);
+};
@@ -64,7 +64,8 @@ int HullCliping::clipFaceAgainstHull(
     const float minDist,
     const float maxDist,
     Vector4 *contactsOut,
-    int contactCapacity)
+    int contactCapacity,
+    int *faceA)
 {
     int numContactsOut = 0;
     int numVertsIn = mutVerticiesAmount;
@@ -89,6 +90,8 @@ int HullCliping::clipFaceAgainstHull(
 
     if (closestFaceA == nullptr)
         return numContactsOut;
+    if (faceA)
+        *faceA = (int)(closestFaceA - polygonsA);
 
     int numVerticesA = closestFaceA->pointsAmount;
     for (int e0 = 0; e0 < numVerticesA; e0++)
@@ -154,7 +157,8 @@ int HullCliping::clipHullAgainstHull(const Vector3 &separatingNormal,
                                      const float minDist,
                                      float maxDist,
                                      Vector4 *contactsOut,
-                                     int contactCapacity)
+                                     int contactCapacity,
+                                     int *faces)
 {
     int numContactsOut = 0;
     const HullPolygon *closestFaceB = nullptr;
@@ -177,6 +181,8 @@ int HullCliping::clipHullAgainstHull(const Vector3 &separatingNormal,
         int mutVerticiesAmount = closestFaceB->pointsAmount;
         for (int i = 0; i < mutVerticiesAmount; i++)
             mutVerticies[i] = verticiesB[closestFaceB->points[i]];
+        if (faces)
+            faces[1] = (int)(closestFaceB - polygonsB);
 
         numContactsOut = clipFaceAgainstHull(separatingNormal,
                                              polygonsA,
@@ -189,7 +195,8 @@ int HullCliping::clipHullAgainstHull(const Vector3 &separatingNormal,
                                              minDist,
                                              maxDist,
                                              contactsOut,
-                                             contactCapacity);
+                                             contactCapacity,
+                                             faces);
     }
 
     return numContactsOut;
@@ -214,6 +221,7 @@ void HullCliping::clipHullAgainstHull(
 
     const float minDist = -1.0f;
     const float maxDist = 0.0f;
+    int faces[2] = {-1, -1};
 
     int numContactsOut = clipHullAgainstHull(
         sepNormal,
@@ -230,7 +238,8 @@ void HullCliping::clipHullAgainstHull(
         minDist,
         maxDist,
         contactsOut,
-        contactCapacity);
+        contactCapacity,
+        faces);
 
     if (numContactsOut > 0)
     {
@@ -246,7 +255,7 @@ void HullCliping::clipHullAgainstHull(
             depth = fminf(contactsOut[contacts4[p]].w, depth);
             middle += Vector3(contactsOut[contacts4[p]]) / (float)numPoints;
         }
-        manifold->addCollisionPoint(middle, middle, -depth, normalOnSurfaceB);
+        manifold->addCollisionPoint(middle, middle, -depth, normalOnSurfaceB, makeContactFeature(faces[0], faces[1]));
     }
 }
 
@@ -270,6 +279,7 @@ void HullCliping::clipHullAgainstHullWithPostTransformation(
 
     const float minDist = -1.0f;
     const float maxDist = 0.0f;
+    int faces[2] = {-1, -1};
 
     int numContactsOut = clipHullAgainstHull(
         sepNormal,
@@ -286,7 +296,8 @@ void HullCliping::clipHullAgainstHullWithPostTransformation(
         minDist,
         maxDist,
         contactsOut,
-        contactCapacity);
+        contactCapacity,
+        faces);
 
     if (numContactsOut > 0)
     {
@@ -313,6 +324,6 @@ void HullCliping::clipHullAgainstHullWithPostTransformation(
 
         Vector3 normal = glm::normalize(rotationScaleMatrix * normalOnSurfaceB);
 
-        manifold->addCollisionPoint(middle, middle, -depth * scale, normal);
+        manifold->addCollisionPoint(middle, middle, -depth * scale, normal, makeContactFeature(faces[0], faces[1]));
     }
 }
\ No newline at end of file
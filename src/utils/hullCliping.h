@@ -23,8 +23,10 @@ public:
         const float minDist,
         const float maxDist,
         Vector4 *contactsOut,
-        int contactCapacity);
+        int contactCapacity,
+        int *faceA = nullptr);
 
+    // Faces gets indices of the reference face of A and the incident face of B the contacts came from
     static int clipHullAgainstHull(const Vector3 &separatingNormal,
                                    HullPolygon *polygonsA,
                                    int polygonsAmountA,
@@ -39,7 +41,8 @@ public:
                                    const float minDist,
                                    float maxDist,
                                    Vector4 *contactsOut,
-                                   int contactCapacity);
+                                   int contactCapacity,
+                                   int *faces = nullptr);
 
     static void clipHullAgainstHull(
         Vector3 sepNormal,
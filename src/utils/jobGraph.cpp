@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#include "jobGraph.h"
+#include <chrono>
+
+JobGraph::JobGraph()
+{
+}
+
+JobGraph::~JobGraph()
+{
+    clear();
+}
+
+void JobGraph::addDependency(int node, int dependsOn)
+{
+    nodes[dependsOn]->successors.push_back(node);
+    nodes[node]->dependencies++;
+}
+
+void JobGraph::clear()
+{
+    for (auto &node : nodes)
+        delete node;
+    nodes.clear();
+}
+
+void JobGraph::run(JobQueue *jobQueue)
+{
+    if (nodes.empty())
+        return;
+
+    this->jobQueue = jobQueue;
+    nodesLeft = nodes.size();
+    for (auto &node : nodes)
+    {
+        node->waitingFor = node->dependencies;
+        node->time = 0;
+    }
+
+    for (auto &node : nodes)
+    {
+        if (node->dependencies == 0)
+            startNode(node);
+    }
+    jobQueue->wait(&nodesLeft);
+}
+
+void JobGraph::invokeNode(const void *function, int start, int end)
+{
+    JobGraphNode *node = (JobGraphNode *)function;
+    auto since = std::chrono::high_resolution_clock::now();
+    for (int i = start; i < end; i++)
+        node->function(i);
+    node->time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - since).count();
+}
+
+void JobGraph::finishNode(JobTask *task)
+{
+    JobGraphNode *node = (JobGraphNode *)task->context;
+    JobGraph *graph = node->graph;
+    for (int successor : node->successors)
+    {
+        JobGraphNode *next = graph->nodes[successor];
+        if (next->waitingFor.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            graph->startNode(next);
+    }
+
+    // Successors are already counted, so the graph can't be considered done before they finish
+    graph->nodesLeft.fetch_sub(1, std::memory_order_release);
+}
+
+void JobGraph::startNode(JobGraphNode *node)
+{
+    node->task.invoke = invokeNode;
+    node->task.function = node;
+    node->task.finish = finishNode;
+    node->task.context = node;
+    jobQueue->submit(&node->task, 0, node->chunksAmount, 1);
+}
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "utils/utils.h"
+#include "jobQueue.h"
+#include <functional>
+#include <vector>
+#include <atomic>
+
+struct JobGraphNode
+{
+    // Called once for every chunk index
+    std::function<void(int chunk)> function;
+    int chunksAmount;
+
+    std::vector<int> successors;
+    int dependencies = 0;
+
+    // Refilled on every run
+    std::atomic<int> waitingFor;
+    std::atomic<long long> time;
+    JobTask task;
+    JobGraph *graph;
+};
+
+// Nodes that start as soon as the nodes they depend on are done, instead of waiting for every job to finish
+// Graph is meant to be built once and run many times, running it doesn't allocate
+class JobGraph
+{
+public:
+    EXPORT JobGraph();
+    EXPORT ~JobGraph();
+
+    // Node calls function(chunk) for every chunk in [0, chunksAmount), chunks of one node run in parallel
+    // Returns node index used to set up dependencies
+    template <typename T>
+    inline int addNode(int chunksAmount, const T &function)
+    {
+        JobGraphNode *node = new JobGraphNode();
+        node->function = function;
+        node->chunksAmount = chunksAmount > 1 ? chunksAmount : 1;
+        node->graph = this;
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    // Node won't start until the other one is done
+    EXPORT void addDependency(int node, int dependsOn);
+
+    EXPORT void clear();
+
+    // Runs the graph, calling thread executes chunks too and returns when every node is done
+    EXPORT void run(JobQueue *jobQueue);
+
+    inline int getNodesAmount() { return nodes.size(); }
+
+    // Milliseconds spent in node chunks during the last run, summed over all threads
+    inline float getNodeTime(int node) { return (float)nodes[node]->time.load() / 1000000.0f; }
+
+protected:
+    static void invokeNode(const void *function, int start, int end);
+    static void finishNode(JobTask *task);
+
+    void startNode(JobGraphNode *node);
+
+    std::vector<JobGraphNode *> nodes;
+    JobQueue *jobQueue = nullptr;
+    std::atomic<int> nodesLeft = 0;
+};
@@ -3,41 +3,149 @@
 
 #include "jobQueue.h"
 
+// Deque of the worker running on this thread, threads outside of the pool use the shared one
+thread_local JobQueue *currentQueue = nullptr;
+thread_local int currentDeque = -1;
+
 JobQueue::JobQueue()
 {
     const uint32_t num_threads = std::thread::hardware_concurrency() - 1;
+    deques = std::vector<JobDeque>(num_threads + 1);
     for (uint32_t i = 0; i < num_threads; ++i)
     {
-        threads.emplace_back(std::thread(&JobQueue::threadLoop, this));
+        threads.emplace_back(std::thread(&JobQueue::threadLoop, this, i));
+    }
+}
+
+JobQueue::~JobQueue()
+{
+    stop();
+}
+
+void JobQueue::submit(JobTask *task, int begin, int end, int grain)
+{
+    int chunksAmount = (end - begin + grain - 1) / grain;
+    task->remaining = chunksAmount;
+
+    // Counted before chunks become visible, so pending never drops below the real amount
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        pending += chunksAmount;
+    }
+
+    // Chunks are spread between all deques so workers rarely have to steal at the start
+    int dequesAmount = deques.size();
+    int dequeIndex = getDequeIndex();
+    for (int i = 0; i < dequesAmount; i++)
+    {
+        JobDeque &deque = deques[(dequeIndex + i) % dequesAmount];
+        std::unique_lock<std::mutex> lock(deque.lock);
+        for (int c = i; c < chunksAmount; c += dequesAmount)
+        {
+            int start = begin + c * grain;
+            deque.chunks.push_back({task, start, start + grain < end ? start + grain : end});
+        }
+    }
+
+    sleepCondition.notify_all();
+    doneCondition.notify_all();
+}
+
+void JobQueue::wait(const std::atomic<int> *counter)
+{
+    int dequeIndex = getDequeIndex();
+    JobChunk chunk;
+    while (counter->load(std::memory_order_acquire) > 0)
+    {
+        if (takeChunk(dequeIndex, &chunk))
+        {
+            runChunk(chunk);
+            continue;
+        }
+
+        // Nothing to help with, sleeps until the last chunk of some task is done or new chunks come
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        doneCondition.wait(lock, [this, counter]
+                           { return counter->load(std::memory_order_acquire) <= 0 || pending > 0; });
     }
 }
 
-void JobQueue::queueJob(const std::function<void()> &job)
+bool JobQueue::takeChunk(int dequeIndex, JobChunk *chunk)
 {
+    if (pending.load(std::memory_order_relaxed) <= 0)
+        return false;
+
+    // Own chunks are taken from the back, most recent ones are the most likely to be in cache
+    {
+        JobDeque &deque = deques[dequeIndex];
+        std::unique_lock<std::mutex> lock(deque.lock);
+        if (deque.head < (int)deque.chunks.size())
+        {
+            *chunk = deque.chunks.back();
+            deque.chunks.pop_back();
+            if (deque.head == (int)deque.chunks.size())
+            {
+                deque.chunks.clear();
+                deque.head = 0;
+            }
+            pending--;
+            return true;
+        }
+    }
+
+    // Steal the oldest chunk of someone else
+    int dequesAmount = deques.size();
+    for (int i = 1; i < dequesAmount; i++)
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        jobs.push(job);
+        JobDeque &deque = deques[(dequeIndex + i) % dequesAmount];
+        std::unique_lock<std::mutex> lock(deque.lock);
+        if (deque.head < (int)deque.chunks.size())
+        {
+            *chunk = deque.chunks[deque.head++];
+            if (deque.head == (int)deque.chunks.size())
+            {
+                deque.chunks.clear();
+                deque.head = 0;
+            }
+            pending--;
+            return true;
+        }
     }
-    mutex_condition.notify_one();
+    return false;
 }
 
-bool JobQueue::isBusy()
+void JobQueue::runChunk(const JobChunk &chunk)
 {
-    bool poolbusy;
+    JobTask *task = chunk.task;
+    task->invoke(task->function, chunk.start, chunk.end);
+
+    // Task may be gone right after this if it has no finish callback, submitting thread is waiting for it
+    auto finish = task->finish;
+    if (task->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        poolbusy = !jobs.empty() || inProgress != 0;
+        if (finish)
+            finish(task);
+
+        // Locked, so a waiter can't miss it between checking its counter and going to sleep
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        doneCondition.notify_all();
     }
-    return poolbusy;
+}
+
+int JobQueue::getDequeIndex()
+{
+    if (currentQueue == this)
+        return currentDeque;
+    return deques.size() - 1;
 }
 
 void JobQueue::stop()
 {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        should_terminate = true;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        bShouldTerminate = true;
     }
-    mutex_condition.notify_all();
+    sleepCondition.notify_all();
     for (std::thread &active_thread : threads)
     {
         active_thread.join();
@@ -45,24 +153,26 @@ void JobQueue::stop()
     threads.clear();
 }
 
-void JobQueue::threadLoop()
+void JobQueue::threadLoop(int index)
 {
+    currentQueue = this;
+    currentDeque = index;
+
+    JobChunk chunk;
     while (true)
     {
-        std::function<void()> job;
+        if (takeChunk(index, &chunk))
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            mutex_condition.wait(lock, [this]
-                                 { return !jobs.empty() || should_terminate; });
-            if (should_terminate)
-            {
-                return;
-            }
-            inProgress++;
-            job = jobs.front();
-            jobs.pop();
+            runChunk(chunk);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this]
+                            { return pending > 0 || bShouldTerminate; });
+        if (bShouldTerminate)
+        {
+            return;
         }
-        job();
-        inProgress--;
     }
-}
\ No newline at end of file
+}
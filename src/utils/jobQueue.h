@@ -7,28 +7,96 @@
 #include <mutex>
 #include <thread>
 #include <vector>
-#include <functional>
-#include <queue>
+#include <atomic>
+#include <condition_variable>
+
+class JobGraph;
+
+// Work submitted by a single parallelFor call or graph node, lives on the side of whoever submitted it
+struct JobTask
+{
+    void (*invoke)(const void *function, int start, int end);
+    const void *function;
+
+    // Called by the thread that finished the last chunk
+    void (*finish)(JobTask *task) = nullptr;
+    void *context = nullptr;
+
+    // Chunks left to finish, submitting thread returns when it reaches zero
+    std::atomic<int> remaining;
+};
+
+struct JobChunk
+{
+    JobTask *task;
+    int start;
+    int end;
+};
+
+// Chunks of a single thread, owner takes from the back, other threads steal from the front
+struct JobDeque
+{
+    std::mutex lock;
+    std::vector<JobChunk> chunks;
+    int head = 0;
+};
 
 class JobQueue
 {
 public:
     EXPORT JobQueue();
+    EXPORT ~JobQueue();
+
+    // Calls function(start, end) for chunks of [begin, end) that are no longer than grain
+    // Returns when all the chunks are done, calling thread executes chunks too instead of waiting idle
+    template <typename T>
+    inline void parallelFor(int begin, int end, int grain, const T &function)
+    {
+        if (end <= begin)
+            return;
+        if (grain < 1)
+            grain = 1;
+
+        if (threads.empty() || end - begin <= grain)
+        {
+            function(begin, end);
+            return;
+        }
 
-    EXPORT void queueJob(const std::function<void()> &job);
-    EXPORT bool isBusy();
+        JobTask task;
+        task.invoke = [](const void *function, int start, int end)
+        { (*(const T *)function)(start, end); };
+        task.function = &function;
+        submit(&task, begin, end, grain);
+        wait(&task.remaining);
+    }
 
     inline int getMaxJobs() { return threads.size(); }
 
 private:
+    friend class JobGraph;
+
+    EXPORT void submit(JobTask *task, int begin, int end, int grain);
+
+    // Executes chunks until counter reaches zero, sleeps when there are none left to take
+    // Counter has to reach zero in finish of some task, that is when waiters are woken
+    EXPORT void wait(const std::atomic<int> *counter);
+
+    bool takeChunk(int dequeIndex, JobChunk *chunk);
+    void runChunk(const JobChunk &chunk);
+    int getDequeIndex();
+
     void stop();
-    void threadLoop();
+    void threadLoop(int index);
 
-    bool should_terminate = false;           // Tells threads to stop looking for jobs
-    std::mutex queue_mutex;                  // Prevents data races to the job queue
-    std::condition_variable mutex_condition; // Allows threads to wait on new jobs or termination
+    // One deque per worker and the last one for threads outside of the pool
+    std::vector<JobDeque> deques;
     std::vector<std::thread> threads;
-    std::queue<std::function<void()>> jobs;
 
-    std::atomic<int> inProgress = 0;
+    // Amount of chunks waiting in deques, workers sleep when there is none
+    std::atomic<int> pending = 0;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::condition_variable doneCondition;
+    bool bShouldTerminate = false;
 };
@@ -23,8 +23,12 @@ public:
     inline Vector3 getClosestPoint(const Vector3 &p) const
     {
         Vector3 ab = b - a;
+        float abLength2 = glm::dot(ab, ab);
+        if (abLength2 == 0.0f)
+            return a;
+
         // Project c onto ab, computing parameterized position d(t)=a+ t*(b – a)
-        float t = glm::dot(p - a, ab) / glm::dot(ab, ab);
+        float t = glm::dot(p - a, ab) / abLength2;
 
         // If outside segment, clamp t (and therefore d) to the closest endpoint
         if (t < 0.0f)
@@ -67,7 +71,7 @@ public:
             float distance = glm::length(newOnPoly - newOnSegment);
             if (distance < minDistance)
             {
-                distance = minDistance;
+                minDistance = distance;
                 onPoly = newOnPoly;
                 onSegment = newOnSegment;
             }
@@ -105,7 +109,7 @@ public:
             float distance = glm::length(newOnPoly - newOnSegment);
             if (distance < maxDistance)
             {
-                distance = maxDistance;
+                maxDistance = distance;
                 onTri = newOnPoly;
                 onSegment = newOnSegment;
             }
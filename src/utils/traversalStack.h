@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2024 Dmitrii Shashkov
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <vector>
+
+// Stack of tree traversals, first N entries live in place and it moves to the heap only if a degenerate tree needs more
+template <typename T, int N>
+class TraversalStack
+{
+public:
+    inline TraversalStack() {}
+    TraversalStack(const TraversalStack &) = delete;
+    TraversalStack &operator=(const TraversalStack &) = delete;
+
+    inline void push(const T &value)
+    {
+        if (count == capacity)
+            grow();
+        data[count++] = value;
+    }
+
+    inline T pop() { return data[--count]; }
+    inline bool isEmpty() const { return count == 0; }
+
+protected:
+    void grow()
+    {
+        if (data == local)
+            heap.assign(local, local + count);
+        capacity *= 2;
+        heap.resize(capacity);
+        data = heap.data();
+    }
+
+    T local[N];
+    T *data = local;
+    int count = 0;
+    int capacity = N;
+    std::vector<T> heap;
+};